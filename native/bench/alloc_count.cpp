@@ -0,0 +1,255 @@
+///
+/// Heap allocation count for loop() on the host build.
+///
+/// Runs setup(), warms up, then counts every heap allocation made during
+/// loop() against the same simulated indoor unit and PLC as the latency
+/// benchmark, and attributes it to the loop stage it happened in. Once
+/// warmed up, loop() must not allocate: the ESP8266 heap fragments until
+/// the web server can no longer get a buffer. Fails if it does.
+///
+/// The HTTP server library allocates per request whatever the handlers do.
+/// Every --http-every iterations a request goes to /api/state, /metrics or
+/// a handler that does nothing, in turn, and neither of the first two may
+/// allocate more per request than that library baseline.
+///
+/// Allocations are counted in malloc() with glibc, in operator new
+/// elsewhere (which misses direct malloc() calls).
+///
+/// Usage: program [--iterations N] [--warmup N] [--modbus-fail-rate P]
+///                [--http-every N] [--advance-us N]
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#include "loop_stages.h"
+#include "profiler.h"
+
+void setup();
+void loop();
+
+static bool counting;
+static unsigned long allocations;
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocations += counting;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocations += counting;
+    return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(size_t size)
+{
+    allocations += counting;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+// Allocations per stage, counted from the stage's start to the next one's
+static unsigned long stageAllocations[LOOP_STAGE_COUNT];
+static int currentStage = -1;
+static unsigned long stageStartAllocations;
+
+static void stageDone()
+{
+    if (currentStage >= 0)
+    {
+        stageAllocations[currentStage] += allocations - stageStartAllocations;
+    }
+    currentStage = -1;
+}
+
+void loopStageHook(LoopStage stage)
+{
+    stageDone();
+    currentStage = stage;
+    stageStartAllocations = allocations;
+}
+
+// Requested in turn, the first one measures the server library's own
+// allocations per request
+static const char *const HTTP_URIS[] = {"/bench/noop", "/api/state", "/metrics"};
+#define HTTP_URI_COUNT (sizeof(HTTP_URIS) / sizeof(HTTP_URIS[0]))
+
+struct Options
+{
+    long iterations = 20000;
+    long warmup = 20000;
+    double modbusFailRate = 0;
+    long httpEvery = 100;
+    long advanceMicros = 1000;
+};
+
+static Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(arg, "--iterations") == 0)
+            options.iterations = atol(value), i++;
+        else if (strcmp(arg, "--warmup") == 0)
+            options.warmup = atol(value), i++;
+        else if (strcmp(arg, "--modbus-fail-rate") == 0)
+            options.modbusFailRate = atof(value), i++;
+        else if (strcmp(arg, "--http-every") == 0)
+            options.httpEvery = atol(value), i++;
+        else if (strcmp(arg, "--advance-us") == 0)
+            options.advanceMicros = atol(value), i++;
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(2);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    plc.failRate = options.modbusFailRate;
+    // Power command from the PLC
+    plc.hreg[0] = 1;
+
+    setup();
+    WebServer *http = nullptr;
+    long allocatingIterations = 0;
+    // Most allocations in the http stage of a pass serving the URI
+    unsigned long requestAllocations[HTTP_URI_COUNT] = {};
+    unsigned long requestsMeasured[HTTP_URI_COUNT] = {};
+    size_t nextUri = 0;
+    int pendingUri = -1;
+    for (long i = 0; i < options.warmup + options.iterations; i++)
+    {
+        if (!http)
+        {
+            http = WebServer::hostInstance();
+            if (http)
+            {
+                http->on(HTTP_URIS[0], HTTP_GET, [] {});
+            }
+        }
+        if (http && options.httpEvery > 0 && i % options.httpEvery == 0 && pendingUri < 0)
+        {
+            pendingUri = nextUri;
+            nextUri = (nextUri + 1) % HTTP_URI_COUNT;
+            http->hostRequest(HTTP_URIS[pendingUri]);
+        }
+        bool measured = i >= options.warmup;
+        unsigned long before = allocations;
+        unsigned long httpBefore = stageAllocations[LOOP_STAGE_HTTP];
+        unsigned long served = http ? http->hostRequestsServed : 0;
+        counting = measured;
+        loop();
+        stageDone();
+        counting = false;
+        allocatingIterations += allocations != before;
+        if (http && pendingUri >= 0 && http->hostRequestsServed != served)
+        {
+            if (measured)
+            {
+                unsigned long request = stageAllocations[LOOP_STAGE_HTTP] - httpBefore;
+                requestAllocations[pendingUri] = std::max(requestAllocations[pendingUri], request);
+                requestsMeasured[pendingUri]++;
+            }
+            pendingUri = -1;
+        }
+        host::advanceMicros(options.advanceMicros);
+    }
+
+    printf("heap allocations in loop() over %ld iterations after %ld warmup\n", options.iterations, options.warmup);
+    for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++)
+    {
+        printf("%-10s %10lu\n", profilerSlotName(stage), stageAllocations[stage]);
+    }
+    unsigned long held = allocations - stageAllocations[LOOP_STAGE_HTTP];
+    printf("%-10s %10lu in %ld iterations\n", "total", allocations, allocatingIterations);
+    printf("heatpump packets %lu, plc transactions %lu, http requests %lu\n", heatpump.packetsReceived, plc.transactions,
+           http ? http->hostRequestsServed : 0);
+
+    for (size_t uri = 0; uri < HTTP_URI_COUNT; uri++)
+    {
+        printf("%-12s %4lu allocations per request at most, %lu requests\n", HTTP_URIS[uri], requestAllocations[uri],
+               requestsMeasured[uri]);
+    }
+
+    int failures = 0;
+    if (held > 0)
+    {
+        fprintf(stderr, "FAIL: %lu allocations outside the http stage\n", held);
+        failures++;
+    }
+    for (size_t uri = 1; uri < HTTP_URI_COUNT; uri++)
+    {
+        if (requestAllocations[uri] > requestAllocations[0])
+        {
+            fprintf(stderr, "FAIL: %s allocates %lu times per request, the server library alone %lu\n",
+                    HTTP_URIS[uri], requestAllocations[uri], requestAllocations[0]);
+            failures++;
+        }
+        if (options.httpEvery > 0 && requestsMeasured[uri] == 0)
+        {
+            fprintf(stderr, "FAIL: no %s request served while counting\n", HTTP_URIS[uri]);
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+///
+/// Startup timeline benchmark for the host build.
+///
+/// Runs setup() and loop() against a simulated indoor unit and PLC, with
+/// WiFi taking --wifi-associate-ms to associate, until every boot phase
+/// (boot_timeline.h) has been reached. Prints when each was, and the
+/// longest loop() pass on the way, and checks that /api/boot and the
+/// Modbus input registers agree with it.
+///
+/// Exits 1 if the heat pump was first heard from later than
+/// --max-contact-ms after reset, or the first Modbus write went out later
+/// than --max-first-write-ms after WiFi associated. Without tasks nothing
+/// else runs while HeatPump::connect() blocks, so if WiFi is up before it
+/// returns the time counts from then.
+///
+/// With --hp-absent no unit answers. Then it runs for a minute, long
+/// enough for the unit to be tried again, and exits 1 if any loop() pass
+/// after the first connect attempt takes longer than --max-pass-us, e.g.
+/// because the unit is retried with HeatPump::connect().
+///
+/// Usage: program [--wifi-associate-ms N] [--advance-us N]
+///                [--max-contact-ms N] [--max-first-write-ms N]
+///                [--hp-absent] [--max-pass-us N]
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <Arduino.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include <WebServer.h>
+#include <WiFi.h>
+#include "boot_timeline.h"
+#include "constants.h"
+#include "loop_stages.h"
+
+void setup();
+void loop();
+uint16_t bootRegisterRead(uint8_t unit, uint16_t address);
+
+void loopStageHook(LoopStage) {}
+
+// Give up on phases not reached by then
+#define BOOT_TIME_LIMIT_MILLIS 30000
+#define HP_ABSENT_RUN_MILLIS 60000
+// IREG_BOOT_OFFSET, see the top of main.cpp
+#define BOOT_REGISTERS 2000
+
+static bool allReached()
+{
+    for (uint8_t i = 0; i < BOOT_PHASE_LEN; i++)
+    {
+        if (!bootReached(BootPhase(i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    long advanceMicros = 1000;
+    // HeatPump::connect() alone takes 2 s, and update() keeps a 1 s gap
+    // after it: the first exchange has to go out as soon as that is over
+    unsigned long maxContactMillis = 3000;
+    unsigned long maxFirstWriteMillis = 100;
+    bool hpAbsent = false;
+    unsigned long maxPassMicros = 100000;
+    host::wifiAssociateMillis = 2500;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--wifi-associate-ms") == 0 && i + 1 < argc)
+            host::wifiAssociateMillis = atol(argv[++i]);
+        else if (strcmp(argv[i], "--advance-us") == 0 && i + 1 < argc)
+            advanceMicros = atol(argv[++i]);
+        else if (strcmp(argv[i], "--max-contact-ms") == 0 && i + 1 < argc)
+            maxContactMillis = atol(argv[++i]);
+        else if (strcmp(argv[i], "--max-first-write-ms") == 0 && i + 1 < argc)
+            maxFirstWriteMillis = atol(argv[++i]);
+        else if (strcmp(argv[i], "--hp-absent") == 0)
+            hpAbsent = true;
+        else if (strcmp(argv[i], "--max-pass-us") == 0 && i + 1 < argc)
+            maxPassMicros = atol(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    heatpump.online = !hpAbsent;
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    plc.hreg[0] = 1;
+
+    setup();
+    unsigned long longestPass = 0;
+    // Of the passes after the first connect attempt
+    unsigned long longestLaterPass = 0;
+    bool connectTried = false;
+    unsigned long runMillis = hpAbsent ? HP_ABSENT_RUN_MILLIS : BOOT_TIME_LIMIT_MILLIS;
+    while ((hpAbsent || !allReached()) && millis() < runMillis)
+    {
+        unsigned long start = micros();
+        loop();
+        unsigned long pass = micros() - start;
+        longestPass = std::max(longestPass, pass);
+        if (connectTried)
+        {
+            longestLaterPass = std::max(longestLaterPass, pass);
+        }
+        // The one that may block, for 2 s in HeatPump::connect()
+        connectTried = connectTried || pass > 1000000;
+        host::advanceMicros(advanceMicros);
+    }
+
+    printf("boot timeline, WiFi associating for %lu ms (milliseconds since reset)\n", host::wifiAssociateMillis);
+    for (uint8_t i = 0; i < BOOT_PHASE_LEN; i++)
+    {
+        BootPhase phase = BootPhase(i);
+        if (bootReached(phase))
+        {
+            printf("%-20s %8lu\n", bootPhaseName(phase), (unsigned long)bootMillis(phase));
+        }
+        else
+        {
+            printf("%-20s %8s\n", bootPhaseName(phase), "-");
+        }
+    }
+    printf("longest loop() pass %lu us, after the first connect attempt %lu us\n", longestPass, longestLaterPass);
+
+    int failures = 0;
+    WebServer *http = WebServer::hostInstance();
+    http->hostRequest("/api/boot");
+    loop();
+    printf("/api/boot %s\n", http->hostLastBody.c_str());
+    for (uint8_t i = 0; i < BOOT_PHASE_LEN; i++)
+    {
+        BootPhase phase = BootPhase(i);
+        char json[48];
+        uint32_t registers = uint32_t(bootRegisterRead(0, BOOT_REGISTERS + i * 2)) << 16 |
+                             bootRegisterRead(0, BOOT_REGISTERS + i * 2 + 1);
+        uint32_t expected = bootMillis(phase);
+        if (bootReached(phase))
+        {
+            snprintf(json, sizeof(json), "\"%s\":%lu", bootPhaseName(phase), (unsigned long)expected);
+        }
+        else
+        {
+            snprintf(json, sizeof(json), "\"%s\":null", bootPhaseName(phase));
+            expected = 0xFFFFFFFF;
+        }
+        if (http->hostLastBody.find(json) == std::string::npos || registers != expected)
+        {
+            fprintf(stderr, "FAIL: %s at %lu ms, input registers say %lu\n", bootPhaseName(phase),
+                    (unsigned long)bootMillis(phase), (unsigned long)registers);
+            failures++;
+        }
+    }
+    if (hpAbsent)
+    {
+        if (longestLaterPass > maxPassMicros)
+        {
+            fprintf(stderr, "FAIL: loop() pass of %lu us with no heat pump attached, limit %lu us\n",
+                    longestLaterPass, maxPassMicros);
+            failures++;
+        }
+        return failures > 0 ? 1 : 0;
+    }
+    unsigned long contact = bootMillis(BOOT_HEATPUMP_CONTACT);
+    if (!bootReached(BOOT_HEATPUMP_CONTACT) || contact > maxContactMillis)
+    {
+        fprintf(stderr, "FAIL: heat pump contact at %lu ms, limit %lu ms\n", contact, maxContactMillis);
+        failures++;
+    }
+    unsigned long networkReady = std::max(host::wifiAssociateMillis, (unsigned long)bootMillis(BOOT_HEATPUMP_CONNECTED));
+    unsigned long firstWrite = bootMillis(BOOT_MODBUS_FIRST_WRITE) - networkReady;
+    if (!bootReached(BOOT_MODBUS_FIRST_WRITE) || firstWrite > maxFirstWriteMillis)
+    {
+        fprintf(stderr, "FAIL: first Modbus write %lu ms after WiFi associated, limit %lu ms\n", firstWrite,
+                maxFirstWriteMillis);
+        failures++;
+    }
+    return failures > 0 ? 1 : 0;
+}
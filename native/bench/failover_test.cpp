@@ -0,0 +1,157 @@
+///
+/// Remote Modbus failover test for the host build.
+///
+/// Built with HOST_STANDBY_PLC, which makes REMOTE_MODBUS_TARGETS a primary
+/// PLC and a hot standby (native/shims/secrets.h). The primary commands
+/// the heat pump on and the standby off, so the heat pump shows which one
+/// the command is read from. Checks that:
+///
+/// - the state is written to both, and the watchdog register reset on
+///   every write
+/// - the command comes from the primary while it is up, from the standby
+///   within --max-failover-ms once it goes down, and from the primary
+///   again once it is back
+/// - with both down, the modbus stage of loop() blocks for no longer than
+///   one connection attempt, REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS
+/// - a server that stops answering FC23 gets separate reads and writes,
+///   also after it reconnects
+///
+/// Exits 1 if any check fails.
+///
+/// Usage: program [--advance-us N] [--max-failover-ms N]
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <Arduino.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#define HOST_TEST_STAGE_HOOK
+#include "host_test.h"
+#include "metrics.h"
+#include "registers.h"
+
+#ifndef HOST_STANDBY_PLC
+#error "Build with -D HOST_STANDBY_PLC"
+#endif
+
+static unsigned long modbusStageStart;
+static bool inModbusStage;
+static unsigned long modbusStageMax;
+
+static void modbusStageDone()
+{
+    if (inModbusStage)
+    {
+        modbusStageMax = std::max(modbusStageMax, micros() - modbusStageStart);
+        inModbusStage = false;
+    }
+}
+
+// The modbus stage ends with the next one in loop()
+void loopStageHook(LoopStage stage)
+{
+    modbusStageDone();
+    if (stage == LOOP_STAGE_MODBUS)
+    {
+        inModbusStage = true;
+        modbusStageStart = micros();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long maxFailoverMillis = 15000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--advance-us") == 0 && i + 1 < argc)
+            advanceMicros = atol(argv[++i]);
+        else if (strcmp(argv[i], "--max-failover-ms") == 0 && i + 1 < argc)
+            maxFailoverMillis = atol(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    heatpump.power = 0;
+    host::ModbusRemote &primary = host::modbusRemote(REMOTE_MODBUS_IP);
+    host::ModbusRemote &standby = host::modbusRemote(REMOTE_MODBUS_STANDBY_IP);
+    primary.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    standby.hreg[HOLDING_REG_POWER_COMMAND] = 0;
+
+    setup();
+    run(10000);
+    CHECK(heatpump.power == 1, "power command not taken from the primary");
+    CHECK(primary.hreg[HOLDING_REG_CONNECTED_INDEX] == 1 && standby.hreg[HOLDING_REG_CONNECTED_INDEX] == 1,
+          "state not written to both targets");
+    // The watchdog is reset with every write, not only the full ones
+    for (int i = 0; i < 5; i++)
+    {
+        primary.hreg[HOLDING_REG_TIMEOUT_COUNTER] = 7;
+        run(REMOTE_MODBUS_WRITE_INTERVAL_MILLIS + REMOTE_MODBUS_JITTER_MILLIS + 100);
+        CHECK(primary.hreg[HOLDING_REG_TIMEOUT_COUNTER] == 0, "watchdog register not reset within a write interval");
+    }
+    printf("both up: primary %lu registers written, standby %lu\n", primary.registersWritten, standby.registersWritten);
+
+    // Primary down
+    primary.up = false;
+    unsigned long standbyWritten = standby.registersWritten;
+    unsigned long failover = runUntilPower(heatpump, 0, maxFailoverMillis);
+    printf("primary down: command from the standby after %lu ms\n", failover);
+    CHECK(failover < maxFailoverMillis, "no failover to the standby within %lu ms", maxFailoverMillis);
+    run(10000);
+    CHECK(standby.registersWritten > standbyWritten, "standby not written while the primary is down");
+
+    // Both down
+    standby.up = false;
+    run(5000);
+    modbusStageMax = 0;
+    run(30000);
+    printf("both down: longest modbus stage %lu us, connect timeout %lu ms\n", modbusStageMax,
+           (unsigned long)REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS);
+    CHECK(modbusStageMax < (REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS + 100) * 1000UL,
+          "modbus stage blocked %lu us with both targets down", modbusStageMax);
+
+    // Both back, the primary wins again
+    standby.up = true;
+    primary.up = true;
+    unsigned long failback = runUntilPower(heatpump, 1, maxFailoverMillis * 2);
+    printf("both back: command from the primary after %lu ms\n", failback);
+    CHECK(failback < maxFailoverMillis * 2, "command not back to the primary within %lu ms", maxFailoverMillis * 2);
+    printf("command target changes %lu\n", (unsigned long)metricCounters[COUNTER_MODBUS_COMMAND_TARGET_CHANGES]);
+
+    // The primary stops answering FC23, and comes back after a restart
+    // still without it. It gets separate reads and writes for good.
+    primary.readWriteTimesOut = true;
+    standby.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    run(20000);
+    primary.up = false;
+    run(3000);
+    primary.up = true;
+    run(10000);
+    uint32_t readWriteFailures = metricCounters[COUNTER_MODBUS_READ_WRITE_FAILURES];
+    unsigned long primaryWritten = primary.registersWritten;
+    unsigned long primaryTransactions = primary.transactions;
+    primary.hreg[HOLDING_REG_POWER_COMMAND] = 0;
+    standby.hreg[HOLDING_REG_POWER_COMMAND] = 0;
+    CHECK(runUntilPower(heatpump, 0, maxFailoverMillis) < maxFailoverMillis, "no power command without FC23");
+    run(10000);
+    printf("no FC23: %lu transactions with the primary, %lu read/write failures in all\n",
+           primary.transactions - primaryTransactions, (unsigned long)metricCounters[COUNTER_MODBUS_READ_WRITE_FAILURES]);
+    CHECK(metricCounters[COUNTER_MODBUS_READ_WRITE_FAILURES] == readWriteFailures, "FC23 tried again after a reconnect");
+    CHECK(primary.registersWritten > primaryWritten && primary.transactions - primaryTransactions > 5,
+          "primary not read and written without FC23");
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+    printf("failover ok\n");
+    return 0;
+}
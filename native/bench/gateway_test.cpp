@@ -0,0 +1,196 @@
+///
+/// Multi heat pump gateway test for the host build.
+///
+/// Built with HEATPUMP_UNITS=3 and the Modbus server enabled. Attaches a
+/// simulated indoor unit to each UART, each with its own room
+/// temperature, runs setup() and loop(), and checks that:
+///
+/// - every unit is polled about as often as the others
+/// - Modbus unit ids 1 to 3 read their own unit, others get exception 0x0A
+/// - a write through one unit id reaches only that unit
+/// - a temperature out of range gets exception 0x03 and goes nowhere
+/// - each unit's block on the PLC is at REMOTE_MODBUS_UNIT_OFFSET steps
+///   and its power command reaches only that unit
+/// - a unit that stops answering does not hold up the others
+///
+/// Exits 1 if any check fails.
+///
+/// Usage: program [--advance-us N]
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <Arduino.h>
+#include <WiFiServer.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#include "host_test.h"
+#include "modbus_server.h"
+#include "registers.h"
+
+#if HEATPUMP_UNITS != 3 || !MODBUS_SERVER_ENABLED
+#error "Build with -D HEATPUMP_UNITS=3 -D MODBUS_SERVER_ENABLED=true"
+#endif
+
+// Room temperatures of the simulated units, Celsius
+static const int ROOM_TEMPERATURES[HEATPUMP_UNITS] = {19, 22, 25};
+
+// Sends one request to the server and returns the PDU of the answer,
+// empty if none came
+static std::string transact(WiFiClient::Connection &connection, uint8_t unitId, const std::string &pdu)
+{
+    static uint16_t transaction;
+    transaction++;
+    uint16_t len = pdu.size() + 1;
+    const char header[] = {char(transaction >> 8), char(transaction), 0, 0, char(len >> 8), char(len), char(unitId)};
+    connection.sent.clear();
+    connection.received.append(header, sizeof(header));
+    connection.received.append(pdu);
+    for (int i = 0; i < 100 && connection.sent.size() < 7; i++)
+    {
+        loop();
+        host::advanceMicros(advanceMicros);
+    }
+    return connection.sent.size() > 7 ? connection.sent.substr(7) : std::string();
+}
+
+static std::string readHolding(uint16_t address, uint16_t count)
+{
+    return {0x03, char(address >> 8), char(address), char(count >> 8), char(count)};
+}
+
+static std::string writeHolding(uint16_t address, uint16_t value)
+{
+    return {0x06, char(address >> 8), char(address), char(value >> 8), char(value)};
+}
+
+static uint16_t registerValue(const std::string &answer, size_t index)
+{
+    return (uint8_t(answer[2 + 2 * index]) << 8) | uint8_t(answer[3 + 2 * index]);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--advance-us") == 0 && i + 1 < argc)
+            advanceMicros = atol(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::unique_ptr<CN105Sim> units[HEATPUMP_UNITS];
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        units[unit].reset(new CN105Sim(unit));
+        units[unit]->power = 0;
+        units[unit]->roomTemperature = ROOM_TEMPERATURES[unit] * 2 + 128;
+    }
+    // Power command from the PLC for the second unit only
+    plc.hreg[1 * REMOTE_MODBUS_UNIT_OFFSET + HOLDING_REG_POWER_COMMAND] = 1;
+
+    setup();
+    std::shared_ptr<WiFiClient::Connection> master;
+    while (!master)
+    {
+        master = host::wifiConnect(MODBUS_SERVER_PORT);
+        run(1);
+    }
+    run(20000);
+
+    // Polling
+    unsigned long fewest = ~0UL;
+    unsigned long most = 0;
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        fewest = std::min(fewest, units[unit]->packetsReceived);
+        most = std::max(most, units[unit]->packetsReceived);
+    }
+    printf("packets per unit over 20 s: fewest %lu, most %lu\n", fewest, most);
+    CHECK(fewest > 0 && most - fewest <= fewest / 5 + 2, "units not polled evenly, %lu to %lu packets", fewest, most);
+
+    // PLC side
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        uint16_t base = unit * REMOTE_MODBUS_UNIT_OFFSET;
+        uint16_t room = plc.hreg[base + HOLDING_REG_ROOM_TEMPERATURE_INDEX];
+        CHECK(room == ROOM_TEMPERATURES[unit] * 10, "PLC room temperature of unit %u at %u is %u", unit,
+              base + HOLDING_REG_ROOM_TEMPERATURE_INDEX, room);
+        CHECK(plc.hreg[base + HOLDING_REG_CONNECTED_INDEX] == 1, "PLC does not see unit %u connected", unit);
+        CHECK(units[unit]->power == (unit == 1), "PLC power command reached unit %u: power %u", unit, units[unit]->power);
+    }
+
+    // Modbus server routing
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        std::string answer = transact(*master, unit + 1, readHolding(0, HOLDING_LEN));
+        CHECK(answer.size() == 2 + 2 * HOLDING_LEN && answer[0] == 0x03, "no register read for unit id %u", unit + 1);
+        if (answer.size() == 2 + 2 * HOLDING_LEN)
+        {
+            uint16_t room = registerValue(answer, HOLDING_REG_ROOM_TEMPERATURE_INDEX);
+            CHECK(room == ROOM_TEMPERATURES[unit] * 10, "unit id %u reads room temperature %u", unit + 1, room);
+        }
+    }
+    for (uint8_t unitId : {0, HEATPUMP_UNITS + 1})
+    {
+        std::string answer = transact(*master, unitId, readHolding(0, HOLDING_LEN));
+        CHECK(answer == std::string({char(0x83), 0x0a}), "unit id %u not answered with exception 0x0A", unitId);
+    }
+
+    unsigned long changes[HEATPUMP_UNITS];
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        changes[unit] = units[unit]->settingChanges;
+    }
+    std::string answer = transact(*master, 3, writeHolding(HOLDING_REG_POWER_INDEX, 1));
+    CHECK(answer == writeHolding(HOLDING_REG_POWER_INDEX, 1), "write through unit id 3 not echoed");
+    run(5000);
+    CHECK(units[2]->power == 1, "write through unit id 3 did not reach unit 2");
+    for (uint8_t unit = 0; unit < 2; unit++)
+    {
+        CHECK(units[unit]->settingChanges == changes[unit], "write through unit id 3 reached unit %u", unit);
+    }
+
+    // Out of range temperature, ILLEGAL_DATA_VALUE
+    changes[0] = units[0]->settingChanges;
+    answer = transact(*master, 1, writeHolding(HOLDING_REG_TEMPERATURE_INDEX, 990));
+    CHECK(answer == std::string({char(0x86), 0x03}), "temperature 990 through unit id 1 not answered with exception 0x03");
+    run(5000);
+    CHECK(units[0]->settingChanges == changes[0], "temperature 990 through unit id 1 reached unit 0");
+    answer = transact(*master, 1, writeHolding(HOLDING_REG_TEMPERATURE_INDEX, 240));
+    CHECK(answer == writeHolding(HOLDING_REG_TEMPERATURE_INDEX, 240), "temperature 240 through unit id 1 not echoed");
+
+    // One unit off line
+    units[0]->online = false;
+    unsigned long before[HEATPUMP_UNITS];
+    for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+    {
+        before[unit] = units[unit]->packetsReceived;
+    }
+    run(60000);
+    // At the pace of the first 20 s, which included startup
+    unsigned long expected = fewest * 3;
+    for (uint8_t unit = 1; unit < HEATPUMP_UNITS; unit++)
+    {
+        unsigned long packets = units[unit]->packetsReceived - before[unit];
+        printf("unit %u with unit 0 off line: %lu packets in 60 s\n", unit, packets);
+        CHECK(packets >= expected * 8 / 10, "unit %u polled %lu times in 60 s with unit 0 off line, expected %lu", unit,
+              packets, expected);
+    }
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+    printf("gateway ok\n");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_TEST_H__
+#define HOST_TEST_H__
+
+///
+/// Shared fixture of the host tests: runs the firmware's loop() on the
+/// virtual clock and counts failed checks. Include it from the one source
+/// file of a test. A test with a loopStageHook() of its own defines
+/// HOST_TEST_STAGE_HOOK before including it.
+///
+
+#include <cstdio>
+#include <Arduino.h>
+#include <CN105Sim.h>
+#include "loop_stages.h"
+
+void setup();
+void loop();
+
+#ifndef HOST_TEST_STAGE_HOOK
+void loopStageHook(LoopStage) {}
+#endif
+
+// Virtual time between loop() passes, --advance-us
+static long advanceMicros = 1000;
+static int failures;
+
+#define CHECK(condition, ...)                  \
+    if (!(condition))                          \
+    {                                          \
+        fprintf(stderr, "FAIL: " __VA_ARGS__); \
+        fprintf(stderr, "\n");                 \
+        failures++;                            \
+    }
+
+static inline void run(unsigned long millis)
+{
+    unsigned long end = ::millis() + millis;
+    while (long(::millis() - end) < 0)
+    {
+        loop();
+        host::advanceMicros(advanceMicros);
+    }
+}
+
+// Runs until the heat pump power is as given, returns how long that took
+// or max if it did not happen
+static inline unsigned long runUntilPower(CN105Sim &heatpump, uint8_t power, unsigned long max)
+{
+    unsigned long start = millis();
+    while (heatpump.power != power && millis() - start < max)
+    {
+        run(10);
+    }
+    return millis() - start;
+}
+
+#endif // HOST_TEST_H__
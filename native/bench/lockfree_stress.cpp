@@ -0,0 +1,223 @@
+///
+/// Stress test for the lock-free containers in lockfree.h, with host
+/// threads standing in for the ESP32 tasks.
+///
+/// - SpscQueue and MpscQueue: producers push numbered items as fast as
+///   they can, one consumer checks that every item arrives exactly once
+///   and in order per producer.
+/// - SeqLock: one writer publishes values whose fields all derive from a
+///   counter, readers check that no copy mixes two writes and that the
+///   counter never goes backwards.
+///
+/// Worth running under ThreadSanitizer as well (-fsanitize=thread).
+///
+/// Usage: program [--items N] [--producers N] [--readers N]
+///
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "lockfree.h"
+
+#define QUEUE_SIZE 16
+
+struct Options
+{
+    long items = 1000000;
+    int producers = 3;
+    int readers = 2;
+};
+
+static Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(arg, "--items") == 0)
+            options.items = atol(value), i++;
+        else if (strcmp(arg, "--producers") == 0)
+            options.producers = atoi(value), i++;
+        else if (strcmp(arg, "--readers") == 0)
+            options.readers = atoi(value), i++;
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(2);
+        }
+    }
+    return options;
+}
+
+struct Item
+{
+    uint32_t producer;
+    uint32_t sequence;
+};
+
+// Returns the number of errors
+template <typename Queue>
+static long runQueue(const char *name, int producers, long items)
+{
+    static Queue queue;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([p, items]() {
+            for (long i = 0; i < items; i++)
+            {
+                while (!queue.push(Item{uint32_t(p), uint32_t(i)}))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::vector<long> next(producers, 0);
+    long received = 0;
+    long errors = 0;
+    long emptyPolls = 0;
+    while (received < producers * items)
+    {
+        Item item;
+        if (!queue.pop(item))
+        {
+            emptyPolls++;
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.producer >= uint32_t(producers) || item.sequence != next[item.producer])
+        {
+            if (errors++ < 10)
+            {
+                fprintf(stderr, "%s: got item %u from producer %u, expected %ld\n", name, item.sequence, item.producer,
+                        item.producer < uint32_t(producers) ? next[item.producer] : -1);
+            }
+        }
+        else
+        {
+            next[item.producer]++;
+        }
+        received++;
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    Item extra;
+    if (queue.pop(extra))
+    {
+        fprintf(stderr, "%s: item left over after all were received\n", name);
+        errors++;
+    }
+    printf("%-10s %d producer(s), %ld items, %ld empty polls, %ld errors\n", name, producers, received, emptyPolls, errors);
+    return errors;
+}
+
+// Bigger than one word and with a pointer, like HeatpumpSnapshot
+struct Sample
+{
+    uint32_t counter;
+    const char *name;
+    float half;
+    uint16_t words[13];
+    uint32_t check;
+};
+
+static const char *const NAMES[] = {"OFF", "ON"};
+
+static Sample makeSample(uint32_t counter)
+{
+    Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.counter = counter;
+    sample.name = NAMES[counter % 2];
+    sample.half = counter / 2.0f;
+    for (size_t i = 0; i < sizeof(sample.words) / sizeof(sample.words[0]); i++)
+    {
+        sample.words[i] = uint16_t(counter * (i + 1));
+    }
+    sample.check = ~counter;
+    return sample;
+}
+
+static bool consistent(const Sample &sample)
+{
+    Sample expected = makeSample(sample.counter);
+    return memcmp(&sample, &expected, sizeof(Sample)) == 0;
+}
+
+static long runSeqLock(int readers, long writes)
+{
+    static SeqLock<Sample> lock;
+    lock.write(makeSample(0));
+    std::atomic<bool> done(false);
+    std::atomic<long> torn(0);
+    std::atomic<long> backwards(0);
+    std::atomic<long> reads(0);
+    std::atomic<long> busy(0);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++)
+    {
+        threads.emplace_back([&]() {
+            uint32_t last = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                Sample sample;
+                if (!lock.read(sample))
+                {
+                    busy++;
+                    continue;
+                }
+                reads++;
+                if (!consistent(sample))
+                {
+                    torn++;
+                }
+                else if (sample.counter < last)
+                {
+                    backwards++;
+                }
+                last = sample.counter;
+            }
+        });
+    }
+    for (long i = 1; i <= writes; i++)
+    {
+        lock.write(makeSample(uint32_t(i)));
+    }
+    done = true;
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    Sample last;
+    long errors = torn + backwards;
+    if (!lock.read(last) || last.counter != uint32_t(writes))
+    {
+        fprintf(stderr, "seqlock: last value lost\n");
+        errors++;
+    }
+    printf("%-10s %d reader(s), %ld writes, %ld reads, %ld busy, %ld torn, %ld backwards\n", "seqlock", readers, writes,
+           reads.load(), busy.load(), torn.load(), backwards.load());
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+    long errors = 0;
+    errors += runQueue<SpscQueue<Item, QUEUE_SIZE>>("spsc", 1, options.items);
+    errors += runQueue<MpscQueue<Item, QUEUE_SIZE>>("mpsc", options.producers, options.items);
+    errors += runSeqLock(options.readers, options.items);
+    if (errors > 0)
+    {
+        fprintf(stderr, "FAIL: %ld errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+///
+/// loop() latency benchmark for the host build.
+///
+/// Runs setup() once and then loop() for the requested number of
+/// iterations against a simulated indoor unit (CN105Sim), a simulated PLC
+/// (host::modbusRemote) and an optional stream of web UI requests.
+/// Reports latency percentiles per loop stage and per whole iteration.
+///
+/// Time includes blocking delay() calls, which advance the host clock
+/// instead of sleeping. Between iterations the clock is advanced by
+/// --advance-us, the time the firmware would spend elsewhere, so that its
+/// timers come due. Stages run only when their timer is due are sampled
+/// only on those iterations.
+///
+/// Usage: program [--iterations N] [--warmup N] [--modbus-fail-rate P]
+///                [--modbus-latency-ms N] [--modbus-down] [--no-fc23] [--hp-offline]
+///                [--http-every N] [--advance-us N] [--max-p99-us N]
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#include "debug_utils.h"
+#include "loop_stages.h"
+#include "profiler.h"
+
+void setup();
+void loop();
+
+static unsigned long stageStart[LOOP_STAGE_COUNT];
+static bool stageSeen[LOOP_STAGE_COUNT];
+
+void loopStageHook(LoopStage stage)
+{
+    stageStart[stage] = micros();
+    stageSeen[stage] = true;
+}
+
+struct Options
+{
+    long iterations = 5000;
+    long warmup = 100;
+    double modbusFailRate = 0;
+    long modbusLatencyMillis = 5;
+    bool modbusDown = false;
+    bool noFc23 = false;
+    bool hpOffline = false;
+    long httpEvery = 0;
+    long advanceMicros = 1000;
+    long maxP99Micros = 0;
+};
+
+static Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(arg, "--iterations") == 0)
+            options.iterations = atol(value), i++;
+        else if (strcmp(arg, "--warmup") == 0)
+            options.warmup = atol(value), i++;
+        else if (strcmp(arg, "--modbus-fail-rate") == 0)
+            options.modbusFailRate = atof(value), i++;
+        else if (strcmp(arg, "--modbus-latency-ms") == 0)
+            options.modbusLatencyMillis = atol(value), i++;
+        else if (strcmp(arg, "--modbus-down") == 0)
+            options.modbusDown = true;
+        else if (strcmp(arg, "--no-fc23") == 0)
+            options.noFc23 = true;
+        else if (strcmp(arg, "--hp-offline") == 0)
+            options.hpOffline = true;
+        else if (strcmp(arg, "--http-every") == 0)
+            options.httpEvery = atol(value), i++;
+        else if (strcmp(arg, "--advance-us") == 0)
+            options.advanceMicros = atol(value), i++;
+        else if (strcmp(arg, "--max-p99-us") == 0)
+            options.maxP99Micros = atol(value), i++;
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(2);
+        }
+    }
+    return options;
+}
+
+static unsigned long percentile(const std::vector<unsigned long> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+static unsigned long printRow(const char *name, std::vector<unsigned long> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (unsigned long sample : samples)
+    {
+        sum += sample;
+    }
+    unsigned long p99 = percentile(samples, 0.99);
+    printf("%-10s %10.0f %10lu %10lu %10lu %10lu %10lu\n", name, samples.empty() ? 0 : sum / samples.size(),
+           percentile(samples, 0.50), percentile(samples, 0.90), p99, percentile(samples, 0.999),
+           samples.empty() ? 0 : samples.back());
+    return p99;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    heatpump.online = !options.hpOffline;
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    plc.up = !options.modbusDown;
+    plc.failRate = options.modbusFailRate;
+    plc.latencyMillis = options.modbusLatencyMillis;
+    plc.supportsReadWrite = !options.noFc23;
+    // Power command from the PLC
+    plc.hreg[0] = 1;
+
+    setup();
+    // Started once WiFi is up
+    WebServer *http = nullptr;
+
+    std::vector<unsigned long> stageSamples[LOOP_STAGE_COUNT];
+    std::vector<unsigned long> totalSamples;
+    for (long i = 0; i < options.warmup + options.iterations; i++)
+    {
+        if (!http)
+        {
+            http = WebServer::hostInstance();
+        }
+        if (http && options.httpEvery > 0 && i % options.httpEvery == 0)
+        {
+            http->hostRequest("/");
+        }
+        std::fill(stageSeen, stageSeen + LOOP_STAGE_COUNT, false);
+        unsigned long start = micros();
+        loop();
+        unsigned long end = micros();
+        host::advanceMicros(options.advanceMicros);
+        if (i < options.warmup)
+        {
+            continue;
+        }
+        totalSamples.push_back(end - start);
+        // A stage lasts until the next one starts, the last one until loop()
+        // returns. Timer callbacks run in whatever order they come due.
+        for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++)
+        {
+            if (!stageSeen[stage])
+            {
+                continue;
+            }
+            unsigned long stageEnd = end;
+            for (int next = 0; next < LOOP_STAGE_COUNT; next++)
+            {
+                bool later = stageStart[next] > stageStart[stage] || (stageStart[next] == stageStart[stage] && next > stage);
+                if (next != stage && stageSeen[next] && later && stageStart[next] < stageEnd)
+                {
+                    stageEnd = stageStart[next];
+                }
+            }
+            stageSamples[stage].push_back(stageEnd - stageStart[stage]);
+        }
+    }
+
+    printf("loop() latency over %ld iterations (microseconds, includes delay())\n", options.iterations);
+    printf("%-10s %10s %10s %10s %10s %10s %10s\n", "stage", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++)
+    {
+        printRow(profilerSlotName(stage), stageSamples[stage]);
+    }
+    unsigned long totalP99 = printRow("total", totalSamples);
+    printf("heatpump packets %lu (set %lu), plc transactions %lu, plc registers written %lu, http requests %lu\n",
+           heatpump.packetsReceived, heatpump.setPacketsReceived, plc.transactions, plc.registersWritten,
+           http ? http->hostRequestsServed : 0);
+    printf("log records dropped %lu\n", (unsigned long)logDroppedCount());
+
+    if (options.maxP99Micros > 0 && totalP99 > (unsigned long)options.maxP99Micros)
+    {
+        fprintf(stderr, "FAIL: total p99 %lu us exceeds limit %ld us\n", totalP99, options.maxP99Micros);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,274 @@
+///
+/// Modbus TCP server load generator for the host build.
+///
+/// Runs setup() and loop() with the Modbus server enabled, and opens
+/// --clients simulated masters against it once WiFi is up. Each one reads
+/// the holding registers (FC 03) and waits for the answer, then sends the
+/// next after --poll-ms. --greedy N makes the first master keep N requests
+/// in flight instead, to check that it does not starve the others.
+/// --idle-clients connect and never send, to fill slots and exercise the
+/// idle reaper (MODBUS_SERVER_IDLE_MILLIS).
+///
+/// Answers are picked up after each loop() and the next requests sent
+/// right away, so latency includes the --advance-us spent outside loop()
+/// before the server gets to them, as on the ESP. Reports requests/s
+/// over the run, latency percentiles, the spread of requests between
+/// masters, and the longest modbus stage of loop().
+///
+/// Usage: program [--clients N] [--seconds N] [--poll-ms N] [--greedy N]
+///                [--idle-clients N] [--advance-us N] [--max-p99-us N]
+///
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <Arduino.h>
+#include <WiFiServer.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#include "loop_stages.h"
+#include "metrics.h"
+#include "modbus_server.h"
+#include "registers.h"
+
+void setup();
+void loop();
+
+static unsigned long modbusStageStart;
+static bool inModbusStage;
+static unsigned long modbusStageMax;
+
+static void modbusStageDone()
+{
+    if (inModbusStage)
+    {
+        modbusStageMax = std::max(modbusStageMax, micros() - modbusStageStart);
+        inModbusStage = false;
+    }
+}
+
+void loopStageHook(LoopStage stage)
+{
+    modbusStageDone();
+    if (stage == LOOP_STAGE_MODBUS)
+    {
+        inModbusStage = true;
+        modbusStageStart = micros();
+    }
+}
+
+struct Options
+{
+    long clients = 4;
+    long seconds = 10;
+    long pollMillis = 0;
+    long greedy = 0;
+    long idleClients = 0;
+    long advanceMicros = 1000;
+    long maxP99Micros = 0;
+};
+
+static Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(arg, "--clients") == 0)
+            options.clients = atol(value), i++;
+        else if (strcmp(arg, "--seconds") == 0)
+            options.seconds = atol(value), i++;
+        else if (strcmp(arg, "--poll-ms") == 0)
+            options.pollMillis = atol(value), i++;
+        else if (strcmp(arg, "--greedy") == 0)
+            options.greedy = atol(value), i++;
+        else if (strcmp(arg, "--idle-clients") == 0)
+            options.idleClients = atol(value), i++;
+        else if (strcmp(arg, "--advance-us") == 0)
+            options.advanceMicros = atol(value), i++;
+        else if (strcmp(arg, "--max-p99-us") == 0)
+            options.maxP99Micros = atol(value), i++;
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(2);
+        }
+    }
+    return options;
+}
+
+struct Master
+{
+    std::shared_ptr<WiFiClient::Connection> connection;
+    bool idle = false;
+    // Requests in flight, by send time
+    std::deque<unsigned long> sentMicros;
+    unsigned long nextSendMicros = 0;
+    uint16_t transaction = 0;
+    uint16_t expectedTransaction = 0;
+    unsigned long completed = 0;
+    unsigned long errors = 0;
+};
+
+static void sendRead(Master &master)
+{
+    const uint8_t request[] = {uint8_t(master.transaction >> 8), uint8_t(master.transaction), 0, 0, 0, 6, 1,
+                               0x03, 0, 0, 0, HOLDING_LEN};
+    master.connection->received.append(reinterpret_cast<const char *>(request), sizeof(request));
+    master.sentMicros.push_back(micros());
+    master.transaction++;
+}
+
+// Takes the answers that have arrived, in order
+static void receiveAnswers(Master &master, std::vector<unsigned long> &latencies)
+{
+    std::string &sent = master.connection->sent;
+    size_t offset = 0;
+    while (sent.size() - offset >= 6 && !master.sentMicros.empty())
+    {
+        const uint8_t *frame = reinterpret_cast<const uint8_t *>(sent.data() + offset);
+        size_t len = 6 + ((frame[4] << 8) | frame[5]);
+        if (sent.size() - offset < len)
+        {
+            break;
+        }
+        uint16_t transaction = (frame[0] << 8) | frame[1];
+        bool ok = transaction == master.expectedTransaction && frame[7] == 0x03 && frame[8] == HOLDING_LEN * 2;
+        master.expectedTransaction++;
+        if (ok)
+        {
+            master.completed++;
+            latencies.push_back(micros() - master.sentMicros.front());
+        }
+        else
+        {
+            master.errors++;
+        }
+        master.sentMicros.pop_front();
+        offset += len;
+    }
+    sent.erase(0, offset);
+}
+
+static unsigned long percentile(const std::vector<unsigned long> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    // Power command from the PLC
+    plc.hreg[0] = 1;
+
+    std::vector<Master> masters(options.clients + options.idleClients);
+    for (long i = 0; i < options.idleClients; i++)
+    {
+        masters[options.clients + i].idle = true;
+    }
+
+    setup();
+    // Idle masters first, so that they hold slots when the others come.
+    // One connects per loop(), once the server listens, which is when
+    // WiFi is up.
+    std::stable_partition(masters.begin(), masters.end(), [](const Master &master) { return master.idle; });
+    for (size_t connected = 0; connected < masters.size();)
+    {
+        masters[connected].connection = host::wifiConnect(MODBUS_SERVER_PORT);
+        connected += masters[connected].connection != nullptr;
+        loop();
+        host::advanceMicros(options.advanceMicros);
+    }
+
+    std::vector<unsigned long> latencies;
+    unsigned long start = micros();
+    unsigned long end = start + options.seconds * 1000000UL;
+    while (long(micros() - end) < 0)
+    {
+        loop();
+        modbusStageDone();
+        for (size_t i = 0; i < masters.size(); i++)
+        {
+            Master &master = masters[i];
+            if (master.idle)
+            {
+                continue;
+            }
+            size_t before = master.sentMicros.size();
+            receiveAnswers(master, latencies);
+            if (master.sentMicros.size() < before)
+            {
+                master.nextSendMicros = micros() + options.pollMillis * 1000;
+            }
+            size_t inFlight = i == 0 && options.greedy > 0 ? options.greedy : 1;
+            while (master.connection->open && master.sentMicros.size() < inFlight &&
+                   long(micros() - master.nextSendMicros) >= 0)
+            {
+                sendRead(master);
+            }
+        }
+        host::advanceMicros(options.advanceMicros);
+    }
+    double elapsed = (micros() - start) / 1e6;
+
+    unsigned long completed = 0;
+    unsigned long errors = 0;
+    unsigned long fewest = ULONG_MAX;
+    unsigned long most = 0;
+    long refused = 0;
+    long idleOpen = 0;
+    for (Master &master : masters)
+    {
+        if (master.idle)
+        {
+            idleOpen += master.connection->open;
+            continue;
+        }
+        if (master.completed == 0 && !master.connection->open)
+        {
+            refused++;
+            continue;
+        }
+        completed += master.completed;
+        errors += master.errors;
+        fewest = std::min(fewest, master.completed);
+        most = std::max(most, master.completed);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    unsigned long p99 = percentile(latencies, 0.99);
+
+    printf("%ld masters (%ld refused), %ld idle (%ld still open), server limit %d, %.1f s\n", options.clients, refused,
+           options.idleClients, idleOpen, MODBUS_SERVER_MAX_CLIENTS, elapsed);
+    printf("requests %lu, %.0f req/s, errors %lu\n", completed, completed / elapsed, errors);
+    printf("latency us: p50 %lu, p90 %lu, p99 %lu, max %lu\n", percentile(latencies, 0.50),
+           percentile(latencies, 0.90), p99, latencies.empty() ? 0 : latencies.back());
+    printf("requests per master: fewest %lu, most %lu\n", fewest == ULONG_MAX ? 0 : fewest, most);
+    printf("longest modbus stage %lu us, slice %d us\n", modbusStageMax, MODBUS_SERVER_SLICE_MICROS);
+    printf("connections accepted %lu, evicted %lu, rejected %lu, idle closed %lu\n",
+           (unsigned long)metricCounters[COUNTER_MODBUS_SERVER_ACCEPTED],
+           (unsigned long)metricCounters[COUNTER_MODBUS_SERVER_EVICTED],
+           (unsigned long)metricCounters[COUNTER_MODBUS_SERVER_REJECTED],
+           (unsigned long)metricCounters[COUNTER_MODBUS_SERVER_IDLE_CLOSED]);
+
+    if (options.maxP99Micros > 0 && p99 > (unsigned long)options.maxP99Micros)
+    {
+        fprintf(stderr, "FAIL: p99 %lu us exceeds limit %ld us\n", p99, options.maxP99Micros);
+        return 1;
+    }
+    return 0;
+}
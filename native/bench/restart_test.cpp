@@ -0,0 +1,210 @@
+///
+/// Restart recovery test for the host build.
+///
+/// Each boot runs in a child process of its own. RTC memory lives in a
+/// file (host::rtcFile), so it carries over from one boot to the next as
+/// it does over a restart on the ESP. Checks that:
+///
+/// - a command still in flight at a restart goes out right after boot,
+///   with the PLC unreachable
+/// - the last registers are served until the heat pump answers
+/// - counters carry on, and the first PLC read after boot passes on
+///   nothing that did not change
+/// - after a restart for WiFi down the heat pump stays off
+/// - each restart is counted by reason, a crash as unexpected
+/// - corrupt RTC memory makes a cold boot
+///
+/// Exits 1 if any check fails.
+///
+/// Usage: program [--advance-us N] [--max-recovery-ms N]
+///
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include <Esp.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include <WiFi.h>
+#include "constants.h"
+#include "host_test.h"
+#include "metrics.h"
+#include "registers.h"
+#include "rtc_state.h"
+
+uint16_t holdingRead(uint8_t unit, uint16_t address);
+bool coilWrite(uint8_t unit, uint16_t address, uint16_t val);
+
+// Exit status of ESP.restart() in the host shim
+#define EXIT_RESTARTED 3
+#define ROOM_TEMPERATURE 19
+
+static unsigned long maxRecoveryMillis = 5000;
+// Cold boot. The PLC switches the heat pump on while it does not answer,
+// and reboots the ESP before the command got through.
+static int bootCold(CN105Sim &heatpump, host::ModbusRemote &plc)
+{
+    heatpump.power = 0;
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 0;
+    setup();
+    CHECK(!rtcStateRestored(), "restored from empty RTC memory");
+    run(10000);
+    heatpump.online = false;
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    run(5000);
+    CHECK(heatpump.power == 0, "power command applied while the heat pump does not answer");
+    if (failures > 0)
+    {
+        return 1;
+    }
+    // Reboot coil, see the top of main.cpp
+    coilWrite(0, 1, 1);
+    run(10000);
+    fprintf(stderr, "FAIL: no restart from the reboot coil\n");
+    return 1;
+}
+
+// After the reboot, with the PLC down: the on command goes out anyway.
+// Then WiFi goes down for good.
+static int bootAfterReboot(CN105Sim &heatpump, host::ModbusRemote &plc)
+{
+    heatpump.power = 0;
+    plc.up = false;
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    setup();
+    CHECK(rtcStateRestored() && rtcBoots() == 2 && rtcLastRestartReason() == RESTART_MODBUS,
+          "restored %d, boot %lu, last restart %s", rtcStateRestored(), (unsigned long)rtcBoots(),
+          restartReasonName(rtcLastRestartReason()));
+    CHECK(metricCounters[COUNTER_HEATPUMP_UPDATES] > 0, "counters not restored");
+    uint16_t room = holdingRead(0, HOLDING_REG_ROOM_TEMPERATURE_INDEX);
+    CHECK(room == ROOM_TEMPERATURE * 10, "room temperature %u served at boot", room);
+    CHECK(holdingRead(0, HOLDING_REG_CONNECTED_INDEX) == 0, "restored snapshot served as connected");
+
+    unsigned long recovery = runUntilPower(heatpump, 1, maxRecoveryMillis);
+    printf("PLC down: command from before the restart applied %lu ms after boot\n", millis());
+    CHECK(recovery < maxRecoveryMillis, "command from before the restart not applied within %lu ms", maxRecoveryMillis);
+
+    // PLC back, nothing changed there
+    plc.up = true;
+    uint32_t applied = metricCounters[COUNTER_COMMANDS_APPLIED];
+    run(10000);
+    CHECK(metricCounters[COUNTER_COMMANDS_APPLIED] == applied, "%lu unchanged commands passed on again after boot",
+          (unsigned long)(metricCounters[COUNTER_COMMANDS_APPLIED] - applied));
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 0;
+    CHECK(runUntilPower(heatpump, 0, 10000) < 10000, "power command after boot not applied");
+    if (failures > 0)
+    {
+        return 1;
+    }
+
+    host::wifiUp = false;
+    run(WIFI_RETRY_MILLIS + 20000);
+    fprintf(stderr, "FAIL: no restart with WiFi down\n");
+    return 1;
+}
+
+// After the restart for WiFi down the heat pump stays off until the PLC
+// can say otherwise. Then the run ends as if it crashed.
+static int bootAfterWifiDown(CN105Sim &heatpump, host::ModbusRemote &plc)
+{
+    heatpump.power = 0;
+    plc.up = false;
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    setup();
+    CHECK(rtcLastRestartReason() == RESTART_WIFI_DOWN, "last restart %s", restartReasonName(rtcLastRestartReason()));
+    run(10000);
+    CHECK(heatpump.power == 0, "power command re-applied after a restart for WiFi down");
+    return failures > 0;
+}
+
+static int bootAfterCrash(CN105Sim &, host::ModbusRemote &)
+{
+    setup();
+    printf("boot %lu: last run ended %s after %lu s, restarts: modbus %lu, wifi_down %lu, unexpected %lu\n",
+           (unsigned long)rtcBoots(), restartReasonName(rtcLastRestartReason()),
+           (unsigned long)rtcLastRestartUptimeSeconds(), (unsigned long)rtcRestarts(RESTART_MODBUS),
+           (unsigned long)rtcRestarts(RESTART_WIFI_DOWN), (unsigned long)rtcRestarts(RESTART_UNEXPECTED));
+    CHECK(rtcBoots() == 4 && rtcLastRestartReason() == RESTART_UNEXPECTED && rtcLastRestartUptimeSeconds() >= 9,
+          "crash not recorded");
+    CHECK(rtcRestarts(RESTART_MODBUS) == 1 && rtcRestarts(RESTART_WIFI_DOWN) == 1 &&
+              rtcRestarts(RESTART_UNEXPECTED) == 1,
+          "restarts not counted by reason");
+    return failures > 0;
+}
+
+static int bootCorrupt(CN105Sim &heatpump, host::ModbusRemote &)
+{
+    heatpump.online = false;
+    setup();
+    CHECK(!rtcStateRestored() && rtcBoots() == 1, "corrupt RTC memory restored");
+    CHECK(metricCounters[COUNTER_HEATPUMP_UPDATES] == 0, "counters restored from corrupt RTC memory");
+    CHECK(holdingRead(0, HOLDING_REG_ROOM_TEMPERATURE_INDEX) != ROOM_TEMPERATURE * 10,
+          "room temperature restored from corrupt RTC memory");
+    return failures > 0;
+}
+
+// Runs boot in a child process, returns its exit status
+static int boot(int (*boot)(CN105Sim &, host::ModbusRemote &))
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        CN105Sim heatpump(HEATPUMP_UART);
+        heatpump.roomTemperature = ROOM_TEMPERATURE * 2 + 128;
+        exit(boot(heatpump, host::modbusRemote(REMOTE_MODBUS_IP)));
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--advance-us") == 0 && i + 1 < argc)
+            advanceMicros = atol(argv[++i]);
+        else if (strcmp(argv[i], "--max-recovery-ms") == 0 && i + 1 < argc)
+            maxRecoveryMillis = atol(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    char rtcFile[] = "/tmp/restart_test_rtc_XXXXXX";
+    close(mkstemp(rtcFile));
+    host::rtcFile = rtcFile;
+
+    int status = boot(bootCold);
+    CHECK(status == EXIT_RESTARTED, "first boot ended with %d", status);
+    status = boot(bootAfterReboot);
+    CHECK(status == EXIT_RESTARTED, "boot after reboot ended with %d", status);
+    status = boot(bootAfterWifiDown);
+    CHECK(status == 0, "boot after WiFi down ended with %d", status);
+    status = boot(bootAfterCrash);
+    CHECK(status == 0, "boot after crash ended with %d", status);
+
+    // Flip a byte of the restart counts
+    if (FILE *file = fopen(rtcFile, "r+b"))
+    {
+        fseek(file, 32 * 4 + 24, SEEK_SET);
+        fputc(0x55, file);
+        fclose(file);
+    }
+    status = boot(bootCorrupt);
+    CHECK(status == 0, "boot with corrupt RTC memory ended with %d", status);
+    unlink(rtcFile);
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+    printf("restart ok\n");
+    return 0;
+}
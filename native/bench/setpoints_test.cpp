@@ -0,0 +1,129 @@
+///
+/// PLC setpoint command test for the host build.
+///
+/// Built with REMOTE_MODBUS_SETPOINTS, so that the PLC commands
+/// temperature, mode, fan and vanes as well as power. Checks that:
+///
+/// - every setpoint the PLC holds reaches the heat pump
+/// - unchanged setpoints cause no setting change on the heat pump
+/// - a changed setpoint goes out as one setting change
+/// - a change from the web UI sticks until the PLC changes that setpoint
+/// - the web UI gets 400 for a temperature that is out of range or not a
+///   number, and nothing of that request is applied
+/// - out of range setpoints are ignored
+///
+/// Exits 1 if any check fails.
+///
+/// Usage: program [--advance-us N]
+///
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ModbusIP_ESP8266.h>
+#include <CN105Sim.h>
+#include "constants.h"
+#include "host_test.h"
+#include "registers.h"
+
+#if !REMOTE_MODBUS_SETPOINTS
+#error "Build with -D REMOTE_MODBUS_SETPOINTS=true"
+#endif
+
+// CN105 extended temperature encoding, see CN105Sim
+static uint8_t encodeTemperature(float celsius)
+{
+    return uint8_t(celsius * 2 + 128);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--advance-us") == 0 && i + 1 < argc)
+            advanceMicros = atol(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    CN105Sim heatpump(HEATPUMP_UART);
+    heatpump.power = 0;
+    host::ModbusRemote &plc = host::modbusRemote(REMOTE_MODBUS_IP);
+    plc.hreg[HOLDING_REG_POWER_COMMAND] = 1;
+    plc.hreg[HOLDING_REG_TEMPERATURE_COMMAND] = 235;
+    // COOL, fan "2", vane SWING, wide vane "<"
+    plc.hreg[HOLDING_REG_MODE_COMMAND] = 2;
+    plc.hreg[HOLDING_REG_FAN_COMMAND] = 3;
+    plc.hreg[HOLDING_REG_VANE_COMMAND] = 6;
+    plc.hreg[HOLDING_REG_WIDEVANE_COMMAND] = 1;
+
+    setup();
+    run(10000);
+    CHECK(heatpump.power == 1, "power %u", heatpump.power);
+    CHECK(heatpump.temperature == encodeTemperature(23.5), "temperature %u", heatpump.temperature);
+    CHECK(heatpump.mode == 0x03, "mode %u", heatpump.mode);
+    CHECK(heatpump.fan == 0x03, "fan %u", heatpump.fan);
+    CHECK(heatpump.vane == 0x07, "vane %u", heatpump.vane);
+    CHECK(heatpump.wideVane == 0x02, "wide vane %u", heatpump.wideVane);
+    CHECK(plc.hreg[HOLDING_REG_TEMPERATURE_INDEX] == 235 && plc.hreg[HOLDING_REG_MODE_INDEX] == 2,
+          "state block shows temperature %u, mode %u", plc.hreg[HOLDING_REG_TEMPERATURE_INDEX],
+          plc.hreg[HOLDING_REG_MODE_INDEX]);
+    printf("after boot: %lu setting changes, %lu set packets\n", heatpump.settingChanges, heatpump.setPacketsReceived);
+
+    unsigned long changes = heatpump.settingChanges;
+    run(30000);
+    printf("30 s unchanged: %lu setting changes\n", heatpump.settingChanges - changes);
+    CHECK(heatpump.settingChanges == changes, "%lu setting changes with nothing changed",
+          heatpump.settingChanges - changes);
+
+    plc.hreg[HOLDING_REG_FAN_COMMAND] = 5;
+    changes = heatpump.settingChanges;
+    run(5000);
+    CHECK(heatpump.fan == 0x06, "fan %u after the PLC changed it", heatpump.fan);
+    CHECK(heatpump.settingChanges == changes + 1, "%lu setting changes for one changed setpoint",
+          heatpump.settingChanges - changes);
+
+    WebServer *http = WebServer::hostInstance();
+    CHECK(http, "no HTTP server");
+    if (http)
+    {
+        changes = heatpump.settingChanges;
+        for (const char *temperature : {"99", "abc", "", "22x", "6570"})
+        {
+            http->hostRequest("/api/set", {{"TEMP", temperature}, {"MODE", "HEAT"}}, HTTP_POST);
+            run(10);
+            CHECK(http->hostLastStatus == 400, "web UI temperature \"%s\" answered with %d", temperature,
+                  http->hostLastStatus);
+        }
+        run(5000);
+        CHECK(heatpump.settingChanges == changes && heatpump.temperature == encodeTemperature(23.5f),
+              "invalid web UI temperature applied, %lu setting changes, temperature %u",
+              heatpump.settingChanges - changes, heatpump.temperature);
+        http->hostRequest("/api/set", {{"TEMP", "25"}}, HTTP_POST);
+    }
+    run(10000);
+    CHECK(heatpump.temperature == encodeTemperature(25), "web UI temperature undone, now %u", heatpump.temperature);
+
+    plc.hreg[HOLDING_REG_TEMPERATURE_COMMAND] = 220;
+    run(5000);
+    CHECK(heatpump.temperature == encodeTemperature(22), "temperature %u after the PLC changed it", heatpump.temperature);
+
+    plc.hreg[HOLDING_REG_TEMPERATURE_COMMAND] = 0xFFFF;
+    plc.hreg[HOLDING_REG_MODE_COMMAND] = 99;
+    changes = heatpump.settingChanges;
+    run(5000);
+    CHECK(heatpump.settingChanges == changes && heatpump.temperature == encodeTemperature(22) && heatpump.mode == 0x03,
+          "out of range setpoints applied");
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+    printf("setpoints ok\n");
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <chrono>
+#include "Arduino.h"
+
+namespace host
+{
+void (*yieldHook)() = nullptr;
+static unsigned long virtualOffsetMicros;
+
+void advanceMicros(unsigned long us)
+{
+    virtualOffsetMicros += us;
+}
+} // namespace host
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+    auto elapsed = std::chrono::steady_clock::now() - bootTime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + host::virtualOffsetMicros;
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(unsigned long ms)
+{
+    host::advanceMicros(ms * 1000);
+    yield();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    host::advanceMicros(us);
+}
+
+void yield()
+{
+    if (host::yieldHook)
+    {
+        host::yieldHook();
+    }
+}
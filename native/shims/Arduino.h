@@ -0,0 +1,46 @@
+#ifndef ARDUINO_SHIM_H__
+#define ARDUINO_SHIM_H__
+
+///
+/// Minimal Arduino core for building the firmware on a Linux host.
+///
+/// Time is virtual on top of the host clock: delay() advances the clock
+/// instead of sleeping, so blocking waits show up in measured latency
+/// without slowing down benchmarks.
+///
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "WString.h"
+#include "HardwareSerial.h"
+
+#define ARDUINO 10813
+#define PROGMEM
+#define PGM_P const char *
+#define F(s) (s)
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+namespace host
+{
+// Advance the virtual clock without running anything
+void advanceMicros(unsigned long us);
+// Called from yield(), lets harnesses observe cooperative scheduling points
+extern void (*yieldHook)();
+} // namespace host
+
+#endif // ARDUINO_SHIM_H__
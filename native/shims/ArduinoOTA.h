@@ -0,0 +1,40 @@
+#ifndef ARDUINOOTA_SHIM_H__
+#define ARDUINOOTA_SHIM_H__
+
+#include <functional>
+#include <cstdint>
+
+typedef enum
+{
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+///
+/// OTA service that never receives an update.
+///
+class ArduinoOTAClass
+{
+public:
+    void setPort(uint16_t) {}
+    void setHostname(const char *) {}
+    void onStart(std::function<void()> fn) { startCallback = fn; }
+    void onEnd(std::function<void()> fn) { endCallback = fn; }
+    void onProgress(std::function<void(unsigned int, unsigned int)> fn) { progressCallback = fn; }
+    void onError(std::function<void(ota_error_t)> fn) { errorCallback = fn; }
+    void begin() {}
+    void handle() {}
+
+private:
+    std::function<void()> startCallback;
+    std::function<void()> endCallback;
+    std::function<void(unsigned int, unsigned int)> progressCallback;
+    std::function<void(ota_error_t)> errorCallback;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif // ARDUINOOTA_SHIM_H__
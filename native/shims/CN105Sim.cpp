@@ -0,0 +1,113 @@
+#include <cstring>
+#include "CN105Sim.h"
+
+#define CN105_HEADER_LEN 5
+#define CN105_START 0xfc
+#define CN105_CONNECT 0x5a
+#define CN105_CONNECT_REPLY 0x7a
+#define CN105_SET 0x41
+#define CN105_SET_REPLY 0x61
+#define CN105_INFO 0x42
+#define CN105_INFO_REPLY 0x62
+
+static uint8_t checksum(const uint8_t *bytes, size_t len)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        sum += bytes[i];
+    }
+    return (CN105_START - sum) & 0xff;
+}
+
+CN105Sim::CN105Sim(int uart) : uart(uart)
+{
+    HardwareSerial::hostAttach(uart, this);
+}
+
+void CN105Sim::onHostWrite(int, uint8_t b)
+{
+    if (packetLen == 0 && b != CN105_START)
+    {
+        return;
+    }
+    packet[packetLen++] = b;
+    size_t expected = packetLen > CN105_HEADER_LEN ? CN105_HEADER_LEN + packet[4] + 1 : 0;
+    if (packetLen > CN105_HEADER_LEN && (packetLen == expected || expected > CN105_PACKET_MAX))
+    {
+        if (online && packetLen == expected && checksum(packet, packetLen - 1) == packet[packetLen - 1])
+        {
+            handlePacket();
+        }
+        packetLen = 0;
+    }
+}
+
+void CN105Sim::handlePacket()
+{
+    packetsReceived++;
+    const uint8_t *data = packet + CN105_HEADER_LEN;
+    uint8_t reply[16] = {};
+    switch (packet[1])
+    {
+    case CN105_CONNECT:
+        reply[0] = 0x00;
+        this->reply(CN105_CONNECT_REPLY, reply, 1);
+        break;
+    case CN105_SET:
+        setPacketsReceived++;
+        if (data[0] == 0x01)
+        {
+            settingChanges += (data[1] | (data[2] & 0x01)) != 0;
+            if (data[1] & 0x01)
+                power = data[3];
+            if (data[1] & 0x02)
+                mode = data[4];
+            if (data[1] & 0x04)
+                temperature = data[14] ? data[14] : uint8_t((31 - data[5]) * 2 + 128);
+            if (data[1] & 0x08)
+                fan = data[6];
+            if (data[1] & 0x10)
+                vane = data[7];
+            if (data[2] & 0x01)
+                wideVane = data[13];
+        }
+        this->reply(CN105_SET_REPLY, reply, sizeof(reply));
+        break;
+    case CN105_INFO:
+        reply[0] = data[0];
+        switch (data[0])
+        {
+        case 0x02:
+            reply[3] = power;
+            reply[4] = mode;
+            reply[5] = uint8_t(31 - (temperature - 128) / 2);
+            reply[6] = fan;
+            reply[7] = vane;
+            reply[10] = wideVane;
+            reply[11] = temperature;
+            break;
+        case 0x03:
+            reply[3] = uint8_t((roomTemperature - 128) / 2 - 10);
+            reply[6] = roomTemperature;
+            break;
+        case 0x06:
+            reply[4] = operating;
+            break;
+        default:
+            break;
+        }
+        this->reply(CN105_INFO_REPLY, reply, sizeof(reply));
+        break;
+    default:
+        break;
+    }
+}
+
+void CN105Sim::reply(uint8_t type, const uint8_t *data, uint8_t len)
+{
+    uint8_t out[CN105_PACKET_MAX] = {CN105_START, type, 0x01, 0x30, len};
+    memcpy(out + CN105_HEADER_LEN, data, len);
+    out[CN105_HEADER_LEN + len] = checksum(out, CN105_HEADER_LEN + len);
+    HardwareSerial::hostInject(uart, out, CN105_HEADER_LEN + len + 1);
+}
@@ -0,0 +1,50 @@
+#ifndef CN105SIM_H__
+#define CN105SIM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "HardwareSerial.h"
+
+// Header, up to 16 data bytes and the checksum
+#define CN105_PACKET_MAX 22
+
+///
+/// Simulated Mitsubishi indoor unit speaking the CN105 protocol.
+/// Answers connect, info (settings, room temperature, status) and set
+/// packets immediately, echoing back whatever settings were written.
+///
+class CN105Sim : public HostSerialPeer
+{
+public:
+    explicit CN105Sim(int uart);
+
+    void onHostWrite(int uart, uint8_t b) override;
+
+    // When false, the unit stays silent like a disconnected cable
+    bool online = true;
+    unsigned long packetsReceived = 0;
+    unsigned long setPacketsReceived = 0;
+    // Set packets that change at least one setting. HeatPump::update()
+    // sends one every time, with no change flagged if there is none.
+    unsigned long settingChanges = 0;
+
+    uint8_t power = 0x01;
+    uint8_t mode = 0x01;
+    uint8_t fan = 0x00;
+    uint8_t vane = 0x00;
+    uint8_t wideVane = 0x03;
+    // Extended encoding: Celsius * 2 + 128
+    uint8_t temperature = 21 * 2 + 128;
+    uint8_t roomTemperature = 22 * 2 + 128;
+    uint8_t operating = 0x01;
+
+private:
+    void handlePacket();
+    void reply(uint8_t type, const uint8_t *data, uint8_t len);
+
+    int uart;
+    uint8_t packet[CN105_PACKET_MAX];
+    size_t packetLen = 0;
+};
+
+#endif // CN105SIM_H__
@@ -0,0 +1,6 @@
+#ifndef DNSSERVER_SHIM_H__
+#define DNSSERVER_SHIM_H__
+
+// Included by main.cpp but unused; nothing to provide on the host.
+
+#endif // DNSSERVER_SHIM_H__
@@ -0,0 +1,10 @@
+#ifndef ESP8266WEBSERVER_SHIM_H__
+#define ESP8266WEBSERVER_SHIM_H__
+
+// The firmware does #define WebServer ESP8266WebServer before including this
+#undef WebServer
+#include "WebServer.h"
+typedef WebServer ESP8266WebServer;
+#define WebServer ESP8266WebServer
+
+#endif // ESP8266WEBSERVER_SHIM_H__
@@ -0,0 +1,6 @@
+#ifndef ESP8266WIFI_SHIM_H__
+#define ESP8266WIFI_SHIM_H__
+
+#include "WiFi.h"
+
+#endif // ESP8266WIFI_SHIM_H__
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Esp.h"
+
+EspClass ESP;
+
+namespace host
+{
+void (*restartHook)() = nullptr;
+uint32_t heapFree = 40000;
+uint32_t heapMaxBlock = 30000;
+const char *rtcFile = nullptr;
+} // namespace host
+
+#define RTC_USER_MEMORY_BYTES 512
+
+// Zero, as after power on, unless host::rtcFile has contents
+static uint8_t rtcMemory[RTC_USER_MEMORY_BYTES];
+static bool rtcLoaded;
+
+static void rtcLoad()
+{
+    if (rtcLoaded || !host::rtcFile)
+    {
+        return;
+    }
+    rtcLoaded = true;
+    if (FILE *file = fopen(host::rtcFile, "rb"))
+    {
+        size_t read = fread(rtcMemory, 1, sizeof(rtcMemory), file);
+        (void)read;
+        fclose(file);
+    }
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return host::heapFree;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize()
+{
+    return host::heapMaxBlock;
+}
+
+uint8_t EspClass::getHeapFragmentation()
+{
+    return host::heapFree == 0 ? 0 : 100 - uint64_t(host::heapMaxBlock) * 100 / host::heapFree;
+}
+
+void EspClass::restart()
+{
+    if (host::restartHook)
+    {
+        host::restartHook();
+    }
+    fprintf(stderr, "ESP.restart() called, exiting\n");
+    exit(3);
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+    if (offset * 4 + size > RTC_USER_MEMORY_BYTES)
+    {
+        return false;
+    }
+    rtcLoad();
+    memcpy(data, rtcMemory + offset * 4, size);
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+    if (offset * 4 + size > RTC_USER_MEMORY_BYTES)
+    {
+        return false;
+    }
+    rtcLoad();
+    memcpy(rtcMemory + offset * 4, data, size);
+    if (host::rtcFile)
+    {
+        if (FILE *file = fopen(host::rtcFile, "wb"))
+        {
+            fwrite(rtcMemory, 1, sizeof(rtcMemory), file);
+            fclose(file);
+        }
+    }
+    return true;
+}
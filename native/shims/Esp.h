@@ -0,0 +1,44 @@
+#ifndef ESP_SHIM_H__
+#define ESP_SHIM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "WString.h"
+
+///
+/// Host stand-in for the ESP SDK chip object. restart() terminates the
+/// process after running host::restartHook, so harnesses can report it.
+/// The heap figures are host::heapFree and host::heapMaxBlock.
+///
+/// RTC user memory is kept in host::rtcFile if set, so that it outlives
+/// the process the way it outlives a restart on the ESP.
+///
+class EspClass
+{
+public:
+    [[noreturn]] void restart();
+    uint32_t getChipId() { return 0x00c0ffee; }
+    uint64_t getEfuseMac() { return 0x0000c0ffee000000ULL; }
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+    // ESP32 name for the same
+    uint32_t getMaxAllocHeap() { return getMaxFreeBlockSize(); }
+    uint8_t getHeapFragmentation();
+    String getResetReason() { return "Software/System restart"; }
+    // offset in 4 byte blocks, size in bytes, 512 bytes in all
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+};
+
+extern EspClass ESP;
+
+namespace host
+{
+extern void (*restartHook)();
+// What the heap getters report, settable to simulate fragmentation
+extern uint32_t heapFree;
+extern uint32_t heapMaxBlock;
+extern const char *rtcFile;
+}
+
+#endif // ESP_SHIM_H__
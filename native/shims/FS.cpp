@@ -0,0 +1,109 @@
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "FS.h"
+
+fs::FS SPIFFS;
+
+namespace fs
+{
+static std::vector<std::string> listDir(const std::string &hostDir)
+{
+    std::vector<std::string> entries;
+    DIR *dir = opendir(hostDir.c_str());
+    if (!dir)
+    {
+        return entries;
+    }
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            entries.push_back(std::string("/") + entry->d_name);
+        }
+    }
+    closedir(dir);
+    return entries;
+}
+
+std::string FS::hostPath(const char *path)
+{
+    const char *dataDir = getenv("MITSUREMOTE_DATA_DIR");
+    return std::string(dataDir ? dataDir : "data") + path;
+}
+
+bool FS::exists(const char *path)
+{
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+    std::string hostFile = hostPath(path);
+    struct stat st;
+    if (stat(hostFile.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        return File(nullptr, path, listDir(hostFile));
+    }
+    FILE *fp = fopen(hostFile.c_str(), mode);
+    if (!fp)
+    {
+        return File();
+    }
+    return File(std::shared_ptr<FILE>(fp, fclose), path);
+}
+
+Dir FS::openDir(const char *path)
+{
+    return Dir(listDir(hostPath(path)));
+}
+
+int File::available()
+{
+    if (!fp)
+    {
+        return 0;
+    }
+    long pos = ftell(fp.get());
+    return int(size()) - int(pos);
+}
+
+size_t File::read(uint8_t *buf, size_t len)
+{
+    return fp ? fread(buf, 1, len, fp.get()) : 0;
+}
+
+int File::read()
+{
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+size_t File::size()
+{
+    if (!fp)
+    {
+        return 0;
+    }
+    long pos = ftell(fp.get());
+    fseek(fp.get(), 0, SEEK_END);
+    long end = ftell(fp.get());
+    fseek(fp.get(), pos, SEEK_SET);
+    return end;
+}
+
+bool File::seek(uint32_t pos)
+{
+    return fp && fseek(fp.get(), pos, SEEK_SET) == 0;
+}
+
+File File::openNextFile()
+{
+    if (nextEntry >= entries.size())
+    {
+        return File();
+    }
+    return SPIFFS.open(entries[nextEntry++].c_str());
+}
+} // namespace fs
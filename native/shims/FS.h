@@ -0,0 +1,69 @@
+#ifndef FS_SHIM_H__
+#define FS_SHIM_H__
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WString.h"
+
+///
+/// SPIFFS backed by a host directory, the project's data/ folder unless
+/// MITSUREMOTE_DATA_DIR says otherwise.
+///
+namespace fs
+{
+class File
+{
+public:
+    File() {}
+    File(std::shared_ptr<FILE> fp, const std::string &name, std::vector<std::string> entries = {})
+        : fp(fp), fileName(name), entries(entries) {}
+
+    explicit operator bool() const { return fp != nullptr || !entries.empty(); }
+    int available();
+    size_t read(uint8_t *buf, size_t len);
+    int read();
+    size_t size();
+    bool seek(uint32_t pos);
+    const char *name() const { return fileName.c_str(); }
+    File openNextFile();
+    void close() { fp.reset(); }
+
+private:
+    std::shared_ptr<FILE> fp;
+    std::string fileName;
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+};
+
+class Dir
+{
+public:
+    Dir(std::vector<std::string> entries) : entries(entries) {}
+    bool next() { return ++current <= entries.size(); }
+    String fileName() const { return String(entries[current - 1]); }
+
+private:
+    std::vector<std::string> entries;
+    size_t current = 0;
+};
+
+class FS
+{
+public:
+    bool begin() { return true; }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    File open(const char *path, const char *mode = "r");
+    File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+    Dir openDir(const char *path);
+
+    static std::string hostPath(const char *path);
+};
+} // namespace fs
+
+using fs::File;
+extern fs::FS SPIFFS;
+
+#endif // FS_SHIM_H__
@@ -0,0 +1,79 @@
+#include <cstdio>
+#include "HardwareSerial.h"
+
+// Fixed size like the real UART's, bytes that do not fit are lost
+struct HostUart
+{
+    uint8_t rx[HOST_SERIAL_RX_BUFFER];
+    size_t rxHead = 0;
+    size_t rxLen = 0;
+    HostSerialPeer *peer = nullptr;
+};
+static HostUart uarts[HOST_SERIAL_UARTS];
+
+HardwareSerial Serial(0);
+
+void HardwareSerial::hostAttach(int uart, HostSerialPeer *peer)
+{
+    uarts[uart].peer = peer;
+}
+
+void HardwareSerial::hostInject(int uart, const uint8_t *data, size_t len)
+{
+    HostUart &u = uarts[uart];
+    for (size_t i = 0; i < len && u.rxLen < HOST_SERIAL_RX_BUFFER; i++)
+    {
+        u.rx[(u.rxHead + u.rxLen++) % HOST_SERIAL_RX_BUFFER] = data[i];
+    }
+}
+
+int HardwareSerial::available()
+{
+    return uarts[uart].rxLen;
+}
+
+int HardwareSerial::peek()
+{
+    const HostUart &u = uarts[uart];
+    return u.rxLen == 0 ? -1 : u.rx[u.rxHead];
+}
+
+int HardwareSerial::read()
+{
+    HostUart &u = uarts[uart];
+    if (u.rxLen == 0)
+    {
+        return -1;
+    }
+    uint8_t b = u.rx[u.rxHead];
+    u.rxHead = (u.rxHead + 1) % HOST_SERIAL_RX_BUFFER;
+    u.rxLen--;
+    return b;
+}
+
+size_t HardwareSerial::write(uint8_t b)
+{
+    if (uarts[uart].peer)
+    {
+        uarts[uart].peer->onHostWrite(uart, b);
+    }
+    else if (uart == 0)
+    {
+        fputc(b, stderr);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        write(buf[i]);
+    }
+    return len;
+}
+
+size_t HardwareSerial::print(const String &s)
+{
+    return write(reinterpret_cast<const uint8_t *>(s.c_str()), s.length());
+}
@@ -0,0 +1,60 @@
+#ifndef HARDWARESERIAL_SHIM_H__
+#define HARDWARESERIAL_SHIM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "WString.h"
+
+#define SERIAL_8N1 0x06
+#define SERIAL_8E1 0x1e
+
+#define HOST_SERIAL_UARTS 3
+#define HOST_SERIAL_RX_BUFFER 256
+
+///
+/// Device on the other end of a simulated UART. Receives every byte the
+/// firmware writes and answers through HardwareSerial::hostInject().
+///
+class HostSerialPeer
+{
+public:
+    virtual ~HostSerialPeer() {}
+    virtual void onHostWrite(int uart, uint8_t b) = 0;
+};
+
+class HardwareSerial
+{
+public:
+    explicit HardwareSerial(int uart) : uart(uart) {}
+
+    void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+    int available();
+    int peek();
+    int read();
+    void flush() {}
+    size_t write(uint8_t b);
+    size_t write(const uint8_t *buf, size_t len);
+    size_t print(const String &s);
+    size_t print(const char *s) { return print(String(s)); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v) { return print(String(v)); }
+    template <typename T>
+    size_t println(const T &v) { return print(v) + print("\n"); }
+    size_t println() { return print("\n"); }
+    operator bool() const { return true; }
+
+    // Host side: attach a simulated device, queue bytes for the firmware to read
+    static void hostAttach(int uart, HostSerialPeer *peer);
+    static void hostInject(int uart, const uint8_t *data, size_t len);
+
+private:
+    int uart;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HARDWARESERIAL_SHIM_H__
@@ -0,0 +1,30 @@
+#ifndef IPADDRESS_SHIM_H__
+#define IPADDRESS_SHIM_H__
+
+#include <cstdint>
+#include <cstdio>
+#include "WString.h"
+
+class IPAddress
+{
+public:
+    IPAddress() : a{0, 0, 0, 0} {}
+    IPAddress(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3) : a{a0, a1, a2, a3} {}
+    explicit IPAddress(uint32_t v) : a{uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)} {}
+
+    operator uint32_t() const { return a[0] | (a[1] << 8) | (a[2] << 16) | (uint32_t(a[3]) << 24); }
+    uint8_t operator[](int i) const { return a[i]; }
+    bool operator==(const IPAddress &o) const { return uint32_t(*this) == uint32_t(o); }
+    bool operator!=(const IPAddress &o) const { return !(*this == o); }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a[0], a[1], a[2], a[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t a[4];
+};
+
+#endif // IPADDRESS_SHIM_H__
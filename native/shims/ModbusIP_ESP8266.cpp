@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cstdlib>
+#include "ModbusIP_ESP8266.h"
+
+namespace host
+{
+ModbusRemote &modbusRemote(IPAddress ip)
+{
+    static std::map<uint32_t, ModbusRemote> remotes;
+    return remotes[uint32_t(ip)];
+}
+
+bool tcpConnect(IPAddress ip, uint16_t, unsigned long timeoutMillis)
+{
+    ModbusRemote &remote = modbusRemote(ip);
+    if (!remote.up)
+    {
+        advanceMicros(std::min(timeoutMillis, remote.connectTimeoutMillis) * 1000);
+    }
+    return remote.up;
+}
+} // namespace host
+
+static uint32_t regKey(TAddress::RegType type, uint16_t offset)
+{
+    return (uint32_t(type) << 16) | offset;
+}
+
+bool ModbusIP::connect(IPAddress ip, uint16_t)
+{
+    host::ModbusRemote &remote = host::modbusRemote(ip);
+    if (!remote.up)
+    {
+        host::advanceMicros(remote.connectTimeoutMillis * 1000);
+    }
+    connected[uint32_t(ip)] = remote.up;
+    return remote.up;
+}
+
+bool ModbusIP::disconnect(IPAddress ip)
+{
+    connected[uint32_t(ip)] = false;
+    return true;
+}
+
+bool ModbusIP::isConnected(IPAddress ip)
+{
+    auto it = connected.find(uint32_t(ip));
+    return it != connected.end() && it->second && host::modbusRemote(ip).up;
+}
+
+bool ModbusIP::isTransaction(uint16_t id)
+{
+    for (const Transaction &t : transactions)
+    {
+        if (t.id == id)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t ModbusIP::send(IPAddress ip, uint16_t readOffset, uint16_t *readTarget, uint16_t readCount, uint16_t writeOffset, const uint16_t *writeData, uint16_t writeCount, cbTransaction cb)
+{
+    if (!isConnected(ip) || transactions.size() >= MODBUSIP_MAX_TRANSACIONS || writeCount > MODBUSIP_MAX_REGS)
+    {
+        return 0;
+    }
+    host::ModbusRemote &remote = host::modbusRemote(ip);
+    bool fail = remote.failRate > 0 && double(rand()) / RAND_MAX < remote.failRate;
+    Transaction t;
+    t.id = nextTransactionId++;
+    if (nextTransactionId == 0)
+    {
+        nextTransactionId = 1;
+    }
+    t.ip = ip;
+    t.readOffset = readOffset;
+    t.readCount = readCount;
+    t.readTarget = readTarget;
+    t.writeOffset = writeOffset;
+    t.writeCount = writeCount;
+    std::copy(writeData, writeData + writeCount, t.writeData);
+    t.cb = cb;
+    t.due = millis() + (fail ? MODBUSIP_TIMEOUT : remote.latencyMillis);
+    t.result = fail ? Modbus::EX_TIMEOUT : Modbus::EX_SUCCESS;
+    if (readCount > 0 && writeCount > 0 && !remote.supportsReadWrite)
+    {
+        t.due = millis() + remote.latencyMillis;
+        t.result = Modbus::EX_ILLEGAL_FUNCTION;
+    }
+    if (readCount > 0 && writeCount > 0 && remote.readWriteTimesOut)
+    {
+        t.due = millis() + MODBUSIP_TIMEOUT;
+        t.result = Modbus::EX_TIMEOUT;
+    }
+    transactions.push_back(t);
+    return t.id;
+}
+
+uint16_t ModbusIP::readHreg(IPAddress ip, uint16_t offset, uint16_t *value, uint16_t numregs, cbTransaction cb, uint8_t)
+{
+    return send(ip, offset, value, numregs, 0, nullptr, 0, cb);
+}
+
+uint16_t ModbusIP::writeHreg(IPAddress ip, uint16_t offset, uint16_t value, cbTransaction cb, uint8_t)
+{
+    return send(ip, 0, nullptr, 0, offset, &value, 1, cb);
+}
+
+uint16_t ModbusIP::writeHreg(IPAddress ip, uint16_t offset, uint16_t *value, uint16_t numregs, cbTransaction cb, uint8_t)
+{
+    return send(ip, 0, nullptr, 0, offset, value, numregs, cb);
+}
+
+uint16_t ModbusIP::readWriteHreg(IPAddress ip, uint16_t readOffset, uint16_t *value, uint16_t numregs, uint16_t writeOffset, uint16_t *writeValue, uint16_t writeNumregs, cbTransaction cb, uint8_t)
+{
+    return send(ip, readOffset, value, numregs, writeOffset, writeValue, writeNumregs, cb);
+}
+
+void ModbusIP::task()
+{
+    unsigned long now = millis();
+    Transaction done[MODBUSIP_MAX_TRANSACIONS];
+    size_t doneCount = 0;
+    for (auto it = transactions.begin(); it != transactions.end();)
+    {
+        if (long(now - it->due) >= 0 || !isConnected(it->ip))
+        {
+            if (!isConnected(it->ip) && it->result == Modbus::EX_SUCCESS)
+            {
+                it->result = Modbus::EX_CONNECTION_LOST;
+            }
+            done[doneCount++] = *it;
+            it = transactions.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    for (size_t d = 0; d < doneCount; d++)
+    {
+        Transaction &t = done[d];
+        host::ModbusRemote &remote = host::modbusRemote(t.ip);
+        if (t.result == Modbus::EX_SUCCESS)
+        {
+            remote.transactions++;
+            // FC23 semantics: write first, then read
+            for (size_t i = 0; i < t.writeCount && t.writeOffset + i < 256; i++)
+            {
+                remote.hreg[t.writeOffset + i] = t.writeData[i];
+            }
+            remote.registersWritten += t.writeCount;
+            for (size_t i = 0; i < t.readCount && t.readOffset + i < 256; i++)
+            {
+                t.readTarget[i] = remote.hreg[t.readOffset + i];
+            }
+        }
+        if (t.cb)
+        {
+            t.cb(t.result, t.id, nullptr);
+        }
+    }
+}
+
+bool ModbusIP::addReg(TAddress::RegType type, uint16_t offset, uint16_t value, uint16_t numregs)
+{
+    for (uint16_t i = 0; i < numregs; i++)
+    {
+        registers[regKey(type, offset + i)].value = value;
+    }
+    return true;
+}
+
+bool ModbusIP::setReg(TAddress::RegType type, uint16_t offset, uint16_t value)
+{
+    auto it = registers.find(regKey(type, offset));
+    if (it == registers.end())
+    {
+        return false;
+    }
+    it->second.value = value;
+    return true;
+}
+
+uint16_t ModbusIP::getReg(TAddress::RegType type, uint16_t offset)
+{
+    auto it = registers.find(regKey(type, offset));
+    return it == registers.end() ? 0 : it->second.value;
+}
+
+bool ModbusIP::onReg(TAddress::RegType type, uint16_t offset, cbModbus cb, uint16_t numregs, bool get)
+{
+    for (uint16_t i = 0; i < numregs; i++)
+    {
+        auto it = registers.find(regKey(type, offset + i));
+        if (it == registers.end())
+        {
+            return false;
+        }
+        (get ? it->second.onGet : it->second.onSet) = cb;
+    }
+    return true;
+}
+
+uint16_t ModbusIP::hostServerRead(TAddress::RegType type, uint16_t offset)
+{
+    auto it = registers.find(regKey(type, offset));
+    if (it == registers.end())
+    {
+        return 0;
+    }
+    TRegister reg{{type, offset}, it->second.value};
+    if (it->second.onGet)
+    {
+        it->second.value = it->second.onGet(&reg, reg.value);
+    }
+    return it->second.value;
+}
+
+void ModbusIP::hostServerWrite(TAddress::RegType type, uint16_t offset, uint16_t value)
+{
+    auto it = registers.find(regKey(type, offset));
+    if (it == registers.end())
+    {
+        return;
+    }
+    TRegister reg{{type, offset}, it->second.value};
+    it->second.value = it->second.onSet ? it->second.onSet(&reg, value) : value;
+}
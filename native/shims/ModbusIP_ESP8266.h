@@ -0,0 +1,181 @@
+#ifndef MODBUSIP_ESP8266_SHIM_H__
+#define MODBUSIP_ESP8266_SHIM_H__
+
+#include <functional>
+#include <map>
+#include <vector>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+///
+/// Host stand-in for modbus-esp8266's ModbusIP. Client transactions go to
+/// simulated remote servers (host::modbusRemote) and complete asynchronously
+/// from task(), like the real library. The server side keeps the local
+/// register image and runs the registered callbacks for host requests.
+///
+
+#define MODBUSIP_PORT 502
+#define MODBUSIP_TIMEOUT 1000
+#define MODBUSIP_UNIT 255
+#define MODBUSIP_MAX_TRANSACIONS 16
+#define MODBUSIP_MAX_CLIENTS 4
+// Registers per request, as in the Modbus spec
+#define MODBUSIP_MAX_REGS 125
+
+#define COIL_VAL(v) ((v) ? 0xFF00 : 0x0000)
+#define COIL_BOOL(v) ((v) == 0xFF00)
+
+class Modbus
+{
+public:
+    enum FunctionCode
+    {
+        FC_READ_COILS = 0x01,
+        FC_READ_INPUT_STAT = 0x02,
+        FC_READ_REGS = 0x03,
+        FC_READ_INPUT_REGS = 0x04,
+        FC_WRITE_COIL = 0x05,
+        FC_WRITE_REG = 0x06,
+        FC_WRITE_COILS = 0x0F,
+        FC_WRITE_REGS = 0x10,
+        FC_READWRITE_REGS = 0x17
+    };
+    enum ResultCode
+    {
+        EX_SUCCESS = 0x00,
+        EX_ILLEGAL_FUNCTION = 0x01,
+        EX_ILLEGAL_ADDRESS = 0x02,
+        EX_ILLEGAL_VALUE = 0x03,
+        EX_SLAVE_FAILURE = 0x04,
+        EX_ACKNOWLEDGE = 0x05,
+        EX_SLAVE_DEVICE_BUSY = 0x06,
+        EX_MEMORY_PARITY_ERROR = 0x08,
+        EX_PATH_UNAVAILABLE = 0x0A,
+        EX_DEVICE_FAILED_TO_RESPOND = 0x0B,
+        EX_GENERAL_FAILURE = 0xE1,
+        EX_DATA_MISMACH = 0xE2,
+        EX_UNEXPECTED_RESPONSE = 0xE3,
+        EX_TIMEOUT = 0xE4,
+        EX_CONNECTION_LOST = 0xE5,
+        EX_CANCEL = 0xE6
+    };
+};
+
+struct TAddress
+{
+    enum RegType
+    {
+        COIL,
+        ISTS,
+        IREG,
+        HREG
+    };
+    RegType type;
+    uint16_t address;
+};
+
+struct TRegister
+{
+    TAddress address;
+    uint16_t value;
+};
+
+typedef std::function<uint16_t(TRegister *reg, uint16_t val)> cbModbus;
+typedef std::function<bool(Modbus::ResultCode event, uint16_t transactionId, void *data)> cbTransaction;
+
+namespace host
+{
+///
+/// A simulated remote Modbus TCP server (the PLC)
+///
+struct ModbusRemote
+{
+    uint16_t hreg[256] = {};
+    bool up = true;
+    // Probability that a transaction times out instead of completing
+    double failRate = 0;
+    unsigned long latencyMillis = 5;
+    // How long connect() blocks before failing while the server is down,
+    // the ESP8266 core's client timeout
+    unsigned long connectTimeoutMillis = 5000;
+    bool supportsReadWrite = true;
+    // FC23 goes unanswered instead of getting illegal function back
+    bool readWriteTimesOut = false;
+    unsigned long transactions = 0;
+    unsigned long registersWritten = 0;
+};
+ModbusRemote &modbusRemote(IPAddress ip);
+} // namespace host
+
+class ModbusIP
+{
+public:
+    ModbusIP() { transactions.reserve(MODBUSIP_MAX_TRANSACIONS); }
+
+    void server(uint16_t = MODBUSIP_PORT) {}
+    void client() {}
+    void task();
+
+    bool connect(IPAddress ip, uint16_t port = MODBUSIP_PORT);
+    bool disconnect(IPAddress ip);
+    bool isConnected(IPAddress ip);
+    bool isTransaction(uint16_t id);
+
+    uint16_t readHreg(IPAddress ip, uint16_t offset, uint16_t *value, uint16_t numregs = 1, cbTransaction cb = nullptr, uint8_t unit = MODBUSIP_UNIT);
+    uint16_t writeHreg(IPAddress ip, uint16_t offset, uint16_t value, cbTransaction cb = nullptr, uint8_t unit = MODBUSIP_UNIT);
+    uint16_t writeHreg(IPAddress ip, uint16_t offset, uint16_t *value, uint16_t numregs = 1, cbTransaction cb = nullptr, uint8_t unit = MODBUSIP_UNIT);
+    uint16_t readWriteHreg(IPAddress ip, uint16_t readOffset, uint16_t *value, uint16_t numregs, uint16_t writeOffset, uint16_t *writeValue, uint16_t writeNumregs, cbTransaction cb = nullptr, uint8_t unit = MODBUSIP_UNIT);
+
+    bool addCoil(uint16_t offset, bool value = false, uint16_t numregs = 1) { return addReg(TAddress::COIL, offset, value ? COIL_VAL(true) : 0, numregs); }
+    bool addHreg(uint16_t offset, uint16_t value = 0, uint16_t numregs = 1) { return addReg(TAddress::HREG, offset, value, numregs); }
+    bool addIreg(uint16_t offset, uint16_t value = 0, uint16_t numregs = 1) { return addReg(TAddress::IREG, offset, value, numregs); }
+    bool Hreg(uint16_t offset, uint16_t value) { return setReg(TAddress::HREG, offset, value); }
+    uint16_t Hreg(uint16_t offset) { return getReg(TAddress::HREG, offset); }
+    bool Ireg(uint16_t offset, uint16_t value) { return setReg(TAddress::IREG, offset, value); }
+    uint16_t Ireg(uint16_t offset) { return getReg(TAddress::IREG, offset); }
+    bool onGetCoil(uint16_t offset, cbModbus cb, uint16_t numregs = 1) { return onReg(TAddress::COIL, offset, cb, numregs, true); }
+    bool onSetCoil(uint16_t offset, cbModbus cb, uint16_t numregs = 1) { return onReg(TAddress::COIL, offset, cb, numregs, false); }
+    bool onGetHreg(uint16_t offset, cbModbus cb, uint16_t numregs = 1) { return onReg(TAddress::HREG, offset, cb, numregs, true); }
+    bool onSetHreg(uint16_t offset, cbModbus cb, uint16_t numregs = 1) { return onReg(TAddress::HREG, offset, cb, numregs, false); }
+    bool onGetIreg(uint16_t offset, cbModbus cb, uint16_t numregs = 1) { return onReg(TAddress::IREG, offset, cb, numregs, true); }
+
+    // Host side: act as a Modbus TCP client of the local server
+    uint16_t hostServerRead(TAddress::RegType type, uint16_t offset);
+    void hostServerWrite(TAddress::RegType type, uint16_t offset, uint16_t value);
+
+private:
+    struct Register
+    {
+        uint16_t value;
+        cbModbus onGet;
+        cbModbus onSet;
+    };
+    struct Transaction
+    {
+        uint16_t id;
+        IPAddress ip;
+        uint16_t readOffset;
+        uint16_t readCount;
+        uint16_t *readTarget;
+        uint16_t writeOffset;
+        uint16_t writeCount;
+        uint16_t writeData[MODBUSIP_MAX_REGS];
+        cbTransaction cb;
+        unsigned long due;
+        Modbus::ResultCode result;
+    };
+
+    bool addReg(TAddress::RegType type, uint16_t offset, uint16_t value, uint16_t numregs);
+    bool setReg(TAddress::RegType type, uint16_t offset, uint16_t value);
+    uint16_t getReg(TAddress::RegType type, uint16_t offset);
+    bool onReg(TAddress::RegType type, uint16_t offset, cbModbus cb, uint16_t numregs, bool get);
+    uint16_t send(IPAddress ip, uint16_t readOffset, uint16_t *readTarget, uint16_t readCount, uint16_t writeOffset, const uint16_t *writeData, uint16_t writeCount, cbTransaction cb);
+
+    std::map<uint32_t, Register> registers;
+    std::map<uint32_t, bool> connected;
+    // Reserved up front, nothing is allocated per transaction
+    std::vector<Transaction> transactions;
+    uint16_t nextTransactionId = 1;
+};
+
+#endif // MODBUSIP_ESP8266_SHIM_H__
@@ -0,0 +1,6 @@
+#ifndef SOFTWARESERIAL_SHIM_H__
+#define SOFTWARESERIAL_SHIM_H__
+
+// Pulled in by main.cpp for ModbusIP; nothing to provide on the host.
+
+#endif // SOFTWARESERIAL_SHIM_H__
@@ -0,0 +1,52 @@
+#ifndef SYSLOG_SHIM_H__
+#define SYSLOG_SHIM_H__
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "WiFiUdp.h"
+
+#define LOG_KERN (0 << 3)
+#define LOG_USER (1 << 3)
+#define LOG_EMERG 0
+#define LOG_ALERT 1
+#define LOG_CRIT 2
+#define LOG_ERR 3
+#define LOG_WARNING 4
+#define LOG_NOTICE 5
+#define LOG_INFO 6
+#define LOG_DEBUG 7
+
+#define SYSLOG_PROTO_IETF 0
+#define SYSLOG_PROTO_BSD 1
+
+///
+/// Formats messages like arduino-syslog and hands them to the UDP sink.
+///
+class Syslog
+{
+public:
+    Syslog(WiFiUDP &udp, const char *, uint16_t, const char * = "-", const char * = "-", uint16_t = LOG_KERN, uint8_t = SYSLOG_PROTO_IETF)
+        : udp(udp) {}
+
+    bool log(uint16_t, const char *message)
+    {
+        udp.beginPacket("", 0);
+        udp.write(reinterpret_cast<const uint8_t *>(message), strlen(message));
+        return udp.endPacket();
+    }
+    bool logf(uint16_t pri, const char *fmt, ...)
+    {
+        char buf[512];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return log(pri, buf);
+    }
+
+private:
+    WiFiUDP &udp;
+};
+
+#endif // SYSLOG_SHIM_H__
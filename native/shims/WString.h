@@ -0,0 +1,97 @@
+#ifndef WSTRING_SHIM_H__
+#define WSTRING_SHIM_H__
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+///
+/// Host stand-in for the Arduino String class. Only the subset used by the
+/// firmware and its libraries is implemented.
+///
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s(s ? s : "") {}
+    String(const std::string &s) : s(s) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(long long v) : s(std::to_string(v)) {}
+    String(unsigned long long v) : s(std::to_string(v)) {}
+    String(bool v) : s(v ? "1" : "0") {}
+    String(float v, unsigned char decimals = 2) : String(double(v), decimals) {}
+    String(double v, unsigned char decimals = 2)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        s = buf;
+    }
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.length(); }
+    bool isEmpty() const { return s.empty(); }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+    char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+    int indexOf(const char *needle) const
+    {
+        size_t pos = s.find(needle);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from < s.size() && to > from ? String(s.substr(from, to - from)) : String();
+    }
+    bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+    }
+    bool reserve(unsigned int size)
+    {
+        s.reserve(size);
+        return true;
+    }
+    explicit operator bool() const { return true; }
+
+    String &operator+=(const String &rhs)
+    {
+        s += rhs.s;
+        return *this;
+    }
+    String &operator+=(const char *rhs)
+    {
+        s += rhs;
+        return *this;
+    }
+    String &operator+=(char rhs)
+    {
+        s += rhs;
+        return *this;
+    }
+    bool concat(const char *rhs, unsigned int len)
+    {
+        s.append(rhs, len);
+        return true;
+    }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+    friend bool operator==(const String &a, const String &b) { return a.s == b.s; }
+    friend bool operator==(const String &a, const char *b) { return a.s == b; }
+    friend bool operator!=(const String &a, const String &b) { return a.s != b.s; }
+    friend bool operator!=(const String &a, const char *b) { return a.s != b; }
+
+private:
+    std::string s;
+};
+
+#endif // WSTRING_SHIM_H__
@@ -0,0 +1,153 @@
+#include "WebServer.h"
+
+static WebServer *lastInstance;
+
+WebServer::WebServer(IPAddress, int)
+{
+    lastInstance = this;
+}
+
+WebServer::WebServer(int)
+{
+    lastInstance = this;
+}
+
+WebServer::~WebServer()
+{
+    if (lastInstance == this)
+    {
+        lastInstance = nullptr;
+    }
+}
+
+WebServer *WebServer::hostInstance()
+{
+    return lastInstance;
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler)
+{
+    routes.push_back(Route{uri, method, handler});
+}
+
+void WebServer::hostRequest(const String &uri, const Args &args, HTTPMethod method, const Args &headers)
+{
+    pending.push_back(Request{uri, method, args, headers});
+}
+
+void WebServer::handleClient()
+{
+    if (pending.empty())
+    {
+        return;
+    }
+    Request request = pending.front();
+    pending.pop_front();
+    currentUri = request.uri;
+    currentMethod = request.method;
+    currentArgs = request.args;
+    currentHeaders = request.headers;
+    hostLastStatus = 0;
+    hostLastBytes = 0;
+    hostLastBody.clear();
+    hostLastConnection = std::make_shared<WiFiClient::Connection>();
+    currentClient = WiFiClient(hostLastConnection);
+    bool routed = false;
+    for (const Route &route : routes)
+    {
+        if (route.uri == currentUri && (route.method == HTTP_ANY || route.method == currentMethod))
+        {
+            route.handler();
+            routed = true;
+            break;
+        }
+    }
+    if (!routed && notFoundHandler)
+    {
+        notFoundHandler();
+    }
+    hostRequestsServed++;
+    // The server lets go of the connection, it is closed unless a handler kept it
+    currentClient = WiFiClient();
+    if (hostLastConnection.use_count() == 1)
+    {
+        hostLastConnection->open = false;
+    }
+}
+
+bool WebServer::hasArg(const String &name) const
+{
+    for (const auto &arg : currentArgs)
+    {
+        if (arg.first == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+String WebServer::arg(const String &name) const
+{
+    for (const auto &arg : currentArgs)
+    {
+        if (arg.first == name)
+        {
+            return arg.second;
+        }
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(const String &name) const
+{
+    for (const auto &header : currentHeaders)
+    {
+        if (header.first == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+String WebServer::header(const String &name) const
+{
+    for (const auto &header : currentHeaders)
+    {
+        if (header.first == name)
+        {
+            return header.second;
+        }
+    }
+    return String();
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool)
+{
+    hostLastBytes += name.length() + value.length() + 4;
+}
+
+void WebServer::send(int code, const char *, const String &content)
+{
+    hostLastStatus = code;
+    hostLastBytes += content.length();
+    hostLastBody.append(content.c_str(), content.length());
+}
+
+void WebServer::send_P(int code, PGM_P, PGM_P content, size_t contentLength)
+{
+    hostLastStatus = code;
+    hostLastBytes += contentLength;
+    hostLastBody.append(content, contentLength);
+}
+
+void WebServer::sendContent(const char *content, size_t size)
+{
+    if (hostLastStatus == 0)
+    {
+        hostLastStatus = 200;
+    }
+    hostLastBytes += size;
+    hostLastBody.append(content, size);
+}
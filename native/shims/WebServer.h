@@ -0,0 +1,103 @@
+#ifndef WEBSERVER_SHIM_H__
+#define WEBSERVER_SHIM_H__
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "FS.h"
+#include "WiFiClient.h"
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_POST
+};
+
+///
+/// In-process HTTP server. Requests are queued by the harness with
+/// hostRequest() and dispatched one per handleClient(), the same
+/// granularity as the ESP servers. Responses are counted, not transmitted.
+///
+class WebServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    typedef std::vector<std::pair<String, String>> Args;
+
+    WebServer(IPAddress addr, int port = 80);
+    WebServer(int port = 80);
+    ~WebServer();
+
+    void begin() {}
+    void stop() {}
+    void close() {}
+    void handleClient();
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction fn) { notFoundHandler = fn; }
+
+    WiFiClient client() { return currentClient; }
+    String uri() const { return currentUri; }
+    HTTPMethod method() const { return currentMethod; }
+    bool hasArg(const String &name) const;
+    String arg(const String &name) const;
+    String arg(int i) const { return i < int(currentArgs.size()) ? currentArgs[i].second : String(); }
+    String argName(int i) const { return i < int(currentArgs.size()) ? currentArgs[i].first : String(); }
+    int args() const { return currentArgs.size(); }
+    void collectHeaders(const char *[], const size_t) {}
+    bool hasHeader(const String &name) const;
+    String header(const String &name) const;
+
+    void setContentLength(size_t) {}
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void send(int code, const char *contentType = nullptr, const String &content = String());
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength);
+    void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char *content, size_t size);
+    void sendContent_P(PGM_P content, size_t size) { sendContent(content, size); }
+
+    // Host side: queue a request and inspect what the last one produced
+    static WebServer *hostInstance();
+    void hostRequest(const String &uri, const Args &args = Args(), HTTPMethod method = HTTP_GET, const Args &headers = Args());
+    size_t hostPending() const { return pending.size(); }
+    int hostLastStatus = 0;
+    size_t hostLastBytes = 0;
+    std::string hostLastBody;
+    // Connection of the last request, stays open if a handler kept a copy
+    std::shared_ptr<WiFiClient::Connection> hostLastConnection;
+    unsigned long hostRequestsServed = 0;
+
+private:
+    struct Request
+    {
+        String uri;
+        HTTPMethod method;
+        Args args;
+        Args headers;
+    };
+    struct Route
+    {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+    std::vector<Route> routes;
+    THandlerFunction notFoundHandler;
+    std::deque<Request> pending;
+    String currentUri;
+    HTTPMethod currentMethod = HTTP_GET;
+    Args currentArgs;
+    Args currentHeaders;
+    WiFiClient currentClient;
+};
+
+#endif // WEBSERVER_SHIM_H__
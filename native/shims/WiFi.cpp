@@ -0,0 +1,24 @@
+#include "WiFi.h"
+
+WiFiClass WiFi;
+
+namespace host
+{
+unsigned long wifiAssociateMillis = 0;
+bool wifiUp = true;
+} // namespace host
+
+void WiFiClass::begin(const char *, const char *)
+{
+    beginMillis = millis();
+    begun = true;
+}
+
+wl_status_t WiFiClass::status()
+{
+    if (!begun || !host::wifiUp)
+    {
+        return WL_DISCONNECTED;
+    }
+    return millis() - beginMillis >= host::wifiAssociateMillis ? WL_CONNECTED : WL_IDLE_STATUS;
+}
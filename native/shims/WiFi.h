@@ -0,0 +1,47 @@
+#ifndef WIFI_SHIM_H__
+#define WIFI_SHIM_H__
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+#define WIFI_STA 1
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+///
+/// Simulated station interface. Association completes host::wifiAssociateMillis
+/// after begin(); harnesses can drop the link through host::wifiUp.
+///
+class WiFiClass
+{
+public:
+    void mode(int) {}
+    void begin(const char *ssid, const char *password);
+    wl_status_t status();
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    void disconnect() {}
+
+private:
+    unsigned long beginMillis = 0;
+    bool begun = false;
+};
+
+extern WiFiClass WiFi;
+
+namespace host
+{
+extern unsigned long wifiAssociateMillis;
+extern bool wifiUp;
+} // namespace host
+
+#endif // WIFI_SHIM_H__
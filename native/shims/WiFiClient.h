@@ -0,0 +1,101 @@
+#ifndef WIFICLIENT_SHIM_H__
+#define WIFICLIENT_SHIM_H__
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+namespace host
+{
+// Outgoing connections, see ModbusIP_ESP8266.cpp: true if a simulated
+// server listens at ip, otherwise fails after blocking for at most
+// timeoutMillis
+bool tcpConnect(IPAddress ip, uint16_t port, unsigned long timeoutMillis);
+} // namespace host
+
+///
+/// TCP connection handle. Copies share the connection, like on the ESP
+/// cores. Bytes written are collected in the connection for the harness
+/// to inspect, bytes the harness puts in received are read back, and the
+/// harness can close it to simulate the peer leaving.
+///
+class WiFiClient
+{
+public:
+    struct Connection
+    {
+        std::string sent;
+        // From the peer, not read yet
+        std::string received;
+        bool open = true;
+    };
+
+    WiFiClient() {}
+    explicit WiFiClient(std::shared_ptr<Connection> connection) : connection(connection) {}
+
+    // Outgoing connections only go as far as connected(), nothing is sent
+    int connect(IPAddress ip, uint16_t port) { return connect(ip, port, timeout); }
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMillis)
+    {
+        connection.reset();
+        if (host::tcpConnect(ip, port, timeoutMillis))
+        {
+            connection = std::make_shared<Connection>();
+        }
+        return connected();
+    }
+    void setTimeout(unsigned long timeoutMillis) { timeout = timeoutMillis; }
+    uint8_t connected() const { return connection && connection->open; }
+    explicit operator bool() const { return connected(); }
+    void setNoDelay(bool) {}
+    void stop()
+    {
+        if (connection)
+        {
+            connection->open = false;
+        }
+        connection.reset();
+    }
+    void flush() {}
+    IPAddress remoteIP() const { return IPAddress(127, 0, 0, 1); }
+    int available() const { return connection ? connection->received.size() : 0; }
+    int read()
+    {
+        uint8_t byte;
+        return read(&byte, 1) == 1 ? byte : -1;
+    }
+    int read(uint8_t *buffer, size_t size)
+    {
+        if (!connection)
+        {
+            return 0;
+        }
+        size = std::min(size, connection->received.size());
+        memcpy(buffer, connection->received.data(), size);
+        connection->received.erase(0, size);
+        return size;
+    }
+    size_t write(const uint8_t *data, size_t size)
+    {
+        if (!connected())
+        {
+            return 0;
+        }
+        connection->sent.append(reinterpret_cast<const char *>(data), size);
+        return size;
+    }
+    size_t print(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+    size_t print(const String &s) { return write(reinterpret_cast<const uint8_t *>(s.c_str()), s.length()); }
+
+    // Host side
+    std::shared_ptr<Connection> hostConnection() const { return connection; }
+
+private:
+    std::shared_ptr<Connection> connection;
+    // As on the ESP8266 core
+    unsigned long timeout = 5000;
+};
+
+#endif // WIFICLIENT_SHIM_H__
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <vector>
+#include "WiFiServer.h"
+
+// Servers that have begun. Servers are static in the firmware and never
+// go away.
+static std::vector<WiFiServer *> &listening()
+{
+    static std::vector<WiFiServer *> servers;
+    return servers;
+}
+
+void WiFiServer::begin()
+{
+    if (!listening)
+    {
+        listening = true;
+        ::listening().push_back(this);
+    }
+}
+
+void WiFiServer::stop()
+{
+    if (listening)
+    {
+        listening = false;
+        std::vector<WiFiServer *> &servers = ::listening();
+        servers.erase(std::remove(servers.begin(), servers.end(), this), servers.end());
+    }
+    backlog.clear();
+}
+
+WiFiClient WiFiServer::accept()
+{
+    while (!backlog.empty())
+    {
+        std::shared_ptr<WiFiClient::Connection> connection = backlog.front();
+        backlog.pop_front();
+        // Peers that gave up before being accepted
+        if (connection->open)
+        {
+            return WiFiClient(connection);
+        }
+    }
+    return WiFiClient();
+}
+
+namespace host
+{
+std::shared_ptr<WiFiClient::Connection> wifiConnect(uint16_t port)
+{
+    for (WiFiServer *server : ::listening())
+    {
+        if (server->hostPort() == port)
+        {
+            auto connection = std::make_shared<WiFiClient::Connection>();
+            server->hostQueue(connection);
+            return connection;
+        }
+    }
+    return nullptr;
+}
+} // namespace host
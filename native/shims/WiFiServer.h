@@ -0,0 +1,39 @@
+#ifndef WIFISERVER_SHIM_H__
+#define WIFISERVER_SHIM_H__
+
+#include <deque>
+#include <memory>
+#include "WiFiClient.h"
+
+///
+/// Listening socket. The harness opens connections to it with
+/// host::wifiConnect(), and accept() hands them out in order.
+///
+class WiFiServer
+{
+public:
+    explicit WiFiServer(uint16_t port) : port(port) {}
+
+    void begin();
+    void stop();
+    void setNoDelay(bool) {}
+    WiFiClient accept();
+    WiFiClient available() { return accept(); }
+
+    // Host side
+    uint16_t hostPort() const { return port; }
+    void hostQueue(std::shared_ptr<WiFiClient::Connection> connection) { backlog.push_back(connection); }
+
+private:
+    uint16_t port;
+    bool listening = false;
+    std::deque<std::shared_ptr<WiFiClient::Connection>> backlog;
+};
+
+namespace host
+{
+// Connects to the server listening on port, null if there is none
+std::shared_ptr<WiFiClient::Connection> wifiConnect(uint16_t port);
+} // namespace host
+
+#endif // WIFISERVER_SHIM_H__
@@ -0,0 +1,25 @@
+#ifndef SECRETS_H__
+#define SECRETS_H__
+
+// Host build defaults, used when src/secrets.h does not exist.
+// The simulated remote Modbus server answers on any address.
+
+#define WIFI_SSID "native"
+#define WIFI_PASSWORD "native"
+#define REMOTE_MODBUS_IP \
+    {                    \
+        127, 0, 0, 2     \
+    }
+#define REMOTE_MODBUS_PORT 505
+// The native_failover host build adds a hot standby
+#ifdef HOST_STANDBY_PLC
+#define REMOTE_MODBUS_STANDBY_IP \
+    {                            \
+        127, 0, 0, 3             \
+    }
+#define REMOTE_MODBUS_TARGETS                                                                   \
+    {                                                                                           \
+        {REMOTE_MODBUS_IP, REMOTE_MODBUS_PORT}, {REMOTE_MODBUS_STANDBY_IP, REMOTE_MODBUS_PORT} \
+    }
+#endif
+#endif // SECRETS_H__
@@ -0,0 +1,95 @@
+"""Minifies and gzips data/web_ui.html into src/web_ui_html.h.
+
+Runs before every PlatformIO build (extra_scripts in platformio.ini) and
+can be run by hand with `python3 scripts/embed_web_ui.py`. The header is
+only rewritten when the page changed, so builds are not invalidated.
+"""
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821, provided by PlatformIO
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "data", "web_ui.html")
+TARGET = os.path.join(PROJECT_DIR, "src", "web_ui_html.h")
+
+
+def minify_css(css):
+    css = re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+    css = re.sub(r"\s+", " ", css)
+    css = re.sub(r"\s*([{};,>])\s*", r"\1", css)
+    # Only after colons, "a :hover" differs from "a:hover"
+    return re.sub(r":\s+", ":", css).strip()
+
+
+def minify_js(js):
+    # Line based and conservative: newlines are kept for automatic
+    # semicolon insertion, only whole-line comments are dropped
+    lines = (line.strip() for line in js.splitlines())
+    return "\n".join(line for line in lines if line and not line.startswith("//"))
+
+
+def minify_html(html):
+    html = re.sub(r"<!--.*?-->", "", html, flags=re.S)
+    out = []
+    pos = 0
+    for match in re.finditer(r"(<style>)(.*?)(</style>)|(<script>)(.*?)(</script>)", html, flags=re.S):
+        out.append(minify_markup(html[pos:match.start()]))
+        if match.group(1):
+            out.append(match.group(1) + minify_css(match.group(2)) + match.group(3))
+        else:
+            out.append(match.group(4) + minify_js(match.group(5)) + match.group(6))
+        pos = match.end()
+    out.append(minify_markup(html[pos:]))
+    return "".join(out)
+
+
+def minify_markup(markup):
+    lines = (re.sub(r"\s+", " ", line).strip() for line in markup.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def render_header(compressed, etag, source_len, minified_len):
+    rows = []
+    for i in range(0, len(compressed), 16):
+        rows.append("    " + " ".join("0x%02x," % b for b in compressed[i:i + 16]))
+    return """// Generated by scripts/embed_web_ui.py from data/web_ui.html, do not edit.
+// %d bytes, %d minified, %d gzipped.
+#ifndef WEB_UI_HTML_H__
+#define WEB_UI_HTML_H__
+
+#include <Arduino.h>
+
+#define WEB_UI_HTML_ETAG "\\"%s\\""
+static const size_t WEB_UI_HTML_GZ_LEN = %d;
+static const uint8_t WEB_UI_HTML_GZ[] PROGMEM = {
+%s
+};
+
+#endif // WEB_UI_HTML_H__
+""" % (source_len, minified_len, len(compressed), etag, len(compressed), "\n".join(rows))
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        source = f.read()
+    minified = minify_html(source.decode("utf-8")).encode("utf-8")
+    # mtime 0 keeps the output, and so the ETag, reproducible
+    compressed = gzip.compress(minified, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(compressed).hexdigest()[:16]
+    header = render_header(compressed, etag, len(source), len(minified))
+    if os.path.exists(TARGET):
+        with open(TARGET) as f:
+            if f.read() == header:
+                return
+    with open(TARGET, "w") as f:
+        f.write(header)
+    print("embed_web_ui: %s -> %s (%d bytes gzipped)" % (SOURCE, TARGET, len(compressed)))
+
+
+main()
@@ -1,168 +1,297 @@
+#include <algorithm>
+#include <cstdlib>
 #include "WebUI.h"
+#include "boot_timeline.h"
+#include "commands.h"
+#include "http_stream.h"
+#include "profiler.h"
+#include "registers.h"
+#include "web_ui_html.h"
 
-String template_html(unsigned long prevHeatpumpComms, std::unique_ptr<HeatPump> &hp, const heatpumpSettings settings, const String &var)
+void sendWebUI(WebServer &server)
 {
-    if (var == "DEBUG_INFO")
+    server.sendHeader("ETag", WEB_UI_HTML_ETAG);
+    // Browsers revalidate every time, which costs a 304 only
+    server.sendHeader("Cache-Control", "no-cache");
+    if (server.header("If-None-Match") == WEB_UI_HTML_ETAG)
     {
+        server.send(304);
+        return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, PSTR("text/html"), reinterpret_cast<PGM_P>(WEB_UI_HTML_GZ), WEB_UI_HTML_GZ_LEN);
+}
+
+static const char *nullToEmpty(const char *s)
+{
+    return s ? s : "";
+}
+
+// State as sent by /api/state, /api/set and /api/events
+static size_t formatStateJson(char *buf, size_t size, const HeatpumpSnapshot &snapshot, const heatpumpSettings &settings)
+{
 #ifdef DEBUG
-        return "In DEBUG mode. Heatpump will not be connected.";
+    const bool debug = true;
 #else
-        return "In PRODUCTION (DEBUG not defined) mode";
+    const bool debug = false;
 #endif
-        return settings.connected ? "Connected to heatpump." : "Not connected to heatpump.";
-    }
-    else if (var == "VERSION")
-    {
-        return VERSION;
-    }
-    else if (var == "CONNECTED_INFO")
-    {
-        String lastCommsText = prevHeatpumpComms == 0 ? "N/A" : String((millis() - prevHeatpumpComms) / 1000);
-        return settings.connected ? "Connected to heatpump. Last comms:" + lastCommsText + " seconds ago" : "Not connected to heatpump.";
-    }
-    else if (var == "UPTIME_SECS")
-    {
-        return String(millis() / 1000);
-    }
-    else if (var == "RATE")
-    {
-        return WEB_UI_REFRESH_RATE_SECS;
-    }
-    else if (var == "ROOMTEMP")
-    {
-        return String(hp->getRoomTemperature());
-    }
-    else if (var == "POWER")
-    {
-        return streq(settings.power, "ON") ? "checked" : "";
-    }
-    else if (var == "MODE_H")
-    {
-        return streq(settings.mode, "HEAT") ? "checked" : "";
-    }
-    else if (var == "MODE_D")
-    {
-        return streq(settings.mode, "DRY") ? "checked" : "";
-    }
-    else if (var == "MODE_C")
-    {
-        return streq(settings.mode, "COOL") ? "checked" : "";
-    }
-    else if (var == "MODE_F")
-    {
-        return streq(settings.mode, "FAN") ? "checked" : "";
-    }
-    else if (var == "MODE_A")
-    {
-        return streq(settings.mode, "AUTO") ? "checked" : "";
-    }
-    if (var == "FAN_A")
-    {
-        return streq(settings.fan, "AUTO") ? "checked" : "";
-    }
-    else if (var == "FAN_Q")
-    {
-        return streq(settings.fan, "QUIET") ? "checked" : "";
-    }
-    else if (var == "FAN_1")
-    {
-        return streq(settings.fan, "1") ? "checked" : "";
-    }
-    else if (var == "FAN_2")
+    long lastComms = snapshot.commsMillis == 0 ? -1 : long(millis() - snapshot.commsMillis);
+    int n = snprintf(buf, size,
+                     "{\"seq\":%lu,\"version\":\"%s\",\"debug\":%s,\"connected\":%s,\"operating\":%s,\"uptime\":%lu,\"lastComms\":%ld,"
+                     "\"roomTemp\":%.1f,\"power\":\"%s\",\"mode\":\"%s\",\"temp\":%.1f,"
+                     "\"fan\":\"%s\",\"vane\":\"%s\",\"wideVane\":\"%s\"}",
+                     (unsigned long)snapshot.sequence, VERSION, debug ? "true" : "false", settings.connected ? "true" : "false",
+                     snapshot.holding[HOLDING_REG_OPERATING_INDEX] ? "true" : "false", millis() / 1000, lastComms,
+                     snapshot.roomTemperature, nullToEmpty(settings.power), nullToEmpty(settings.mode),
+                     settings.temperature, nullToEmpty(settings.fan), nullToEmpty(settings.vane),
+                     nullToEmpty(settings.wideVane));
+    return n < 0 ? 0 : std::min(size_t(n), size - 1);
+}
+
+void sendStateJson(WebServer &server, const HeatpumpSnapshot &snapshot, const heatpumpSettings &settings)
+{
+    char json[WEB_UI_STATE_JSON_SIZE];
+    size_t len = formatStateJson(json, sizeof(json), snapshot, settings);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.setContentLength(len);
+    server.send(200, "application/json", "");
+    server.sendContent(json, len);
+}
+
+///
+/// Server-Sent Events subscribers. The connection is kept after the
+/// handler returns and written to from the loop, only when the snapshot
+/// sequence moves on.
+///
+struct EventClient
+{
+    WiFiClient client;
+    unsigned long lastSendMillis;
+};
+static EventClient eventClients[WEB_UI_EVENT_CLIENTS];
+static uint32_t eventSequence;
+
+static bool sendEvent(EventClient &subscriber, const HeatpumpSnapshot &snapshot)
+{
+    // "data: " + JSON + "\n\n"
+    char event[WEB_UI_STATE_JSON_SIZE + 8];
+    memcpy(event, "data: ", 6);
+    size_t len = 6 + formatStateJson(event + 6, sizeof(event) - 8, snapshot, snapshot.settings);
+    event[len++] = '\n';
+    event[len++] = '\n';
+    subscriber.lastSendMillis = millis();
+    return subscriber.client.write(reinterpret_cast<const uint8_t *>(event), len) == len;
+}
+
+bool addEventClient(WebServer &server, const HeatpumpSnapshot &snapshot)
+{
+    for (EventClient &subscriber : eventClients)
     {
-        return streq(settings.fan, "2") ? "checked" : "";
+        if (subscriber.client.connected())
+        {
+            continue;
+        }
+        subscriber.client = server.client();
+        subscriber.client.setNoDelay(true);
+        subscriber.client.print(F("HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: text/event-stream\r\n"
+                                  "Cache-Control: no-cache\r\n"
+                                  "Connection: keep-alive\r\n\r\n"));
+        eventSequence = snapshot.sequence;
+        if (!sendEvent(subscriber, snapshot))
+        {
+            subscriber.client.stop();
+        }
+        return true;
     }
-    else if (var == "FAN_3")
+    return false;
+}
+
+void webUIEventsLoop(const HeatpumpSnapshot &snapshot)
+{
+    bool changed = snapshot.sequence != eventSequence;
+    eventSequence = snapshot.sequence;
+    for (EventClient &subscriber : eventClients)
     {
-        return streq(settings.fan, "3") ? "checked" : "";
+        if (!subscriber.client.connected())
+        {
+            continue;
+        }
+        bool ok = true;
+        if (changed)
+        {
+            ok = sendEvent(subscriber, snapshot);
+        }
+        else if (millis() - subscriber.lastSendMillis >= WEB_UI_EVENT_KEEPALIVE_MILLIS)
+        {
+            // Comment line, lets both ends notice a dead connection
+            subscriber.lastSendMillis = millis();
+            ok = subscriber.client.print(": keepalive\n\n") > 0;
+        }
+        if (!ok)
+        {
+            subscriber.client.stop();
+        }
     }
-    else if (var == "FAN_4")
+}
+
+void webUIEventsStop()
+{
+    for (EventClient &subscriber : eventClients)
     {
-        return streq(settings.fan, "4") ? "checked" : "";
+        subscriber.client.stop();
     }
-    else if (var == "VANE_V")
+}
+
+void sendProfileJson(WebServer &server)
+{
+    HttpStream out(server, 200, "application/json");
+    out.print("{\"bucketLimitsMicros\":[");
+    for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS; bucket++)
     {
-        return settings.vane;
+        out.printf(bucket == 0 ? "%lu" : ",%lu", (unsigned long)profilerBucketLimit(bucket));
     }
-    else if (var == "VANE_C")
+    out.print("],\"stages\":{");
+    for (uint8_t slot = 0; slot < PROFILER_SLOTS; slot++)
     {
-        return streq(settings.vane, "AUTO") ? "rotate0" :                   //
-                   streq(settings.vane, "1") ? "rotate0" :                  //
-                       streq(settings.vane, "2") ? "rotate22" :             //
-                           streq(settings.vane, "3") ? "rotate45" :         //
-                               streq(settings.vane, "4") ? "rotate67" :     //
-                                   streq(settings.vane, "5") ? "rotate90" : //
-                                       streq(settings.vane, "SWING") ? "rotateV" : "";
+        const ProfilerStats &stats = profilerStats(slot);
+        out.printf("%s\"%s\":{\"count\":%lu,\"min\":%lu,\"mean\":%lu,\"max\":%lu,\"histogram\":[",
+                   slot == 0 ? "" : ",", profilerSlotName(slot), (unsigned long)stats.count, (unsigned long)stats.min,
+                   (unsigned long)(stats.count == 0 ? 0 : stats.sum / stats.count), (unsigned long)stats.max);
+        for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS; bucket++)
+        {
+            out.printf(bucket == 0 ? "%lu" : ",%lu", (unsigned long)stats.histogram[bucket]);
+        }
+        out.print("]}");
     }
-    else if (var == "VANE_T")
+    out.print("}}");
+    out.end();
+}
+
+void sendHeapJson(WebServer &server)
+{
+    HeapSample now = heapRead();
+    HttpStream out(server, 200, "application/json");
+    out.printf("{\"freeBytes\":%lu,\"maxBlockBytes\":%lu,\"fragmentation\":%u,\"lowestFreeBytes\":%lu,"
+               "\"lowestMaxBlockBytes\":%lu,\"low\":%s,\"sampleIntervalSeconds\":%lu,\"history\":[",
+               (unsigned long)now.freeBytes, (unsigned long)now.maxBlockBytes, unsigned(now.fragmentation),
+               (unsigned long)heapLowestFree(), (unsigned long)heapLowestMaxBlock(), heapLow() ? "true" : "false",
+               (unsigned long)(HEAP_SAMPLE_INTERVAL_MILLIS / 1000));
+    for (uint8_t i = 0; i < heapHistoryLen(); i++)
     {
-        return streq(settings.vane, "AUTO") ? "AUTO" : "&#10143;";
+        const HeapSample &sample = heapHistory(i);
+        out.printf("%s{\"uptime\":%lu,\"freeBytes\":%lu,\"maxBlockBytes\":%lu,\"fragmentation\":%u}", i == 0 ? "" : ",",
+                   (unsigned long)sample.uptimeSeconds, (unsigned long)sample.freeBytes,
+                   (unsigned long)sample.maxBlockBytes, unsigned(sample.fragmentation));
     }
-    if (var == "WIDEVANE_V")
+    out.print("]}");
+    out.end();
+}
+
+void sendBootJson(WebServer &server)
+{
+    HttpStream out(server, 200, "application/json");
+    out.printf("{\"uptimeMillis\":%lu,\"phases\":{", millis());
+    for (uint8_t i = 0; i < BOOT_PHASE_LEN; i++)
     {
-        return settings.wideVane;
+        BootPhase phase = BootPhase(i);
+        if (bootReached(phase))
+        {
+            out.printf("%s\"%s\":%lu", i == 0 ? "" : ",", bootPhaseName(phase), (unsigned long)bootMillis(phase));
+        }
+        else
+        {
+            out.printf("%s\"%s\":null", i == 0 ? "" : ",", bootPhaseName(phase));
+        }
     }
-    if (var == "WIDEVANE_C")
+    out.print("}}");
+    out.end();
+}
+
+void sendTimersJson(WebServer &server, TimerWheel *const wheels[], size_t count)
+{
+    HttpStream out(server, 200, "application/json");
+    out.print("{");
+    bool first = true;
+    for (size_t i = 0; i < count; i++)
     {
-        return streq(settings.wideVane, "<<") ? "rotate157" :                //
-                   streq(settings.wideVane, "<") ? "rotate124" :             //
-                       streq(settings.wideVane, "|") ? "rotate90" :          //
-                           streq(settings.wideVane, ">") ? "rotate57" :      //
-                               streq(settings.wideVane, ">>") ? "rotate22" : //
-                                   streq(settings.wideVane, "<>") ? "" :     //
-                                       streq(settings.wideVane, "SWING") ? "rotateH" : "";
+        const TimerWheel &wheel = *wheels[i];
+        for (TimerId id = 0; id < wheel.size(); id++)
+        {
+            out.printf("%s\"%s\":{\"periodMillis\":%lu,\"jitterMillis\":%u,\"active\":%s,\"dueInMillis\":%lu}",
+                       first ? "" : ",", wheel.name(id), (unsigned long)wheel.period(id), unsigned(wheel.jitter(id)),
+                       wheel.active(id) ? "true" : "false", (unsigned long)wheel.millisUntil(id));
+            first = false;
+        }
     }
-    else if (var == "WIDEVANE_T")
+    out.print("}");
+    out.end();
+}
+
+// Maps an argument to the constant enum string so that settings never
+// points into the temporary String returned by arg(). NULL if the argument
+// is missing or invalid.
+static const char *enumArg(WebServer &server, const char *name, const RegisterEnum &values)
+{
+    return server.hasArg(name) ? values.fromIndex(values.fromStr(server.arg(name).c_str())) : NULL;
+}
+
+// Celsius*10, as in the holding register, or 0 if arg is not a whole
+// number of degrees
+static uint16_t temperatureArg(const String &arg)
+{
+    char *end;
+    long celsius = strtol(arg.c_str(), &end, 10);
+    if (end == arg.c_str() || *end != '\0' || celsius < 0 || celsius > UINT16_MAX / 10)
     {
-        return streq(settings.wideVane, "<>") ? //
-                   "<div class='rotate124'>&#10143;</div>&nbsp;<div class='rotate57'>&#10143;</div>"
-                                              : "&#10143;";
+        return 0;
     }
-    return String();
+    return uint16_t(celsius * 10);
 }
 
-heatpumpSettings updateHeatpumpFromHttpQueryParameters(std::unique_ptr<WebServer> const &httpServer, std::unique_ptr<HeatPump> const &hp, heatpumpSettings settings)
+bool updateHeatpumpFromHttpQueryParameters(WebServer &server, uint8_t unit, heatpumpSettings &settings)
 {
-
-    bool update = false;
-    if (httpServer->hasArg("PWRCHK"))
+    // Checked before anything is submitted, so that a bad request changes nothing
+    uint16_t temperature = server.hasArg("TEMP") ? temperatureArg(server.arg("TEMP")) : 0;
+    if (server.hasArg("TEMP") && !settingValueValid(HOLDING_REG_TEMPERATURE_INDEX, temperature))
     {
-        settings.power = httpServer->arg("POWER") ? "ON" : "OFF";
-        update = true;
+        return false;
     }
-    if (httpServer->hasArg("MODE"))
+    if (server.hasArg("PWRCHK"))
     {
-        settings.mode = httpServer->arg("MODE").c_str();
-        update = true;
+        // Unchecked checkboxes are not submitted
+        settings.power = server.hasArg("POWER") ? "ON" : "OFF";
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_POWER_INDEX, POWER_ENUM.fromStr(settings.power));
     }
-    if (httpServer->hasArg("TEMP"))
+    else if (const char *power = enumArg(server, "POWER", POWER_ENUM))
     {
-        settings.temperature = httpServer->arg("TEMP").toInt();
-        update = true;
+        settings.power = power;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_POWER_INDEX, POWER_ENUM.fromStr(power));
     }
-    if (httpServer->hasArg("FAN"))
+    if (const char *mode = enumArg(server, "MODE", MODE_ENUM))
     {
-        settings.fan = httpServer->arg("FAN").c_str();
-        update = true;
+        settings.mode = mode;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_MODE_INDEX, MODE_ENUM.fromStr(mode));
     }
-    if (httpServer->hasArg("VANE"))
+    if (server.hasArg("TEMP"))
     {
-        settings.vane = httpServer->arg("VANE").c_str();
-        update = true;
+        settings.temperature = temperature / 10;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_TEMPERATURE_INDEX, temperature);
     }
-    if (httpServer->hasArg("WIDEVANE"))
+    if (const char *fan = enumArg(server, "FAN", FAN_ENUM))
     {
-        settings.wideVane = httpServer->arg("WIDEVANE").c_str();
-        update = true;
+        settings.fan = fan;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_FAN_INDEX, FAN_ENUM.fromStr(fan));
     }
-    if (update)
+    if (const char *vane = enumArg(server, "VANE", VANE_ENUM))
     {
-#ifdef DEBUG
-        DEBUG_PRINTLN("In debug mode, not syncing/connecting heat pump");
-#else
-        hp->setSettings(settings);
-        hp->update();
-#endif
+        settings.vane = vane;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_VANE_INDEX, VANE_ENUM.fromStr(vane));
+    }
+    if (const char *wideVane = enumArg(server, "WIDEVANE", WIDEVANE_ENUM))
+    {
+        settings.wideVane = wideVane;
+        submitCommand(COMMAND_SOURCE_HTTP, unit, HOLDING_REG_WIDEVANE_INDEX, WIDEVANE_ENUM.fromStr(wideVane));
     }
-    return settings;
+    return true;
 }
@@ -1,7 +1,6 @@
 #ifndef WebUI_H__
 #define WebUI_H__
 
-#include <memory>
 #include <Arduino.h>
 #include <HeatPump.h>
 #ifdef ESP8266
@@ -12,15 +11,44 @@
 #endif
 #include "utils.h"
 #include "constants.h"
+#include "heap_monitor.h"
+#include "snapshot.h"
+#include "timer_wheel.h"
 
-#define WEB_UI_REFRESH_RATE_SECS "10"
+// Fits the JSON state with the longest setting strings
+#define WEB_UI_STATE_JSON_SIZE 320
+// Browsers subscribed to /api/events at the same time
+#define WEB_UI_EVENT_CLIENTS 3
+// Idle event streams get a comment line this often
+#define WEB_UI_EVENT_KEEPALIVE_MILLIS 15000
 
 ///
 /// HTTP Server
 /// Adapted from https://github.com/SwiCago/HeatPump/blob/master/examples/HP_cntrl_Fancy_web/HP_cntrl_Fancy_web.ino
 ///
 
-String template_html(unsigned long prevHeatpumpComms, std::unique_ptr<HeatPump> &hp, const heatpumpSettings settings, const String &var);
-heatpumpSettings updateHeatpumpFromHttpQueryParameters(std::unique_ptr<WebServer> const &httpServer, std::unique_ptr<HeatPump> const &hp, heatpumpSettings settings);
+// Static page embedded at build time (scripts/embed_web_ui.py), gzipped with ETag revalidation.
+// The If-None-Match request header must be collected.
+void sendWebUI(WebServer &server);
+// Current state as JSON, for /api/state and /api/set
+void sendStateJson(WebServer &server, const HeatpumpSnapshot &snapshot, const heatpumpSettings &settings);
+// Loop stage timings, see profiler.h
+void sendProfileJson(WebServer &server);
+// Heap figures, lows and history, see heap_monitor.h
+void sendHeapJson(WebServer &server);
+// When each startup phase was reached, see boot_timeline.h
+void sendBootJson(WebServer &server);
+// Timers of the given wheels with their periods, as JSON
+void sendTimersJson(WebServer &server, TimerWheel *const wheels[], size_t count);
+// Keeps the current request open as a Server-Sent Events stream. False if all slots are taken.
+bool addEventClient(WebServer &server, const HeatpumpSnapshot &snapshot);
+// Pushes the state to event subscribers when the snapshot changed
+void webUIEventsLoop(const HeatpumpSnapshot &snapshot);
+// Closes the event streams, before the server goes away
+void webUIEventsStop();
+// Submits a command to unit for each setting given in the request (see
+// commands.h) and applies the requested values to settings. False, with
+// nothing submitted, if the temperature is not a number in range.
+bool updateHeatpumpFromHttpQueryParameters(WebServer &server, uint8_t unit, heatpumpSettings &settings);
 
 #endif // WebUI_H__
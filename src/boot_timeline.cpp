@@ -0,0 +1,49 @@
+#include <atomic>
+#include <Arduino.h>
+#include "boot_timeline.h"
+#include "debug_utils.h"
+
+static const char *const PHASE_NAMES[BOOT_PHASE_LEN] = {
+    "setup", "setup_done", "heatpump_connected", "heatpump_contact", "wifi_connected",
+    "network_started", "modbus_connected", "modbus_first_write", "modbus_first_read"};
+
+static uint32_t marks[BOOT_PHASE_LEN];
+// Bit per phase, set once its mark is written
+static std::atomic<uint32_t> reached(0);
+static_assert(BOOT_PHASE_LEN <= 32, "One bit per boot phase");
+
+void bootMark(BootPhase phase)
+{
+    if (bootReached(phase))
+    {
+        return;
+    }
+    marks[phase] = millis();
+    reached.fetch_or(1UL << phase, std::memory_order_release);
+    LOG_PRINTF(LOG_INFO, "Boot: %s at %lu ms", bootPhaseName(phase), (unsigned long)marks[phase]);
+}
+
+bool bootReached(BootPhase phase)
+{
+    return phase < BOOT_PHASE_LEN && (reached.load(std::memory_order_acquire) & (1UL << phase));
+}
+
+uint32_t bootMillis(BootPhase phase)
+{
+    return bootReached(phase) ? marks[phase] : 0;
+}
+
+const char *bootPhaseName(BootPhase phase)
+{
+    return phase < BOOT_PHASE_LEN ? PHASE_NAMES[phase] : "";
+}
+
+uint16_t bootRegister(uint16_t offset)
+{
+    BootPhase phase = BootPhase(offset / 2);
+    if (!bootReached(phase))
+    {
+        return 0xFFFF;
+    }
+    return offset % 2 == 0 ? marks[phase] >> 16 : marks[phase] & 0xFFFF;
+}
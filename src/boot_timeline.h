@@ -0,0 +1,47 @@
+#ifndef BOOT_TIMELINE_H__
+#define BOOT_TIMELINE_H__
+
+#include <stdint.h>
+
+///
+/// When each startup phase was first reached, in millis() since reset.
+/// Phases are marked once and keep their time until the next boot, so
+/// e.g. a WiFi reconnect does not move wifi_connected. Served at /api/boot
+/// and as Modbus input registers.
+///
+enum BootPhase : uint8_t
+{
+    // setup() entered, after the SDK and core started up
+    BOOT_SETUP,
+    BOOT_SETUP_DONE,
+    // First HeatPump::connect() that succeeded, of any unit
+    BOOT_HEATPUMP_CONNECTED,
+    // First successful update(), the heat pump state is known
+    BOOT_HEATPUMP_CONTACT,
+    BOOT_WIFI_CONNECTED,
+    // OTA, HTTP and the Modbus server are up
+    BOOT_NETWORK_STARTED,
+    // First connection to a remote Modbus server, and the first completed
+    // write to and read from one
+    BOOT_MODBUS_CONNECTED,
+    BOOT_MODBUS_FIRST_WRITE,
+    BOOT_MODBUS_FIRST_READ,
+    BOOT_PHASE_LEN
+};
+
+///
+/// Modbus input register view, two registers per phase in phase order:
+/// millis() high word first, 0xFFFF 0xFFFF while not reached.
+///
+#define BOOT_REGS_LEN (BOOT_PHASE_LEN * 2)
+
+// Records millis() for phase unless it was reached before. Each phase
+// must be marked from one task only.
+void bootMark(BootPhase phase);
+bool bootReached(BootPhase phase);
+// 0 if not reached
+uint32_t bootMillis(BootPhase phase);
+const char *bootPhaseName(BootPhase phase);
+uint16_t bootRegister(uint16_t offset);
+
+#endif // BOOT_TIMELINE_H__
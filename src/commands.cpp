@@ -0,0 +1,80 @@
+#include <atomic>
+#include <Arduino.h>
+#include "commands.h"
+#include "constants.h"
+#include "debug_utils.h"
+#include "lockfree.h"
+#include "metrics.h"
+
+static const char *const SOURCE_NAMES[COMMAND_SOURCE_LEN] = {"plc", "modbus", "http", "system"};
+
+// Producers are several tasks with ESP32_TASKS, loop() otherwise
+#if TASKS_ENABLED
+static MpscQueue<HeatpumpCommand, COMMAND_QUEUE_SIZE> queue;
+#else
+static SpscQueue<HeatpumpCommand, COMMAND_QUEUE_SIZE> queue;
+#endif
+static PendingCommand pendingCommands[HEATPUMP_UNITS][HOLDING_LEN];
+static std::atomic<unsigned long> lastSubmitMillis(0);
+
+bool submitCommand(CommandSource source, uint8_t unit, uint8_t address, uint16_t value)
+{
+    lastSubmitMillis.store(millis(), std::memory_order_relaxed);
+    if (!queue.push({millis(), value, address, unit, source}))
+    {
+        LOG_THROTTLED(LOG_WARNING, 1000, 1, "Command queue full, dropped %s write of %u to register %u of unit %u",
+                      commandSourceName(source), value, address, unit);
+        return false;
+    }
+    return true;
+}
+
+static void merge(const HeatpumpCommand &command)
+{
+    PendingCommand &pending = pendingCommands[command.unit][command.address];
+    if (pending.pending)
+    {
+        if (command.source < pending.source || long(command.millis - pending.millis) < 0)
+        {
+            metricInc(COUNTER_COMMANDS_REJECTED);
+            LOG_PRINTF(LOG_INFO, "Ignoring %s write of %u to register %u of unit %u, %s write of %u pending",
+                       commandSourceName(command.source), command.value, command.address, command.unit,
+                       commandSourceName(pending.source), pending.value);
+            return;
+        }
+        metricInc(COUNTER_COMMANDS_SUPERSEDED);
+    }
+    pending = {command.millis, command.value, command.source, true};
+}
+
+void commandsReceive()
+{
+    HeatpumpCommand command;
+    while (queue.pop(command))
+    {
+        if (command.unit < HEATPUMP_UNITS && command.address < HOLDING_LEN)
+        {
+            merge(command);
+        }
+    }
+}
+
+unsigned long commandLastSubmitMillis()
+{
+    return lastSubmitMillis.load(std::memory_order_relaxed);
+}
+
+const PendingCommand &commandPending(uint8_t unit, uint8_t address)
+{
+    return pendingCommands[unit][address];
+}
+
+void commandDone(uint8_t unit, uint8_t address)
+{
+    pendingCommands[unit][address].pending = false;
+}
+
+const char *commandSourceName(CommandSource source)
+{
+    return source < COMMAND_SOURCE_LEN ? SOURCE_NAMES[source] : "";
+}
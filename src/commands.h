@@ -0,0 +1,83 @@
+#ifndef COMMANDS_H__
+#define COMMANDS_H__
+
+#include <stdint.h>
+#include "registers.h"
+
+///
+/// Settings changes on their way to the heat pump. Modbus server writes,
+/// the PLC power command and the web UI submit commands; the heat pump side
+/// applies them right before its next update(). Only that side touches
+/// HeatPump, which is what lets it run in a task of its own (ESP32_TASKS).
+///
+/// Commands are merged per unit and field (holding register) into a
+/// pending set:
+/// - a newer command replaces the pending one (last writer wins),
+/// - unless the pending one comes from a source of higher priority, which
+///   keeps the field until it has been applied,
+/// - and a command older than the pending one is ignored.
+/// The heat pump side sets every pending field and then calls update()
+/// once, so changes from several sources go out in one serial exchange. A
+/// field stays pending until the heat pump reports the value, and is given
+/// up after COMMAND_MAX_AGE_MILLIS.
+///
+
+// Commands waiting to be merged, power of two
+#define COMMAND_QUEUE_SIZE 16
+// Pending fields the heat pump does not take within this time are dropped
+#define COMMAND_MAX_AGE_MILLIS 60000
+
+// In increasing priority
+enum CommandSource : uint8_t
+{
+    // Power command read from the remote Modbus server
+    COMMAND_SOURCE_PLC,
+    // Writes by Modbus server clients
+    COMMAND_SOURCE_MODBUS,
+    // The web UI and /api/set
+    COMMAND_SOURCE_HTTP,
+    // The firmware itself, e.g. switching off before a restart
+    COMMAND_SOURCE_SYSTEM,
+    COMMAND_SOURCE_LEN
+};
+
+struct HeatpumpCommand
+{
+    // millis() at submission
+    unsigned long millis;
+    // Register value, already validated
+    uint16_t value;
+    // A REG_READ_WRITE holding register
+    uint8_t address;
+    // Indoor unit, below HEATPUMP_UNITS
+    uint8_t unit;
+    CommandSource source;
+};
+
+struct PendingCommand
+{
+    unsigned long millis;
+    uint16_t value;
+    CommandSource source;
+    bool pending;
+};
+
+// Queues a command, from any task. False if the queue is full and the
+// command was dropped.
+bool submitCommand(CommandSource source, uint8_t unit, uint8_t address, uint16_t value);
+// millis() of the last submitCommand(), 0 for none. From any task.
+unsigned long commandLastSubmitMillis();
+
+//
+// Heat pump side
+//
+
+// Merges queued commands into the pending set
+void commandsReceive();
+// Pending state of the field at a holding register address of unit
+const PendingCommand &commandPending(uint8_t unit, uint8_t address);
+// The field has been applied or given up, see commandPending()
+void commandDone(uint8_t unit, uint8_t address);
+const char *commandSourceName(CommandSource source);
+
+#endif // COMMANDS_H__
@@ -6,6 +6,9 @@
 
 #define VERSION "2020-10-13"
 #define SYSLOG_LOGGING_ENABLED 1
+// Least important syslog severity logged, anything below is compiled out:
+// 3 errors, 4 warnings, 5 notices, 6 info, 7 debug
+#define LOG_LEVEL 7
 
 // Syslog server connection info
 #define SYSLOG_SERVER "192.168.8.2"
@@ -16,6 +19,11 @@
 // try to connect in setup for this long before 
 // shutting down the pump and restarting
 #define WIFI_RETRY_MILLIS 20000
+// How often the WiFi connection is checked
+#define WIFI_CHECK_INTERVAL_MILLIS 500
+// and while it is associating, so that the network side starts as soon as
+// it is up
+#define WIFI_CONNECT_POLL_MILLIS 50
 
 #define RESET_COUNT 5
 #define RESET_TIMEOUT_MILLIS 5000
@@ -26,30 +34,125 @@
 #elif defined(ESP32)
 #define CHIP_ID ((uint16_t)(ESP.getEfuseMac()>>32))
 #endif
-#define ESP_NAME String("MitsuRemote-ESP_" + String(CHIP_ID) + String("v") + String(VERSION)).c_str()
+// Host name: ESP_NAME_FORMAT with CHIP_ID and VERSION, see espName()
+#define ESP_NAME_FORMAT "MitsuRemote-ESP_%luv%s"
+#define ESP_NAME_MAX 48
 
 
+// Indoor units driven by this ESP, each on its own UART. More than one
+// (gateway mode) needs an ESP32. Modbus server unit id N addresses unit
+// N - 1; on the remote Modbus server unit N's block starts at register
+// N * REMOTE_MODBUS_UNIT_OFFSET. The native_gateway host build sets 3.
+#ifndef HEATPUMP_UNITS
+#define HEATPUMP_UNITS 1
+#endif
+
 #ifdef ESP8266
 // One and only UART: UART 0
 #define HEATPUMP_UART 0
+// Host builds simulate all three
+#define HEATPUMP_UARTS {HEATPUMP_UART, 1, 2}
 #elif defined(ESP32)
 // Use UART1 for heatpump, allowing UART0 for terminal
 // UART 1, GPIO 9 & 10 for RX/TX. GPIO9="D2", GPIO10="""
 #define HEATPUMP_UART 1
+// Further units: UART 2 on GPIO 16 & 17 for RX/TX, then UART 0, which
+// takes the terminal
+#define HEATPUMP_UARTS {HEATPUMP_UART, 2, 0}
+#endif
+
+#if defined(ESP8266) && HEATPUMP_UNITS > 1 && !defined(NATIVE_BENCH)
+#error "Several heat pumps (HEATPUMP_UNITS) need an ESP32"
 #endif
 
-#if defined(DEBUG) || ( defined(ESP32) && HEATPUMP_UART != 0 )
+#if defined(DEBUG) || ( defined(ESP32) && HEATPUMP_UART != 0 && HEATPUMP_UNITS < 3 )
 #define SERIAL_FREE_FOR_PRINT
 #endif
 
 #include "secrets.h"
 
+// Remote Modbus servers, e.g. a PLC and its hot standby, as
+// { {ip, port}, ... } with a different ip each. The state is written to
+// all of them, the power command is read from the first one at least
+// REMOTE_MODBUS_HEALTHY. Define it in secrets.h; by default it is
+// REMOTE_MODBUS_IP alone.
+#ifndef REMOTE_MODBUS_TARGETS
+#define REMOTE_MODBUS_TARGETS {{REMOTE_MODBUS_IP, REMOTE_MODBUS_PORT}}
+#endif
+// Each target's health, 0 to 100, moves a quarter of the way to 100 with
+// every completed transaction and to 0 with every failed one, so it drops
+// below 50 after three failures in a row and comes back after three
+// successes
+#define REMOTE_MODBUS_HEALTHY 50
 #define REMOTE_MODBUS_UNIT_ID ((uint8_t)1)
+// Registers between the blocks of consecutive units, see HEATPUMP_UNITS
+#define REMOTE_MODBUS_UNIT_OFFSET 100
 #define REMOTE_MODBUS_WRITE_INTERVAL_MILLIS 1000
+// Longest a connection attempt to a remote server may hold loop() (the
+// Modbus task with ESP32_TASKS). A PLC on the LAN answers within a few ms.
+#define REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS 200
 #define REMOTE_MODBUS_READ_INTERVAL_MILLIS 1000
+// Random delay of up to this much on each read and write, so that they do
+// not stay in step with the PLC scan cycle
+#define REMOTE_MODBUS_JITTER_MILLIS 50
+// Write only registers that changed since the last acknowledged write,
+// and the whole block every REMOTE_MODBUS_FULL_REFRESH_MILLIS.
+// TIMEOUT, the PLC's watchdog, is still reset on every write, and
+// MILLIS_SINCE_LAST_COMMS only written on full refresh.
+#define REMOTE_MODBUS_DELTA_WRITES true
+#define REMOTE_MODBUS_FULL_REFRESH_MILLIS 10000
+// Combine the command read and the state write into one FC23 transaction.
+// Falls back to separate FC03 + FC06/FC16 if the server rejects FC23 or
+// keeps failing it. Off by default: not every PLC or gateway has FC23.
+#ifndef REMOTE_MODBUS_FC23
+#define REMOTE_MODBUS_FC23 false
+#endif
+// Also read temperature, mode, fan and vane commands from the remote
+// server, registers 12 to 16 (see the top of main.cpp). Off by default:
+// a PLC that leaves them at 0 would command HEAT mode, fan AUTO and vane
+// AUTO. The native_setpoints host build turns it on.
+#ifndef REMOTE_MODBUS_SETPOINTS
+#define REMOTE_MODBUS_SETPOINTS false
+#endif
 
+// Time loop() stages, see profiler.h. Served at /api/profile and as
+// Modbus input registers.
+#define LOOP_PROFILER_ENABLED true
+
+// Low memory mode: once the largest free heap block drops below this, the
+// HTTP server is stopped to keep Modbus and the heat pump going, and the
+// ESP restarts at the next quiet moment. See heap_monitor.h.
+#define LOW_MEMORY_BLOCK_BYTES 4096
+// A quiet moment has no settings change for this long
+#define LOW_MEMORY_QUIET_MILLIS 30000
+// Restart anyway when no quiet moment comes within this time
+#define LOW_MEMORY_RESTART_MAX_WAIT_MILLIS 600000
+
+// ESP32 only: run the heat pump, Modbus and HTTP/OTA/logging in separate
+// FreeRTOS tasks instead of one loop(), so that network stalls cannot delay
+// heat pump serial traffic. See the tasks section at the end of main.cpp.
+#define ESP32_TASKS true
+#if defined(ESP32) && ESP32_TASKS
+#define TASKS_ENABLED true
+#else
+#define TASKS_ENABLED false
+#endif
+
+// The native_modbus_load host build turns the server on
+#ifndef MODBUS_SERVER_ENABLED
 #define MODBUS_SERVER_ENABLED false
+#endif
 #define MODBUS_CLIENT_ENABLED true
 #define HTTP_SERVER_ENABLED true
 
+// Modbus server connection limit, see modbus_server.h. Each connection
+// takes a MODBUS_ADU_MAX receive buffer.
+#define MODBUS_SERVER_MAX_CLIENTS 4
+// Longest the server may hold up loop() per pass, when requests are waiting
+#define MODBUS_SERVER_SLICE_MICROS 2000
+// Connections without a request for this long are closed
+#define MODBUS_SERVER_IDLE_MILLIS 60000
+// With all connections taken, a new one replaces one idle this long
+#define MODBUS_SERVER_EVICT_IDLE_MILLIS 10000
+
 #endif // CONSTANTS_H__
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <memory>
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+#include <WiFiUdp.h>
+#include "debug_utils.h"
+#include "utils.h"
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+static_assert(LOG_RECORD_MAX <= 255, "record length is stored in one byte");
+static_assert(LOG_DATAGRAM_SIZE > LOG_RECORD_MAX + 32, "a datagram must fit the longest record and a drop notice");
+
+static WiFiUDP udpClient;
+// Syslog keeps the pointer, the name must outlive it
+static char syslogHostname[ESP_NAME_MAX];
+static std::unique_ptr<Syslog> syslog;
+
+///
+/// Ring of records, each a flags byte, a length byte and the text.
+/// Positions run freely and are masked on access. Only the logging side
+/// moves ringHead and only logFlush() moves ringTail, so neither needs a
+/// lock. With ESP32_TASKS several tasks log, and appends take a short
+/// spinlock against each other; logFlush() still takes none.
+///
+static uint8_t ring[LOG_BUFFER_SIZE];
+static std::atomic<uint32_t> ringHead(0);
+static std::atomic<uint32_t> ringTail(0);
+static std::atomic<uint32_t> dropped(0);
+static uint32_t droppedReported;
+#if TASKS_ENABLED
+static portMUX_TYPE appendMux = portMUX_INITIALIZER_UNLOCKED;
+#define APPEND_LOCK() portENTER_CRITICAL(&appendMux)
+#define APPEND_UNLOCK() portEXIT_CRITICAL(&appendMux)
+#else
+#define APPEND_LOCK()
+#define APPEND_UNLOCK()
+#endif
+
+static void ringWrite(uint32_t pos, const uint8_t *data, size_t len)
+{
+    size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+    size_t first = std::min(len, LOG_BUFFER_SIZE - offset);
+    memcpy(ring + offset, data, first);
+    memcpy(ring, data + first, len - first);
+}
+
+static void ringRead(uint32_t pos, uint8_t *data, size_t len)
+{
+    size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+    size_t first = std::min(len, LOG_BUFFER_SIZE - offset);
+    memcpy(data, ring + offset, first);
+    memcpy(data + first, ring, len - first);
+}
+
+void logAppend(uint8_t flags, const char *text, size_t len)
+{
+    len = std::min(len, size_t(LOG_RECORD_MAX));
+    APPEND_LOCK();
+    uint32_t head = ringHead.load(std::memory_order_relaxed);
+    uint32_t tail = ringTail.load(std::memory_order_acquire);
+    if (LOG_BUFFER_SIZE - (head - tail) < len + 2)
+    {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        const uint8_t header[2] = {flags, uint8_t(len)};
+        ringWrite(head, header, 2);
+        ringWrite(head + 2, reinterpret_cast<const uint8_t *>(text), len);
+        ringHead.store(head + 2 + len, std::memory_order_release);
+    }
+    APPEND_UNLOCK();
+}
+
+void logPrintf(uint8_t flags, const char *format, ...)
+{
+    char buf[LOG_RECORD_MAX + 1];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len > 0)
+    {
+        logAppend(flags, buf, std::min(len, LOG_RECORD_MAX));
+    }
+}
+
+bool logThrottleAllow(LogThrottle &throttle, uint16_t periodMillis, uint8_t burst)
+{
+    unsigned long now = millis();
+    if (!throttle.started)
+    {
+        throttle.started = true;
+        throttle.tokens = burst;
+        throttle.lastRefill = now;
+    }
+    unsigned long refills = periodMillis == 0 ? burst : (now - throttle.lastRefill) / periodMillis;
+    if (refills > 0)
+    {
+        throttle.tokens = std::min<unsigned long>(burst, throttle.tokens + refills);
+        throttle.lastRefill = throttle.tokens == burst ? now : throttle.lastRefill + refills * periodMillis;
+    }
+    if (throttle.tokens == 0)
+    {
+        if (throttle.suppressed < UINT16_MAX)
+        {
+            throttle.suppressed++;
+        }
+        return false;
+    }
+    throttle.tokens--;
+    return true;
+}
+
+void logThrottledAppend(uint8_t flags, LogThrottle &throttle, const char *text, size_t len)
+{
+    if (throttle.suppressed == 0)
+    {
+        logAppend(flags, text, len);
+        return;
+    }
+    char suffix[24];
+    int suffixLen = snprintf(suffix, sizeof(suffix), " [%u suppressed]", unsigned(throttle.suppressed));
+    throttle.suppressed = 0;
+    // The count survives long text, the text is cut instead
+    char buf[LOG_RECORD_MAX];
+    len = std::min(len, size_t(LOG_RECORD_MAX - suffixLen));
+    memcpy(buf, text, len);
+    memcpy(buf + len, suffix, suffixLen);
+    logAppend(flags, buf, len + suffixLen);
+}
+
+void logThrottledPrintf(uint8_t flags, LogThrottle &throttle, const char *format, ...)
+{
+    char buf[LOG_RECORD_MAX + 1];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len > 0)
+    {
+        logThrottledAppend(flags, throttle, buf, std::min(len, LOG_RECORD_MAX));
+    }
+}
+
+static void logSend(uint8_t severity, char *datagram, size_t len)
+{
+#ifdef SERIAL_FREE_FOR_PRINT
+    Serial.write(reinterpret_cast<const uint8_t *>(datagram), len);
+#endif
+#ifdef SYSLOG_LOGGING_ENABLED
+    if (!syslog)
+    {
+        espName(syslogHostname, sizeof(syslogHostname));
+        syslog.reset(new Syslog(udpClient, SYSLOG_SERVER, SYSLOG_PORT, syslogHostname, SYSLOG_APP_NAME));
+    }
+    // Syslog lines do not end in a newline
+    if (len > 0 && datagram[len - 1] == '\n')
+    {
+        len--;
+    }
+    datagram[len] = '\0';
+    syslog->log(severity, datagram);
+#endif
+}
+
+uint8_t logFlush(uint8_t maxDatagrams)
+{
+#ifdef SYSLOG_LOGGING_ENABLED
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        return 0;
+    }
+#endif
+    char datagram[LOG_DATAGRAM_SIZE + 1];
+    uint8_t sent = 0;
+    while (sent < maxDatagrams)
+    {
+        size_t len = 0;
+        uint8_t severity = LOG_DEBUG;
+        uint32_t lost = dropped.load(std::memory_order_relaxed) - droppedReported;
+        if (lost > 0)
+        {
+            len = snprintf(datagram, LOG_DATAGRAM_SIZE, "<%lu log records dropped>\n", (unsigned long)lost);
+            droppedReported += lost;
+            severity = LOG_WARNING;
+        }
+        uint32_t tail = ringTail.load(std::memory_order_relaxed);
+        uint32_t head = ringHead.load(std::memory_order_acquire);
+        while (tail != head)
+        {
+            uint8_t header[2];
+            ringRead(tail, header, 2);
+            if (len + header[1] + 1 > LOG_DATAGRAM_SIZE)
+            {
+                break;
+            }
+            ringRead(tail + 2, reinterpret_cast<uint8_t *>(datagram + len), header[1]);
+            len += header[1];
+            if (header[0] & LOG_NEWLINE)
+            {
+                datagram[len++] = '\n';
+            }
+            severity = std::min(severity, uint8_t(header[0] & LOG_SEVERITY_MASK));
+            tail += 2 + header[1];
+        }
+        ringTail.store(tail, std::memory_order_release);
+        if (len == 0)
+        {
+            break;
+        }
+        logSend(severity, datagram, len);
+        sent++;
+    }
+    return sent;
+}
+
+void logFlushAll()
+{
+    while (logFlush() == LOG_FLUSH_DATAGRAMS)
+    {
+    }
+}
+
+uint32_t logDroppedCount()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -1,55 +1,116 @@
 #ifndef DEBUG_UTILS_H__
 #define DEBUG_UTILS_H__
 
-#include "constants.h"
+#include <type_traits>
+#include <Arduino.h>
 #include <Syslog.h>
-#include <WiFiUdp.h>
+#include "constants.h"
 
-unsigned long __lastDebugThrottled[50];
-#define DEBUG_PRINT_THROTTLED(i, msg)              \
-    if (millis() - __lastDebugThrottled[i] > 1000) \
-    {                                              \
-        DEBUG_PRINT(msg);                          \
-        __lastDebugThrottled[i] = millis();        \
-    }
-#define DEBUG_PRINTLN_THROTTLED(i, msg)            \
-    if (millis() - __lastDebugThrottled[i] > 1000) \
-    {                                              \
-        DEBUG_PRINTLN(msg);                        \
-        __lastDebugThrottled[i] = millis();        \
-    }
+///
+/// Logging. Records are appended to a fixed-size ring buffer and sent
+/// periodically by logFlush(), several records per datagram.
+/// Logging never waits for the network: when the buffer is full, new
+/// records are dropped and counted, and the count is reported in the next
+/// datagram.
+///
+/// Levels are syslog severities (LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG).
+/// Anything less severe than LOG_LEVEL is compiled out, arguments included.
+///
 
-WiFiUDP udpClient;
-std::unique_ptr<Syslog> syslog(new Syslog(udpClient, SYSLOG_SERVER, SYSLOG_PORT, ESP_NAME, SYSLOG_APP_NAME));
+// Bytes of records waiting to be sent, power of two
+#define LOG_BUFFER_SIZE 2048
+// Longer records are truncated
+#define LOG_RECORD_MAX 160
+// Records are packed into datagrams of at most this many bytes
+#define LOG_DATAGRAM_SIZE 512
+// Records are sent this often, at most LOG_FLUSH_DATAGRAMS datagrams at a time
+#define LOG_FLUSH_INTERVAL_MILLIS 50
+#define LOG_FLUSH_DATAGRAMS 2
 
-#ifdef SYSLOG_LOGGING_ENABLED
-#define SYSLOG(x)                                        \
-    if (syslog)                                          \
-    {                                                    \
-        syslog->logf(LOG_INFO, "%s", String(x).c_str()); \
-        yield();                                         \
-    }
+#if defined(SYSLOG_LOGGING_ENABLED) || defined(SERIAL_FREE_FOR_PRINT)
+#define LOG_OUTPUT_ENABLED true
 #else
-#define SYSLOG(x)
+#define LOG_OUTPUT_ENABLED false
 #endif
+#define LOG_ENABLED(level) (LOG_OUTPUT_ENABLED && (level) <= LOG_LEVEL)
 
-// With ESP32 we are free to use Serial for printing
-// when we use UART1 or UART2 for heatpump
-#ifdef SERIAL_FREE_FOR_PRINT
-#define DEBUG_PRINTLN(x)   \
-    {                      \
-        Serial.println(x); \
-        SYSLOG(x)          \
+// Record flags: severity in the low bits, line ends after the record
+#define LOG_SEVERITY_MASK 0x07
+#define LOG_NEWLINE 0x80
+
+void logAppend(uint8_t flags, const char *text, size_t len);
+void logPrintf(uint8_t flags, const char *format, ...) __attribute__((format(printf, 2, 3)));
+inline void logAppend(uint8_t flags, const char *text) { logAppend(flags, text, strlen(text)); }
+inline void logAppend(uint8_t flags, const String &text) { logAppend(flags, text.c_str(), text.length()); }
+inline void logAppend(uint8_t flags, char c) { logAppend(flags, &c, 1); }
+// Numbers come out as String(value) would have them, without allocating
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type logAppend(uint8_t flags, T value)
+{
+    if (std::is_signed<T>::value)
+        logPrintf(flags, "%lld", (long long)value);
+    else
+        logPrintf(flags, "%llu", (unsigned long long)value);
+}
+inline void logAppend(uint8_t flags, double value) { logPrintf(flags, "%.2f", value); }
+// Sends up to maxDatagrams datagrams of buffered records. Records are kept
+// while the network is down. Returns the number of datagrams sent.
+uint8_t logFlush(uint8_t maxDatagrams = LOG_FLUSH_DATAGRAMS);
+// Sends everything that can be sent, before a restart
+void logFlushAll();
+// Records dropped because the buffer was full, since boot
+uint32_t logDroppedCount();
+
+#define LOG_PRINT(level, x)       \
+    if (LOG_ENABLED(level))       \
+    {                             \
+        logAppend((level), (x));  \
     }
-#define DEBUG_PRINT(x)   \
-    {                    \
-        Serial.print(x); \
-        SYSLOG(x)        \
+#define LOG_PRINTLN(level, x)                  \
+    if (LOG_ENABLED(level))                    \
+    {                                          \
+        logAppend((level) | LOG_NEWLINE, (x)); \
     }
-#else
-#define DEBUG_PRINTLN(x) SYSLOG(x)
-#define DEBUG_PRINT(x) SYSLOG(x)
-#endif
+#define LOG_PRINTF(level, ...)                         \
+    if (LOG_ENABLED(level))                            \
+    {                                                  \
+        logPrintf((level) | LOG_NEWLINE, __VA_ARGS__); \
+    }
+
+#define DEBUG_PRINT(x) LOG_PRINT(LOG_DEBUG, x)
+#define DEBUG_PRINTLN(x) LOG_PRINTLN(LOG_DEBUG, x)
+
+///
+/// Rate limiting per call site. Each LOG_THROTTLED() expands to its own
+/// static LogThrottle, a token bucket that allows burst records at once
+/// and refills one token every periodMillis. Suppressed records are
+/// counted and the count is appended to the next record that gets through.
+///
+struct LogThrottle
+{
+    unsigned long lastRefill;
+    uint16_t suppressed;
+    uint8_t tokens;
+    bool started;
+};
+
+// Takes a token if there is one, otherwise counts the record as suppressed
+bool logThrottleAllow(LogThrottle &throttle, uint16_t periodMillis, uint8_t burst);
+// Like logAppend() and logPrintf(), with the suppressed count of throttle appended
+void logThrottledAppend(uint8_t flags, LogThrottle &throttle, const char *text, size_t len);
+void logThrottledPrintf(uint8_t flags, LogThrottle &throttle, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define LOG_THROTTLED(level, periodMillis, burst, ...)                                 \
+    if (LOG_ENABLED(level))                                                            \
+    {                                                                                  \
+        static LogThrottle __logThrottle;                                              \
+        if (logThrottleAllow(__logThrottle, (periodMillis), (burst)))                  \
+        {                                                                              \
+            logThrottledPrintf((level) | LOG_NEWLINE, __logThrottle, __VA_ARGS__);    \
+        }                                                                              \
+    }
+// At most one line per second from the call site
+#define DEBUG_PRINTF_THROTTLED(...) LOG_THROTTLED(LOG_DEBUG, 1000, 1, __VA_ARGS__)
 
 class DEBUG_SCOPE
 {
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <Arduino.h>
+#include "constants.h"
+#include "heap_monitor.h"
+
+static HeapSample history[HEAP_HISTORY_LEN];
+// Next slot to write, and samples recorded so far up to HEAP_HISTORY_LEN
+static uint8_t historyNext;
+static uint8_t historyLen;
+static unsigned long lastSampleMillis;
+static bool sampled;
+static HeapSample last;
+static uint32_t lowestFree = UINT32_MAX;
+static uint32_t lowestMaxBlock = UINT32_MAX;
+static bool low;
+
+HeapSample heapRead()
+{
+    HeapSample sample;
+    sample.uptimeSeconds = millis() / 1000;
+    sample.freeBytes = ESP.getFreeHeap();
+#ifdef ESP8266
+    sample.maxBlockBytes = ESP.getMaxFreeBlockSize();
+#elif defined(ESP32)
+    sample.maxBlockBytes = ESP.getMaxAllocHeap();
+#endif
+    sample.fragmentation = sample.freeBytes == 0 ? 0 : 100 - uint64_t(sample.maxBlockBytes) * 100 / sample.freeBytes;
+    return sample;
+}
+
+HeapSample heapCheck()
+{
+    last = heapRead();
+    lowestFree = std::min(lowestFree, last.freeBytes);
+    lowestMaxBlock = std::min(lowestMaxBlock, last.maxBlockBytes);
+    low = low || last.maxBlockBytes < LOW_MEMORY_BLOCK_BYTES;
+    if (!sampled || millis() - lastSampleMillis >= HEAP_SAMPLE_INTERVAL_MILLIS)
+    {
+        sampled = true;
+        lastSampleMillis = millis();
+        history[historyNext] = last;
+        historyNext = (historyNext + 1) % HEAP_HISTORY_LEN;
+        historyLen = std::min(historyLen + 1, HEAP_HISTORY_LEN);
+    }
+    return last;
+}
+
+uint32_t heapLowestFree()
+{
+    return lowestFree == UINT32_MAX ? 0 : lowestFree;
+}
+
+uint32_t heapLowestMaxBlock()
+{
+    return lowestMaxBlock == UINT32_MAX ? 0 : lowestMaxBlock;
+}
+
+bool heapLow()
+{
+    return low;
+}
+
+uint8_t heapHistoryLen()
+{
+    return historyLen;
+}
+
+const HeapSample &heapHistory(uint8_t index)
+{
+    return history[(historyNext + HEAP_HISTORY_LEN - historyLen + index) % HEAP_HISTORY_LEN];
+}
+
+static uint16_t word(uint32_t value, uint16_t offset)
+{
+    return offset % 2 == 0 ? value >> 16 : value & 0xFFFF;
+}
+
+uint16_t heapRegister(uint16_t offset)
+{
+    if (offset >= HEAP_REGS_HISTORY)
+    {
+        uint16_t index = (offset - HEAP_REGS_HISTORY) / HEAP_REGS_PER_SAMPLE;
+        uint8_t field = (offset - HEAP_REGS_HISTORY) % HEAP_REGS_PER_SAMPLE;
+        if (index >= historyLen)
+        {
+            return 0;
+        }
+        const HeapSample &sample = heapHistory(index);
+        return field < 2 ? word(sample.freeBytes, field) : field < 4 ? word(sample.maxBlockBytes, field) : sample.fragmentation;
+    }
+    switch (offset)
+    {
+    case 0:
+    case 1:
+        return word(last.freeBytes, offset);
+    case 2:
+    case 3:
+        return word(last.maxBlockBytes, offset);
+    case 4:
+        return last.fragmentation;
+    case 5:
+    case 6:
+        return word(heapLowestFree(), offset - 5);
+    case 7:
+    case 8:
+        return word(heapLowestMaxBlock(), offset - 7);
+    case 9:
+        return low;
+    default:
+        return historyLen;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HEAP_MONITOR_H__
+#define HEAP_MONITOR_H__
+
+#include <stdint.h>
+
+///
+/// Heap telemetry. heapCheck() reads free heap and the largest free block
+/// every HEAP_CHECK_INTERVAL_MILLIS, keeps the lows since boot, and every
+/// HEAP_SAMPLE_INTERVAL_MILLIS records a sample into a ring of the last
+/// HEAP_HISTORY_LEN, in fixed memory.
+///
+/// Fragmentation is 100 - largest block * 100 / free, in percent, as the
+/// ESP8266 SDK computes it.
+///
+/// Once the largest block drops below LOW_MEMORY_BLOCK_BYTES the heap is
+/// flagged low until reboot, see heapLow().
+///
+#define HEAP_CHECK_INTERVAL_MILLIS 1000
+#define HEAP_SAMPLE_INTERVAL_MILLIS 600000
+#define HEAP_HISTORY_LEN 32
+
+///
+/// Modbus input register view, 32-bit values high word first:
+///   0-1 free bytes, 2-3 largest free block, 4 fragmentation,
+///   5-6 lowest free bytes, 7-8 lowest largest free block,
+///   9 low memory (0/1), 10 history samples recorded,
+///   11.. history, HEAP_REGS_PER_SAMPLE registers per sample, oldest first:
+///   0-1 free bytes, 2-3 largest free block, 4 fragmentation
+///
+#define HEAP_REGS_HISTORY 11
+#define HEAP_REGS_PER_SAMPLE 5
+#define HEAP_REGS_LEN (HEAP_REGS_HISTORY + HEAP_HISTORY_LEN * HEAP_REGS_PER_SAMPLE)
+
+struct HeapSample
+{
+    // millis() / 1000 when taken
+    uint32_t uptimeSeconds;
+    uint32_t freeBytes;
+    uint32_t maxBlockBytes;
+    uint8_t fragmentation;
+};
+
+// Current figures, not recorded
+HeapSample heapRead();
+// Reads the heap, updates lows and the low flag, and records a history
+// sample when one is due. Returns the reading.
+HeapSample heapCheck();
+uint32_t heapLowestFree();
+uint32_t heapLowestMaxBlock();
+// The largest block has been below LOW_MEMORY_BLOCK_BYTES since boot
+bool heapLow();
+uint8_t heapHistoryLen();
+// 0 is the oldest
+const HeapSample &heapHistory(uint8_t index);
+uint16_t heapRegister(uint16_t offset);
+
+#endif // HEAP_MONITOR_H__
@@ -0,0 +1,97 @@
+#ifndef HTTP_STREAM_H__
+#define HTTP_STREAM_H__
+
+#include <stdarg.h>
+#include <Arduino.h>
+#ifdef ESP8266
+#define WebServer ESP8266WebServer
+#include <ESP8266WebServer.h>
+#elif defined(ESP32)
+#include <WebServer.h>
+#endif
+
+// Bytes collected before each chunk is sent
+#define HTTP_STREAM_CHUNK_SIZE 512
+
+///
+/// Response of unknown length, written piecewise and sent in chunks of
+/// HTTP_STREAM_CHUNK_SIZE from a buffer on the stack. Nothing is
+/// allocated, however long the response. end() must be called.
+///
+class HttpStream
+{
+public:
+    HttpStream(WebServer &server, int code, const char *contentType) : server(server)
+    {
+        server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        server.send(code, contentType, "");
+    }
+
+    void write(const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+            size_t n = len < sizeof(buf) - used ? len : sizeof(buf) - used;
+            memcpy(buf + used, data, n);
+            used += n;
+            data += n;
+            len -= n;
+            if (used == sizeof(buf))
+            {
+                flush();
+            }
+        }
+    }
+    void print(const char *s)
+    {
+        write(s, strlen(s));
+    }
+    // Formatted output, at most HTTP_STREAM_CHUNK_SIZE bytes per call
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (sizeof(buf) - used < 128)
+        {
+            flush();
+        }
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buf + used, sizeof(buf) - used, format, args);
+        va_end(args);
+        if (len < 0)
+        {
+            return;
+        }
+        if (size_t(len) < sizeof(buf) - used)
+        {
+            used += len;
+            return;
+        }
+        // Did not fit, format again into an empty buffer
+        flush();
+        va_start(args, format);
+        len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        used = len < 0 ? 0 : (size_t(len) < sizeof(buf) ? len : sizeof(buf) - 1);
+    }
+    void end()
+    {
+        flush();
+        server.sendContent("");
+    }
+
+private:
+    void flush()
+    {
+        if (used > 0)
+        {
+            server.sendContent(buf, used);
+            used = 0;
+        }
+    }
+
+    WebServer &server;
+    char buf[HTTP_STREAM_CHUNK_SIZE];
+    size_t used = 0;
+};
+
+#endif // HTTP_STREAM_H__
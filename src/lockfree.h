@@ -0,0 +1,199 @@
+#ifndef LOCKFREE_H__
+#define LOCKFREE_H__
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+///
+/// Fixed-size containers for handing data between FreeRTOS tasks without
+/// locks. None of them allocate, block or disable interrupts. They only
+/// need 32-bit atomics, and MpscQueue also needs compare-and-swap, so it is
+/// meant for the ESP32 only.
+///
+
+///
+/// Bounded queue with one producer and one consumer. Positions run
+/// freely and are masked on access.
+///
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // False when full
+    bool push(const T &value)
+    {
+        uint32_t head = this->head.load(std::memory_order_relaxed);
+        if (head - tail.load(std::memory_order_acquire) == N)
+        {
+            return false;
+        }
+        items[head & (N - 1)] = value;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // False when empty
+    bool pop(T &value)
+    {
+        uint32_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = items[tail & (N - 1)];
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
+
+///
+/// Bounded queue with any number of producers and one consumer (Vyukov's
+/// bounded queue). Producers claim a cell by moving head with
+/// compare-and-swap. A cell's sequence number says whether it is free to
+/// write (== position) or ready to read (== position + 1).
+///
+template <typename T, size_t N>
+class MpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+
+public:
+    MpscQueue()
+    {
+        for (uint32_t i = 0; i < N; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // False when full
+    bool push(const T &value)
+    {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells[pos & (N - 1)];
+            int32_t diff = int32_t(cell->sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The consumer has not freed the cell from the previous lap yet
+                return false;
+            }
+            else
+            {
+                // Another producer took the cell
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // False when empty, or when the next value is still being written
+    bool pop(T &value)
+    {
+        Cell &cell = cells[tail & (N - 1)];
+        if (int32_t(cell.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0)
+        {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(tail + N, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+    Cell cells[N];
+    std::atomic<uint32_t> head{0};
+    // Consumer only
+    uint32_t tail = 0;
+};
+
+// Read attempts before SeqLock::read() gives up on a busy writer
+#define SEQLOCK_READ_ATTEMPTS 8
+
+///
+/// Value with one writer and any number of readers. The sequence is odd
+/// while a write is in progress. Readers copy the value and keep the copy
+/// only if the sequence was even and did not move meanwhile. The value is
+/// stored as relaxed atomic words, so the copies race without undefined
+/// behaviour.
+///
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied bytewise");
+    static constexpr size_t WORDS = (sizeof(T) + 3) / 4;
+
+public:
+    void write(const T &value)
+    {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            data[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copies the latest complete value into value. Leaves value alone and
+    // returns false if every attempt overlapped a write.
+    bool read(T &value) const
+    {
+        uint32_t words[WORDS];
+        for (uint8_t attempt = 0; attempt < SEQLOCK_READ_ATTEMPTS; attempt++)
+        {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; i++)
+            {
+                words[i] = data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                memcpy(&value, words, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> data[WORDS] = {};
+};
+
+#endif // LOCKFREE_H__
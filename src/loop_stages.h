@@ -0,0 +1,36 @@
+#ifndef LOOP_STAGES_H__
+#define LOOP_STAGES_H__
+
+///
+/// Stages of loop(), in execution order. LOOP_STAGE() marks where a stage
+/// starts and LOOP_END() where the last one ends. The marks feed the
+/// profiler (profiler.h) and, in host benchmarks, loopStageHook().
+///
+enum LoopStage
+{
+    LOOP_STAGE_WIFI,
+    LOOP_STAGE_MODBUS,
+    LOOP_STAGE_OTA,
+    LOOP_STAGE_HTTP,
+    LOOP_STAGE_HEATPUMP,
+    LOOP_STAGE_LOG,
+    LOOP_STAGE_COUNT
+};
+
+// Implemented in profiler.cpp
+void profilerStage(LoopStage stage);
+void profilerLoopEnd();
+
+#ifdef NATIVE_BENCH
+void loopStageHook(LoopStage stage);
+#define LOOP_STAGE(stage)      \
+    {                          \
+        profilerStage(stage);  \
+        loopStageHook(stage);  \
+    }
+#else
+#define LOOP_STAGE(stage) profilerStage(stage)
+#endif
+#define LOOP_END() profilerLoopEnd()
+
+#endif // LOOP_STAGES_H__
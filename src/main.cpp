@@ -3,6 +3,14 @@
  * COILS
  * 0: reboot (write 1 to reboot)
  * 1: reboot (write 1 to reboot)
+ * 2: reset loop profiler (write 1 to reset)
+ *
+ * INPUT REGISTERS:
+ * 0..: loop profiler, PROFILER_REGS_PER_SLOT registers for each of the
+ *      stages wifi, modbus, ota, http, heatpump, log and for the whole
+ *      loop. See profiler.h for the layout.
+ * 1000..: heap telemetry and history, see heap_monitor.h for the layout.
+ * 2000..: boot timeline, see boot_timeline.h for the layout.
  * 
  * HOLDING REGISTERS:
  * READ by ESP (not written):
@@ -19,6 +27,28 @@
  * 9: ROOM_TEMPERATURE, Celsius*10.
  * 10: OPERATING. bool. 0=false, true otherwise
  * 11: MILLIS_SINCE_LAST_COMMS, integer.
+ * READ by ESP with REMOTE_MODBUS_SETPOINTS (not written), same values as 2, 4..7:
+ * 12: SET TEMPERATURE command, Celsius*10.
+ * 13: MODE command.
+ * 14: FAN command.
+ * 15: VANE command.
+ * 16: WIDEVANE command.
+ * The ESP then reads 0..16 in one go. Commands are passed on when they
+ * change, out of range values (e.g. 0xFFFF) are ignored.
+ * 
+ * With REMOTE_MODBUS_DELTA_WRITES, register 1 is still reset on every write
+ * cycle and register 11 is refreshed only every
+ * REMOTE_MODBUS_FULL_REFRESH_MILLIS; the rest are written on change.
+ *
+ * GATEWAY (HEATPUMP_UNITS > 1):
+ * Each indoor unit has its own holding register block. The Modbus server
+ * serves unit N's block to requests for unit id N + 1, the coils and
+ * input registers to all of them. On the remote server unit N's block
+ * starts at N * REMOTE_MODBUS_UNIT_OFFSET.
+ *
+ * STANDBY PLC (several REMOTE_MODBUS_TARGETS):
+ * The registers WRITTEN BY ESP go to every target. POWER is read from the
+ * first healthy one only.
  * 
  * */
 
@@ -29,6 +59,8 @@
 
 #include "constants.h"
 
+#include <algorithm>
+#include <climits>
 #include <memory>
 #include <Arduino.h>
 #ifdef ESP8266
@@ -47,258 +79,511 @@
 #include <WebServer.h>
 #endif
 #include <DNSServer.h>
-#include <EspHtmlTemplateProcessor.h>
 #include "WebUI.h"
+#include "boot_timeline.h"
+#include "commands.h"
 #include "debug_utils.h"
+#include "heap_monitor.h"
+#include "lockfree.h"
+#include "loop_stages.h"
+#include "metrics.h"
+#include "modbus_server.h"
+#include "profiler.h"
+#include "protothread.h"
+#include "registers.h"
+#include "rtc_state.h"
+#include "snapshot.h"
+#include "timer_wheel.h"
 #include "utils.h"
 
 #ifdef ESP8266
 using Dir = fs::Dir;
 #endif
 
-// Amount of tries to do modbus operations
+// Consecutive failed modbus operations before reconnecting
 #define MODBUS_RETRIES 5
-// Modbus retry sleep
+// Initial modbus retry backoff, doubled on each consecutive failure
 #define MODBUS_RETRY_SLEEP 100
+#define MODBUS_BACKOFF_MAX_MILLIS 10000
+// FC23 transactions failing in a row before a target gets separate reads
+// and writes instead, see REMOTE_MODBUS_FC23
+#define MODBUS_FC23_MAX_FAILURES 3
+// Give up on a client transaction the library has not completed by then
+#define MODBUS_TRANSACTION_TIMEOUT_MILLIS (2 * MODBUSIP_TIMEOUT)
+// HeatPump sends at most one packet a second and update() blocks until it
+// may; polling a little slower than that keeps update() from waiting
+#define HEATPUMP_PACKET_GAP_MILLIS 1000
+#define HEATPUMP_POLL_INTERVAL_MILLIS 1100
+// When WiFi is lost for good, how long to wait for the heat pump to confirm
+// it is off before restarting anyway
+#define HEATPUMP_SHUTDOWN_TIMEOUT_MILLIS 5000
+// How long a restart waits for the log to go out
+#define RESTART_LOG_DRAIN_MILLIS 1000
 
-#define COILS_LEN 2
+#define COILS_LEN 3
 #define COIL_RESET_INDEX 0
 #define COIL_REBOOT_INDEX 1
+#define COIL_PROFILER_RESET_INDEX 2
 
-#define HOLDING_LEN 12
-// READ registers
-// 0: hvac power on (setting from PLC)
-
-// WRITE registers:
-#define HOLDING_REG_TIMEOUT_COUNTER 1
-#define HOLDING_REG_TEMPERATURE_INDEX 2
-#define HOLDING_REG_POWER_INDEX 3
-#define HOLDING_REG_MODE_INDEX 4
-#define HOLDING_REG_FAN_INDEX 5
-#define HOLDING_REG_VANE_INDEX 6
-#define HOLDING_REG_WIDEVANE_INDEX 7
-#define HOLDING_REG_CONNECTED_INDEX 8
-#define HOLDING_REG_ROOM_TEMPERATURE_INDEX 9
-#define HOLDING_REG_OPERATING_INDEX 10
-#define HOLDING_REG_MILLIS_SINCE_LAST_COMMS_INDEX 11
-
-#define HOLDING_READ_COUNT 1
-#define HOLDING_WRITE_COUNT (HOLDING_LEN - HOLDING_READ_COUNT)
-static_assert(HOLDING_READ_COUNT == HOLDING_REG_TIMEOUT_COUNTER, "Index mismatch");
+#define IREG_HEAP_OFFSET 1000
+#define IREG_BOOT_OFFSET 2000
+
+// Registers the ESP writes to the remote server
+#define HOLDING_WRITE_BEGIN HOLDING_REG_TIMEOUT_COUNTER
+#define HOLDING_WRITE_COUNT (HOLDING_REG_TEMPERATURE_COMMAND - HOLDING_WRITE_BEGIN)
+// Registers it reads, from 0: the power command, or with
+// REMOTE_MODBUS_SETPOINTS everything up to the last setpoint command
+#define HOLDING_READ_COUNT (REMOTE_MODBUS_SETPOINTS ? HOLDING_LEN : HOLDING_REG_POWER_COMMAND + 1)
+// Setpoint commands out of this range are ignored
+#define HEATPUMP_TEMPERATURE_MIN 16
+#define HEATPUMP_TEMPERATURE_MAX 31
+static_assert(HEATPUMP_UNITS >= 1 && HEATPUMP_UNITS <= 3, "One UART per heat pump, at most 3");
+static_assert(HOLDING_LEN <= REMOTE_MODBUS_UNIT_OFFSET, "Remote register blocks of units overlap");
+
+// HeatPump::connect() blocks for 2 s whether or not a unit answers, so
+// after the first try a unit that is not connected is only probed this
+// often, and connect() is left to one that answered, see
+// heatpumpProbeFlow()
+#define HEATPUMP_RECONNECT_MILLIS 10000
+// Line settings and connect packet of the CN105 protocol, as HeatPump
+// uses them
+#define HEATPUMP_BAUD 2400
+static const uint8_t CN105_CONNECT[] = {0xfc, 0x5a, 0x01, 0x30, 0x02, 0xca, 0x01, 0xa8};
 
-//
-// do not change ordering of below arrays
-//
-#define POWER_SIZE 2
-static const char *POWER_MAP[POWER_SIZE] = {"OFF", "ON"};
-#define MODE_SIZE 5
-static const char *MODE_MAP[MODE_SIZE] = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
-#define FAN_SIZE 6
-static const char *FAN_MAP[FAN_SIZE] = {"AUTO", "QUIET", "1", "2", "3", "4"};
-#define VANE_SIZE 7
-static const char *VANE_MAP[VANE_SIZE] = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
-#define WIDEVANE_SIZE 7
-static const char *WIDEVANE_MAP[WIDEVANE_SIZE] = {"<<", "<", "|", ">", ">>", "<>", "SWING"};
-static std::unique_ptr<HeatPump> hp(new HeatPump());
 static std::unique_ptr<ModbusIP> mb(new ModbusIP());
 static std::unique_ptr<WebServer> httpServer;
-static std::array<uint16_t, HOLDING_WRITE_COUNT> holdingDataWrite;
-static std::array<uint16_t, HOLDING_READ_COUNT> holdingDataRead;
-
-static unsigned long prevHeatpumpComms;
-static unsigned long prevModbusWrite;
-static unsigned long prevModbusRead;
-static unsigned long prevWifiConnected;
-static bool lastCommandPower;
-// At boot, we take the power on/off command from the PLC
-static bool hvacCommandsPending = true;
+
+//
+// Heat pump side: one HeatPump per unit, its snapshot and the commands
+// applied to it
+//
+static HeatPump heatpumps[HEATPUMP_UNITS];
+static std::unique_ptr<HardwareSerial> heatpumpSerials[HEATPUMP_UNITS];
+static const int HEATPUMP_UART_NUMBERS[] = HEATPUMP_UARTS;
+static unsigned long prevHeatpumpComms[HEATPUMP_UNITS];
+static unsigned long lastConnectMillis[HEATPUMP_UNITS];
+static bool connectTried[HEATPUMP_UNITS];
+static Protothread probeThreads[HEATPUMP_UNITS];
+// Result of the unit's last probe
+static bool probeAnswered[HEATPUMP_UNITS];
+// Unit polled by the next heat pump timer
+static uint8_t heatpumpNext;
+static HeatpumpSnapshot snapshots[HEATPUMP_UNITS];
+// Set by HeatPump callbacks, snapshot is refreshed after update()
+static bool snapshotStale[HEATPUMP_UNITS];
+// Served from RTC memory until the unit first answers, see rtcRestore()
+static bool snapshotRestored[HEATPUMP_UNITS];
+#if TASKS_ENABLED
+// snapshots as published for the other tasks, which read them into their own copies
+static SeqLock<HeatpumpSnapshot> sharedSnapshots[HEATPUMP_UNITS];
+static HeatpumpSnapshot modbusSnapshots[HEATPUMP_UNITS];
+static HeatpumpSnapshot httpSnapshots[HEATPUMP_UNITS];
+#else
+static HeatpumpSnapshot *const modbusSnapshots = snapshots;
+static HeatpumpSnapshot *const httpSnapshots = snapshots;
+#endif
+
+//
+// Modbus client side: the remote servers of REMOTE_MODBUS_TARGETS, each
+// with its own connection and image of each unit's block
+//
+struct RemoteModbusTarget
+{
+  IPAddress ip;
+  uint16_t port;
+};
+static const RemoteModbusTarget REMOTE_TARGETS[] = REMOTE_MODBUS_TARGETS;
+#define REMOTE_TARGET_COUNT (sizeof(REMOTE_TARGETS) / sizeof(REMOTE_TARGETS[0]))
+// ModbusIP tells connections apart by address, and has a few only
+static_assert(REMOTE_TARGET_COUNT <= MODBUSIP_MAX_CLIENTS, "Too many remote Modbus targets");
+
+struct RemoteBlock
+{
+  std::array<uint16_t, HOLDING_WRITE_COUNT> write;
+  std::array<uint16_t, HOLDING_READ_COUNT> read;
+  // Last image the remote server acknowledged, for delta writes
+  std::array<uint16_t, HOLDING_WRITE_COUNT> acked;
+  bool ackedValid;
+  // Set by timers, cleared once the Modbus client has done the work
+  bool writeDue;
+  bool fullWriteDue;
+};
+
+enum ModbusClientState
+{
+  MODBUS_CLIENT_IDLE,
+  MODBUS_CLIENT_READING,
+  MODBUS_CLIENT_WRITING,
+  MODBUS_CLIENT_READWRITING,
+  MODBUS_CLIENT_BACKOFF
+};
+
+struct ModbusTarget
+{
+  IPAddress ip;
+  uint16_t port;
+  RemoteBlock blocks[HEATPUMP_UNITS];
+  ModbusClientState state;
+  unsigned long stateEntered;
+  unsigned long backoffMillis;
+  int failures;
+  uint16_t transaction;
+  Modbus::ResultCode result;
+  bool resultReady;
+  // Unit of the transaction or write cycle in progress
+  uint8_t unit;
+  // Write cycle in progress: the unit's write image is sent range by range
+  bool writeCycle;
+  bool writeFull;
+  size_t writeOffset;
+  size_t writeCount;
+  // Cleared for good when the server answers FC23 with illegal function,
+  // or fails it MODBUS_FC23_MAX_FAILURES times in a row
+  bool fc23Supported;
+  uint8_t fc23Failures;
+  // 0 to 100, see REMOTE_MODBUS_HEALTHY
+  uint8_t health;
+};
+static ModbusTarget modbusTargets[REMOTE_TARGET_COUNT];
+// Target the power commands are read from
+static uint8_t commandTarget;
+
+// Commands for each unit, read from the command target
+struct PlcCommand
+{
+  // Set by the read timer, cleared once read
+  bool readDue;
+  // Last value read of each REG_COMMAND register, by address
+  uint16_t values[HOLDING_LEN];
+  // Whether it was passed on. At boot, we take every command from the PLC
+  bool submitted[HOLDING_LEN];
+};
+static PlcCommand plcCommands[HEATPUMP_UNITS];
+
+uint8_t modbusTargetIndex(const ModbusTarget &target)
+{
+  return &target - modbusTargets;
+}
+
+//
+// Periodic work runs off timer wheels, see timersSetup(). With ESP32_TASKS
+// each task has its own.
+//
+#if TASKS_ENABLED
+static TimerWheel heatpumpTimers;
+static TimerWheel modbusTimers;
+static TimerWheel networkTimers;
+static TimerWheel *const TIMER_WHEELS[] = {&heatpumpTimers, &modbusTimers, &networkTimers};
+#else
+static TimerWheel timers;
+static TimerWheel &heatpumpTimers = timers;
+static TimerWheel &modbusTimers = timers;
+static TimerWheel &networkTimers = timers;
+static TimerWheel *const TIMER_WHEELS[] = {&timers};
+#endif
+// Periods POST /api/timers sets are clamped to this range: no faster than
+// the fastest timer polls by default, no slower than once an hour
+#define TIMER_API_PERIOD_MIN_MILLIS 50
+#define TIMER_API_PERIOD_MAX_MILLIS 3600000
+
+// OTA, HTTP and Modbus are started once WiFi first comes up
+static std::atomic<bool> networkStarted(false);
+static std::atomic<bool> restartRequested(false);
+static Protothread wifiThread;
+static Protothread restartThread;
+static Protothread lowMemoryThread;
+static TimerId wifiTimerId = TIMER_NONE;
 static bool otaInProgress;
-static HardwareSerial heatpumpSerial(HEATPUMP_UART);
-
-#define IMPL_MAP_HELPERS(FROM_STR_FUN, FROM_NUM_FUN, VALUES_SIZE, VALUES) \
-  uint16_t FROM_STR_FUN(const char *lookupValue)                          \
-  {                                                                       \
-    if (lookupValue == NULL)                                              \
-    {                                                                     \
-      return -1;                                                          \
-    }                                                                     \
-    for (int i = 0; i < VALUES_SIZE; i++)                                 \
-    {                                                                     \
-      if (streq(lookupValue, VALUES[i]))                                  \
-      {                                                                   \
-        return i;                                                         \
-      }                                                                   \
-    }                                                                     \
-    return -1;                                                            \
-  }                                                                       \
-  const char *FROM_NUM_FUN(const uint16_t index)                          \
-  {                                                                       \
-    if (index >= VALUES_SIZE)                                             \
-    {                                                                     \
-      return NULL;                                                        \
-    }                                                                     \
-    else                                                                  \
-    {                                                                     \
-      return VALUES[index];                                               \
-    }                                                                     \
-  }
-IMPL_MAP_HELPERS(fromStrPower, fromIndexPower, POWER_SIZE, POWER_MAP);
-IMPL_MAP_HELPERS(fromStrMode, fromIndexMode, MODE_SIZE, MODE_MAP);
-IMPL_MAP_HELPERS(fromStrFan, fromIndexFan, FAN_SIZE, FAN_MAP);
-IMPL_MAP_HELPERS(fromStrVane, fromIndexVane, VANE_SIZE, VANE_MAP);
-IMPL_MAP_HELPERS(fromStrWideVane, fromIndexWideVane, WIDEVANE_SIZE, WIDEVANE_MAP);
-void restart()
+
+uint16_t getConnected(uint8_t unit)
 {
-  ESP.restart();
-  while (true)
+  return heatpumps[unit].getSettings().connected ? UINT16_C(1) : UINT16_C(0);
+}
+
+uint16_t getOperating(uint8_t unit)
+{
+  return heatpumps[unit].getOperating() ? UINT16_C(1) : UINT16_C(0);
+}
+
+uint16_t getMillisSinceLastComms(uint8_t unit)
+{
+  return millis() - modbusSnapshots[unit].commsMillis;
+}
+
+#define ENUM_REGISTER(ADDRESS, NAME, VALUES, GET, SET) \
+  {ADDRESS, NAME, REG_READ_WRITE, false, false, &VALUES, &HeatPump::GET, &HeatPump::SET, 0, nullptr, nullptr, nullptr, HOLDING_LEN}
+#define SCALED_REGISTER(ADDRESS, NAME, ACCESS, SCALE, GET, SET) \
+  {ADDRESS, NAME, ACCESS, false, false, nullptr, nullptr, nullptr, SCALE, &HeatPump::GET, SET, nullptr, HOLDING_LEN}
+#define VALUE_REGISTER(ADDRESS, NAME, ACCESS, HEARTBEAT_ONLY, LIVE, GET) \
+  {ADDRESS, NAME, ACCESS, HEARTBEAT_ONLY, LIVE, nullptr, nullptr, nullptr, 0, nullptr, nullptr, GET, HOLDING_LEN}
+// Served from the last value read from the PLC
+#define COMMAND_REGISTER(ADDRESS, NAME, SETTING) \
+  {ADDRESS, NAME, REG_COMMAND, false, true, nullptr, nullptr, nullptr, 0, nullptr, nullptr, nullptr, SETTING}
+
+static constexpr HoldingRegister HOLDING_REGISTERS[] = {
+    COMMAND_REGISTER(HOLDING_REG_POWER_COMMAND, "power command", HOLDING_REG_POWER_INDEX),
+    // Reset to zero by the ESP, incremented by the PLC
+    VALUE_REGISTER(HOLDING_REG_TIMEOUT_COUNTER, "timeout", REG_READ_ONLY, false, false, nullptr),
+    SCALED_REGISTER(HOLDING_REG_TEMPERATURE_INDEX, "temperature", REG_READ_WRITE, 10, getTemperature, &HeatPump::setTemperature),
+    ENUM_REGISTER(HOLDING_REG_POWER_INDEX, "power", POWER_ENUM, getPowerSetting, setPowerSetting),
+    ENUM_REGISTER(HOLDING_REG_MODE_INDEX, "mode", MODE_ENUM, getModeSetting, setModeSetting),
+    ENUM_REGISTER(HOLDING_REG_FAN_INDEX, "fan", FAN_ENUM, getFanSpeed, setFanSpeed),
+    ENUM_REGISTER(HOLDING_REG_VANE_INDEX, "vane", VANE_ENUM, getVaneSetting, setVaneSetting),
+    ENUM_REGISTER(HOLDING_REG_WIDEVANE_INDEX, "wide vane", WIDEVANE_ENUM, getWideVaneSetting, setWideVaneSetting),
+    VALUE_REGISTER(HOLDING_REG_CONNECTED_INDEX, "connected", REG_READ_ONLY, false, false, getConnected),
+    SCALED_REGISTER(HOLDING_REG_ROOM_TEMPERATURE_INDEX, "room temperature", REG_READ_ONLY, 10, getRoomTemperature, nullptr),
+    VALUE_REGISTER(HOLDING_REG_OPERATING_INDEX, "operating", REG_READ_ONLY, false, false, getOperating),
+    VALUE_REGISTER(HOLDING_REG_MILLIS_SINCE_LAST_COMMS_INDEX, "millis since last comms", REG_READ_ONLY, true, true, getMillisSinceLastComms),
+    COMMAND_REGISTER(HOLDING_REG_TEMPERATURE_COMMAND, "temperature command", HOLDING_REG_TEMPERATURE_INDEX),
+    COMMAND_REGISTER(HOLDING_REG_MODE_COMMAND, "mode command", HOLDING_REG_MODE_INDEX),
+    COMMAND_REGISTER(HOLDING_REG_FAN_COMMAND, "fan command", HOLDING_REG_FAN_INDEX),
+    COMMAND_REGISTER(HOLDING_REG_VANE_COMMAND, "vane command", HOLDING_REG_VANE_INDEX),
+    COMMAND_REGISTER(HOLDING_REG_WIDEVANE_COMMAND, "wide vane command", HOLDING_REG_WIDEVANE_INDEX),
+};
+static_assert(sizeof(HOLDING_REGISTERS) / sizeof(HOLDING_REGISTERS[0]) == HOLDING_LEN, "HOLDING_REGISTERS must cover every address");
+static_assert(registersInAddressOrder(HOLDING_REGISTERS, HOLDING_LEN), "HOLDING_REGISTERS must be in address order");
+
+// Out of range values are not passed on, whichever source they come from,
+// so that a PLC can leave a setpoint alone and a bad one is not re-sent
+// until its command expires
+bool settingValueValid(const HoldingRegister &setting, uint16_t value)
+{
+  if (setting.values)
   {
-    // wait for reboot
-    delay(1000);
+    return setting.values->fromIndex(value) != NULL;
   }
+  return setting.setScaled && value >= HEATPUMP_TEMPERATURE_MIN * setting.scale &&
+         value <= HEATPUMP_TEMPERATURE_MAX * setting.scale;
+}
+
+bool settingValueValid(uint8_t address, uint16_t value)
+{
+  return address < HOLDING_LEN && settingValueValid(HOLDING_REGISTERS[address], value);
+}
+
+// Returns right away, the restart happens once the log has gone out. From
+// any task.
+void restart(RestartReason reason)
+{
+  rtcStateRestart(reason);
+  restartRequested = true;
+}
+
+PtState restartFlow(Protothread &pt)
+{
+  PT_BEGIN(pt);
+  PT_WAIT_UNTIL(pt, restartRequested);
+  pt.millis = millis();
+  // A few datagrams per call, everything else keeps running meanwhile
+  PT_WAIT_UNTIL(pt, logFlush() < LOG_FLUSH_DATAGRAMS || millis() - pt.millis > RESTART_LOG_DRAIN_MILLIS);
+  ESP.restart();
+  PT_END(pt);
 }
 
 // Callback function to read corresponding DI
-uint16_t coilRead(TRegister *reg, uint16_t val)
+uint16_t coilRead(uint8_t, uint16_t)
 {
   return 0;
 }
+// Callback function to read the loop profiler input registers
+uint16_t profilerRead(uint8_t, uint16_t address)
+{
+  return profilerRegister(address);
+}
+// Callback function to read the heap telemetry input registers
+uint16_t heapRegisterRead(uint8_t, uint16_t address)
+{
+  return heapRegister(address - IREG_HEAP_OFFSET);
+}
+// Callback function to read the boot timeline input registers
+uint16_t bootRegisterRead(uint8_t, uint16_t address)
+{
+  return bootRegister(address - IREG_BOOT_OFFSET);
+}
 // Callback function to write-protect DI
-uint16_t coilWrite(TRegister *reg, uint16_t val)
+bool coilWrite(uint8_t, uint16_t address, uint16_t val)
 {
-  uint8_t address = reg->address.address;
   if (val == 0)
-    return reg->value;
+    return true;
 
   switch (address)
   {
   case COIL_RESET_INDEX:
-    DEBUG_PRINT("Reset via modbus");
-    restart();
-    return 0;
-    break;
+    LOG_PRINTLN(LOG_NOTICE, "Reset via modbus");
+    restart(RESTART_MODBUS);
+    return true;
   case COIL_REBOOT_INDEX:
-    DEBUG_PRINT("Reboot via modbus");
-    restart();
-    return 0;
-    break;
+    LOG_PRINTLN(LOG_NOTICE, "Reboot via modbus");
+    restart(RESTART_MODBUS);
+    return true;
+  case COIL_PROFILER_RESET_INDEX:
+    profilerReset();
+    return true;
   default:
     break;
   }
-  return -1;
+  return false;
+}
+
+// Evaluates a register against the unit's HeatPump. Use
+// getHoldingRegister() instead, which serves from the snapshot.
+uint16_t computeHoldingRegister(uint8_t unit, uint8_t address)
+{
+  const HoldingRegister &reg = HOLDING_REGISTERS[address];
+  HeatPump &hp = heatpumps[unit];
+  if (reg.access == REG_COMMAND)
+  {
+    return plcCommands[unit].values[address];
+  }
+  if (reg.values)
+  {
+    return reg.values->fromStr((hp.*reg.getEnum)());
+  }
+  if (reg.getScaled)
+  {
+    return static_cast<uint16_t>(round((hp.*reg.getScaled)() * reg.scale));
+  }
+  return reg.get ? reg.get(unit) : 0;
 }
 
-uint16_t getHoldingRegister(uint8_t address)
+void refreshSnapshot(uint8_t unit)
 {
-  switch (address)
+  HeatpumpSnapshot &snapshot = snapshots[unit];
+  bool changed = false;
+  for (uint8_t address = 0; address < HOLDING_LEN; address++)
+  {
+    if (HOLDING_REGISTERS[address].live)
+    {
+      continue;
+    }
+    uint16_t value = computeHoldingRegister(unit, address);
+    changed = changed || value != snapshot.holding[address];
+    snapshot.holding[address] = value;
+  }
+  snapshot.settings = heatpumps[unit].getSettings();
+  snapshot.roomTemperature = heatpumps[unit].getRoomTemperature();
+  snapshot.commsMillis = prevHeatpumpComms[unit];
+  if (changed)
+  {
+    snapshot.sequence++;
+  }
+  snapshotStale[unit] = false;
+#if TASKS_ENABLED
+  sharedSnapshots[unit].write(snapshot);
+#endif
+}
+
+uint16_t getHoldingRegister(uint8_t unit, uint8_t address)
+{
+  if (address >= HOLDING_LEN)
   {
-  case HOLDING_REG_TIMEOUT_COUNTER:
-    return 0;
-    break;
-  case HOLDING_REG_TEMPERATURE_INDEX:
-    return static_cast<uint16_t>(round(hp->getTemperature() * 10));
-    break;
-  case HOLDING_REG_POWER_INDEX:
-    return fromStrPower(hp->getPowerSetting());
-    break;
-  case HOLDING_REG_MODE_INDEX:
-    return fromStrMode(hp->getModeSetting());
-    break;
-  case HOLDING_REG_FAN_INDEX:
-    return fromStrFan(hp->getFanSpeed());
-    break;
-  case HOLDING_REG_VANE_INDEX:
-    return fromStrFan(hp->getVaneSetting());
-    break;
-  case HOLDING_REG_WIDEVANE_INDEX:
-    return fromStrWideVane(hp->getWideVaneSetting());
-    break;
-  case HOLDING_REG_CONNECTED_INDEX:
-    return static_cast<uint16_t>(hp->getSettings().connected ? UINT16_C(1) : UINT16_C(0));
-    break;
-  case HOLDING_REG_ROOM_TEMPERATURE_INDEX:
-    return static_cast<uint16_t>(round(hp->getRoomTemperature() * 10));
-    break;
-  case HOLDING_REG_OPERATING_INDEX:
-    return static_cast<uint16_t>(hp->getOperating() ? UINT16_C(1) : UINT16_C(0));
-    break;
-  case HOLDING_REG_MILLIS_SINCE_LAST_COMMS_INDEX:
-    return millis() - prevHeatpumpComms;
-    break;
-  default:
     return -1;
-    break;
   }
-  return -1;
+  if (HOLDING_REGISTERS[address].live)
+  {
+    return computeHoldingRegister(unit, address);
+  }
+  return modbusSnapshots[unit].holding[address];
 }
 
 // Callback function to read corresponding holding register
-uint16_t holdingRead(TRegister *reg, uint16_t val)
+uint16_t holdingRead(uint8_t unit, uint16_t address)
 {
-  uint8_t address = reg->address.address;
-  return getHoldingRegister(address);
+  return getHoldingRegister(unit, address);
 }
 // Callback function to holding register
-uint16_t holdingWrite(TRegister *reg, uint16_t val)
+bool holdingWrite(uint8_t unit, uint16_t address, uint16_t val)
 {
-  uint8_t address = reg->address.address;
-  switch (address)
+  if (address >= HOLDING_LEN)
+  {
+    LOG_PRINTF(LOG_DEBUG, "Client tried to write unknown address %u. Ignoring.", address);
+    return false;
+  }
+  const HoldingRegister &holding = HOLDING_REGISTERS[address];
+  if (holding.access != REG_READ_WRITE)
   {
-  case HOLDING_REG_TEMPERATURE_INDEX:
-    DEBUG_PRINT("Temperature will be set to ");
-    DEBUG_PRINT(val);
-    DEBUG_PRINTLN("/10");
-    hp->setTemperature(float(static_cast<int16_t>(val)) / 10);
-    break;
-  case HOLDING_REG_POWER_INDEX:
-    DEBUG_PRINT("Set power to ");
-    DEBUG_PRINTLN(val);
-    hp->setPowerSetting(fromIndexPower(val));
-    break;
-  case HOLDING_REG_MODE_INDEX:
-    DEBUG_PRINT("Set mode to ");
-    DEBUG_PRINTLN(val);
-    hp->setModeSetting(fromIndexMode(val));
-    break;
-  case HOLDING_REG_FAN_INDEX:
-    DEBUG_PRINT("Set fan to ");
-    DEBUG_PRINTLN(val);
-    hp->setFanSpeed(fromIndexFan(val));
-    break;
-  case HOLDING_REG_VANE_INDEX:
-    DEBUG_PRINT("Set vane to ");
-    DEBUG_PRINTLN(val);
-    hp->setVaneSetting(fromIndexVane(val));
-    break;
-  case HOLDING_REG_WIDEVANE_INDEX:
-    DEBUG_PRINT("Set wide vane to ");
-    DEBUG_PRINTLN(val);
-    hp->setWideVaneSetting(fromIndexWideVane(val));
-    break;
-  case HOLDING_REG_CONNECTED_INDEX:
-  case HOLDING_REG_ROOM_TEMPERATURE_INDEX:
-  case HOLDING_REG_OPERATING_INDEX:
-  case HOLDING_REG_MILLIS_SINCE_LAST_COMMS_INDEX:
-  case HOLDING_REG_TIMEOUT_COUNTER:
     DEBUG_PRINTLN("Client tried to write RO field. Ignoring.");
     // Read-only
-    return -2;
-    break;
-  default:
-    DEBUG_PRINT("Client tried to write unknown address");
-    DEBUG_PRINT(address);
-    DEBUG_PRINTLN(". Ignoring.");
-    return -1;
-    break;
+    return false;
+  }
+  LOG_PRINTF(LOG_DEBUG, "Set %s of unit %u to %u", holding.name, unit, val);
+  if (!settingValueValid(holding, val))
+  {
+    DEBUG_PRINTLN("Client tried to write value out of range. Ignoring.");
+    return false;
+  }
+  submitCommand(COMMAND_SOURCE_MODBUS, unit, address, val);
+  return true;
+}
+
+// Served by the Modbus server, see the top of this file
+static const ModbusRegisterBlock MODBUS_REGISTER_BLOCKS[] = {
+    {MODBUS_COILS, 0, COILS_LEN, coilRead, coilWrite},
+    {MODBUS_HOLDING_REGISTERS, 0, HOLDING_LEN, holdingRead, holdingWrite},
+    {MODBUS_INPUT_REGISTERS, IREG_HEAP_OFFSET, HEAP_REGS_LEN, heapRegisterRead, nullptr},
+    {MODBUS_INPUT_REGISTERS, IREG_BOOT_OFFSET, BOOT_REGS_LEN, bootRegisterRead, nullptr},
+    // Last, left out without the profiler
+    {MODBUS_INPUT_REGISTERS, 0, PROFILER_REGS_LEN, profilerRead, nullptr},
+};
+
+// Sets every pending field on the unit's HeatPump, for the next update()
+// to send together
+void applyPendingCommands(uint8_t unit)
+{
+  HeatPump &hp = heatpumps[unit];
+  for (uint8_t address = 0; address < HOLDING_LEN; address++)
+  {
+    const PendingCommand &command = commandPending(unit, address);
+    if (!command.pending)
+    {
+      continue;
+    }
+    const HoldingRegister &holding = HOLDING_REGISTERS[address];
+    if (holding.values)
+    {
+      (hp.*holding.setEnum)(holding.values->fromIndex(command.value));
+    }
+    else if (holding.setScaled)
+    {
+      (hp.*holding.setScaled)(float(static_cast<int16_t>(command.value)) / holding.scale);
+    }
+  }
+}
+
+// Retires pending fields the heat pump now reports, and those that are
+// too old to insist on
+void confirmPendingCommands(uint8_t unit)
+{
+  for (uint8_t address = 0; address < HOLDING_LEN; address++)
+  {
+    const PendingCommand &command = commandPending(unit, address);
+    if (!command.pending)
+    {
+      continue;
+    }
+    if (snapshots[unit].holding[address] == command.value)
+    {
+      LOG_PRINTF(LOG_INFO, "Set %s of unit %u to %u (%s)", HOLDING_REGISTERS[address].name, unit, command.value,
+                 commandSourceName(command.source));
+      metricInc(COUNTER_COMMANDS_APPLIED);
+      commandDone(unit, address);
+    }
+    else if (millis() - command.millis > COMMAND_MAX_AGE_MILLIS)
+    {
+      LOG_PRINTF(LOG_WARNING, "Heat pump unit %u did not take %s %u (%s), giving up", unit, HOLDING_REGISTERS[address].name,
+                 command.value, commandSourceName(command.source));
+      metricInc(COUNTER_COMMANDS_EXPIRED);
+      commandDone(unit, address);
+    }
   }
-  return val;
 }
 
-std::array<uint16_t, HOLDING_WRITE_COUNT> getHoldingRegistersToWrite()
+std::array<uint16_t, HOLDING_WRITE_COUNT> getHoldingRegistersToWrite(uint8_t unit)
 {
   std::array<uint16_t, HOLDING_WRITE_COUNT> data;
   for (int i = 0; i < HOLDING_WRITE_COUNT; i++)
   {
-    data[i] = getHoldingRegister(i + HOLDING_READ_COUNT);
+    data[i] = getHoldingRegister(unit, i + HOLDING_WRITE_BEGIN);
   }
   return data;
 }
@@ -306,36 +591,117 @@ std::array<uint16_t, HOLDING_WRITE_COUNT> getHoldingRegistersToWrite()
 void handleHttpHvac()
 {
   DEBUG_PRINTLN("handleHttp hvac info");
-  DEBUG_PRINTLN("Printing hvac page");
-  if (!EspHtmlTemplateProcessor(httpServer.get()).processAndSend("/web_ui.html", [](const String &var) -> String {
-        heatpumpSettings settings = hp->getSettings();
-        settings = updateHeatpumpFromHttpQueryParameters(httpServer, hp, settings);
-        return template_html(prevHeatpumpComms, hp, settings, var);
-      }))
+  sendWebUI(*httpServer);
+}
+
+// The "unit" argument, 0 if not given. Answers 404 and returns false if
+// there is no such unit.
+bool httpUnitArg(uint8_t &unit)
+{
+  long arg = httpServer->hasArg("unit") ? httpServer->arg("unit").toInt() : 0;
+  if (arg < 0 || arg >= HEATPUMP_UNITS)
+  {
+    httpServer->send(404, "text/plain", "404 No such unit");
+    return false;
+  }
+  unit = arg;
+  return true;
+}
+
+void handleHttpApiState()
+{
+  uint8_t unit;
+  if (httpUnitArg(unit))
+  {
+    sendStateJson(*httpServer, httpSnapshots[unit], httpSnapshots[unit].settings);
+  }
+}
+
+// Applies all given fields in one go, answers with the requested state
+void handleHttpApiSet()
+{
+  uint8_t unit;
+  if (httpUnitArg(unit))
   {
-    DEBUG_PRINTLN("ERROR templating page. Have you uploaded 'File System image' / SPIFFS which includes the web_ui.html? Listing files");
-    if (!SPIFFS.begin())
+    heatpumpSettings settings = httpSnapshots[unit].settings;
+    if (!updateHeatpumpFromHttpQueryParameters(*httpServer, unit, settings))
     {
-      DEBUG_PRINTLN(" ERROR: An Error has occurred while mounting SPIFFS");
+      httpServer->send(400, "text/plain", "400 Invalid setting");
       return;
     }
-#ifdef ESP8266
-    Dir dir = SPIFFS.openDir("/");
-    while (dir.next())
-#elif defined(ESP32)
-    File dir = SPIFFS.open("/");
-    while (dir.openNextFile())
-#endif
+    sendStateJson(*httpServer, httpSnapshots[unit], settings);
+  }
+}
+
+void handleHttpApiProfile()
+{
+  sendProfileJson(*httpServer);
+}
+
+void handleHttpApiProfileReset()
+{
+  profilerReset();
+  httpServer->send(204);
+}
+
+void handleHttpMetrics()
+{
+  // Single bytes the Modbus task writes, a stale value at worst
+  ModbusTargetMetrics targets[REMOTE_TARGET_COUNT];
+  for (uint8_t i = 0; i < REMOTE_TARGET_COUNT; i++)
+  {
+    const IPAddress &ip = REMOTE_TARGETS[i].ip;
+    targets[i] = {{ip[0], ip[1], ip[2], ip[3]}, modbusTargets[i].health, i == commandTarget};
+  }
+  sendMetrics(*httpServer, httpSnapshots, HEATPUMP_UNITS, targets, REMOTE_TARGET_COUNT);
+}
+
+// The web UI and its events show the first unit
+void handleHttpApiEvents()
+{
+  if (!addEventClient(*httpServer, httpSnapshots[0]))
+  {
+    httpServer->send(503, "text/plain", "503 Too many event subscribers");
+  }
+}
+
+void handleHttpApiTimers()
+{
+  sendTimersJson(*httpServer, TIMER_WHEELS, sizeof(TIMER_WHEELS) / sizeof(TIMER_WHEELS[0]));
+}
+
+// Sets the period of the timer "name" to "period" milliseconds, within
+// TIMER_API_PERIOD_MIN_MILLIS..TIMER_API_PERIOD_MAX_MILLIS
+void handleHttpApiTimersSet()
+{
+  long period = httpServer->arg("period").toInt();
+  if (period <= 0)
+  {
+    httpServer->send(400, "text/plain", "400 Invalid period");
+    return;
+  }
+  period = std::min(std::max(period, long(TIMER_API_PERIOD_MIN_MILLIS)), long(TIMER_API_PERIOD_MAX_MILLIS));
+  for (TimerWheel *wheel : TIMER_WHEELS)
+  {
+    TimerId id = wheel->find(httpServer->arg("name").c_str());
+    if (id != TIMER_NONE)
     {
-      DEBUG_PRINT(" SPIFFS: ");
-#ifdef ESP8266
-      DEBUG_PRINTLN(dir.fileName());
-#elif defined(ESP32)
-      DEBUG_PRINT(dir.name());
-#endif
+      wheel->setPeriod(id, period);
+      httpServer->send(204);
+      return;
     }
-    DEBUG_PRINTLN(" SPIFFS direcotry listing completed.");
   }
+  httpServer->send(404, "text/plain", "404 No such timer");
+}
+
+void handleHttpApiHeap()
+{
+  sendHeapJson(*httpServer);
+}
+
+void handleHttpApiBoot()
+{
+  sendBootJson(*httpServer);
 }
 
 void handleHttpNotFound()
@@ -347,20 +713,26 @@ void modbusSetup()
 {
   DEBUG_SCOPE("Modbus");
 
-  if (MODBUS_SERVER_ENABLED)
-  {
-    mb->server();
-
-    mb->addCoil(0, COIL_VAL(false), COILS_LEN);
-    mb->onGetCoil(0, coilRead, COILS_LEN);
-    mb->onSetCoil(0, coilWrite, COILS_LEN);
-
-    mb->addHreg(0, 0, HOLDING_LEN);
-    mb->onGetHreg(0, holdingRead, HOLDING_LEN);
-    mb->onSetHreg(0, holdingWrite, HOLDING_LEN);
-  }
+  // The server is started by networkSetup()
   if (MODBUS_CLIENT_ENABLED)
   {
+    for (uint8_t i = 0; i < REMOTE_TARGET_COUNT; i++)
+    {
+      ModbusTarget &target = modbusTargets[i];
+      target.ip = REMOTE_TARGETS[i].ip;
+      target.port = REMOTE_TARGETS[i].port;
+      target.fc23Supported = true;
+      target.health = REMOTE_MODBUS_HEALTHY;
+      for (RemoteBlock &remote : target.blocks)
+      {
+        remote.writeDue = true;
+        remote.fullWriteDue = true;
+      }
+    }
+    for (PlcCommand &command : plcCommands)
+    {
+      command.readDue = true;
+    }
     mb->client();
   }
 }
@@ -371,110 +743,176 @@ void arduinoOTASetup()
   ArduinoOTA.setPort(8266);
   ArduinoOTA.onStart([]() {
     DEBUG_PRINTLN("OTA: Start");
+    metricInc(COUNTER_OTA_STARTS);
     otaInProgress = true;
   });
   ArduinoOTA.onEnd([]() {
     DEBUG_PRINTLN("\nOTA: End");
     otaInProgress = false;
+    // ArduinoOTA restarts by itself
+    rtcStateRestart(RESTART_OTA);
   });
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    DEBUG_PRINTLN("OTA: Progress: " + String(progress / (total / 100)) + "%");
+    LOG_PRINTF(LOG_DEBUG, "OTA: Progress: %u%%", progress / (total / 100));
     otaInProgress = true;
   });
   ArduinoOTA.onError([](ota_error_t error) {
     if (error == OTA_AUTH_ERROR)
     {
-      DEBUG_PRINTLN("OTA: Auth Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: Auth Failed (%d)", int(error));
     }
     else if (error == OTA_BEGIN_ERROR)
     {
-      DEBUG_PRINTLN("OTA: Begin Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: Begin Failed (%d)", int(error));
     }
     else if (error == OTA_CONNECT_ERROR)
     {
-      DEBUG_PRINTLN("OTA: Connect Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: Connect Failed (%d)", int(error));
     }
     else if (error == OTA_RECEIVE_ERROR)
     {
-      DEBUG_PRINTLN("OTA: Receive Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: Receive Failed (%d)", int(error));
     }
     else if (error == OTA_END_ERROR)
     {
-      DEBUG_PRINTLN("OTA: End Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: End Failed (%d)", int(error));
     }
     else
     {
-      DEBUG_PRINTLN("OTA: Unknown Failed (" + String(error) + ")");
+      LOG_PRINTF(LOG_ERR, "OTA: Unknown Failed (%d)", int(error));
     }
+    metricInc(COUNTER_OTA_FAILURES);
     otaInProgress = false;
   });
 
   ArduinoOTA.begin();
 }
 
-void connectWifiOrRestart(bool setup)
+void networkSetup();
+
+// The heat pump has reported power off in comms since sinceMillis
+bool heatpumpOffSince(const HeatpumpSnapshot &state, unsigned long sinceMillis)
+{
+  return state.commsMillis != 0 && long(state.commsMillis - sinceMillis) >= 0 &&
+         state.holding[HOLDING_REG_POWER_INDEX] == POWER_ENUM.fromStr("OFF");
+}
+
+bool heatpumpsOffSince(unsigned long sinceMillis)
 {
-  if (setup)
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
   {
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    if (!heatpumpOffSince(httpSnapshots[unit], sinceMillis))
+    {
+      return false;
+    }
   }
-  prevWifiConnected = millis();
-  while (WiFi.status() != WL_CONNECTED)
+  return true;
+}
+
+// Brings up WiFi and keeps an eye on it. If it is down for more than
+// WIFI_RETRY_MILLIS, switches the heat pump off and restarts.
+PtState wifiFlow(Protothread &pt)
+{
+  PT_BEGIN(pt);
+  while (true)
   {
-    delay(500);
-    DEBUG_PRINTLN("Connecting...");
-    if (millis() - prevWifiConnected > WIFI_RETRY_MILLIS)
+    pt.millis = millis();
+    PT_WAIT_UNTIL(pt, WiFi.status() == WL_CONNECTED || millis() - pt.millis > WIFI_RETRY_MILLIS);
+    if (WiFi.status() != WL_CONNECTED)
     {
-      DEBUG_PRINTLN("Wifi seems to be down. Shuttinng down heat pump and restarting ESP");
-      bool heatPumpConnected = hp->isConnected();
-      if (!heatPumpConnected)
-      {
-        heatPumpConnected = hp->connect(&heatpumpSerial);
-      }
-      bool updated = false;
-      if (heatPumpConnected)
-      {
-        hp->setPowerSetting(false);
-        updated = hp->update();
-      }
-      DEBUG_PRINTLN("Managed to shutdown the pump: " + String(heatPumpConnected && updated) + " (connected " + String(heatPumpConnected) + ")");
-      ESP.restart();
-      while (true)
-      {
-        // wait for reboot
-        delay(1000);
-      }
+      break;
+    }
+    bootMark(BOOT_WIFI_CONNECTED);
+    if (!networkStarted)
+    {
+      networkSetup();
+      networkStarted = true;
+      bootMark(BOOT_NETWORK_STARTED);
     }
+    networkTimers.setPeriod(wifiTimerId, WIFI_CHECK_INTERVAL_MILLIS);
+    PT_WAIT_UNTIL(pt, WiFi.status() != WL_CONNECTED);
+    metricInc(COUNTER_WIFI_DISCONNECTS);
+    LOG_PRINTLN(LOG_WARNING, "Wifi disconnected");
+    networkTimers.setPeriod(wifiTimerId, WIFI_CONNECT_POLL_MILLIS);
+  }
+
+  LOG_PRINTLN(LOG_ERR, "Wifi seems to be down. Shuttinng down heat pump and restarting ESP");
+  // Goes out with each heat pump's next update()
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+  {
+    submitCommand(COMMAND_SOURCE_SYSTEM, unit, HOLDING_REG_POWER_INDEX, POWER_ENUM.fromStr("OFF"));
   }
-  // Wifi is connected
-  prevWifiConnected = millis();
+  pt.millis = millis();
+  // Every unit has its turn within a poll interval
+  PT_WAIT_UNTIL(pt, heatpumpsOffSince(pt.millis) || millis() - pt.millis > HEATPUMP_SHUTDOWN_TIMEOUT_MILLIS);
+  LOG_PRINTF(LOG_ERR, "Managed to shutdown the pump: %d", heatpumpsOffSince(pt.millis));
+  restart(RESTART_WIFI_DOWN);
+  PT_WAIT_UNTIL(pt, false);
+  PT_END(pt);
 }
 
+void rtcRestore();
+void timersSetup();
+#if TASKS_ENABLED
+void startTasks();
+#endif
+
 void setup()
 {
+  bootMark(BOOT_SETUP);
+  // Associates in the background while the heat pump link comes up
   WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
 #if defined(SERIAL_FREE_FOR_PRINT)
   Serial.begin(74880);
 #endif
   // Listen for remote controller updates ("external" updates)
   // update internal state of 'hp'
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
   {
     DEBUG_SCOPE("hp init");
-    hp->enableAutoUpdate();
-    hp->enableExternalUpdate();
+    HeatPump &hp = heatpumps[unit];
+    heatpumpSerials[unit].reset(new HardwareSerial(HEATPUMP_UART_NUMBERS[unit]));
+    hp.enableAutoUpdate();
+    hp.enableExternalUpdate();
+    hp.setSettingsChangedCallback([unit]() { snapshotStale[unit] = true; });
+    hp.setStatusChangedCallback([unit](heatpumpStatus) { snapshotStale[unit] = true; });
+    refreshSnapshot(unit);
   }
+  rtcRestore();
 
-  connectWifiOrRestart(true);
+  modbusSetup();
+  timersSetup();
+#if TASKS_ENABLED
+  startTasks();
+#endif
+  bootMark(BOOT_SETUP_DONE);
+}
 
+// Called once WiFi is up
+void networkSetup()
+{
   arduinoOTASetup();
-  // Start local webserver
-  if (HTTP_SERVER_ENABLED)
+  // Start local webserver, unless memory already ran low
+  if (HTTP_SERVER_ENABLED && !heapLow())
   {
-    DEBUG_PRINT("Starting HTTP Server ");
-    DEBUG_PRINTLN(WiFi.localIP().toString());
+    IPAddress ip = WiFi.localIP();
+    LOG_PRINTF(LOG_DEBUG, "Starting HTTP Server %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
     httpServer.reset(new WebServer(WiFi.localIP(), 80));
+    static const char *headerKeys[] = {"If-None-Match"};
+    httpServer->collectHeaders(headerKeys, 1);
     httpServer->on("/", handleHttpHvac);
+    httpServer->on("/api/state", HTTP_GET, handleHttpApiState);
+    httpServer->on("/api/set", HTTP_POST, handleHttpApiSet);
+    httpServer->on("/api/events", HTTP_GET, handleHttpApiEvents);
+    httpServer->on("/api/profile", HTTP_GET, handleHttpApiProfile);
+    httpServer->on("/metrics", HTTP_GET, handleHttpMetrics);
+    httpServer->on("/api/profile/reset", HTTP_POST, handleHttpApiProfileReset);
+    httpServer->on("/api/heap", HTTP_GET, handleHttpApiHeap);
+    httpServer->on("/api/boot", HTTP_GET, handleHttpApiBoot);
+    httpServer->on("/api/timers", HTTP_GET, handleHttpApiTimers);
+    httpServer->on("/api/timers", HTTP_POST, handleHttpApiTimersSet);
     httpServer->onNotFound(handleHttpNotFound);
     httpServer->begin();
   }
@@ -482,199 +920,991 @@ void setup()
   {
     DEBUG_PRINTLN("HTTP Server disabled.");
   }
-
-  modbusSetup();
+  if (MODBUS_SERVER_ENABLED)
+  {
+    uint8_t blocks = sizeof(MODBUS_REGISTER_BLOCKS) / sizeof(MODBUS_REGISTER_BLOCKS[0]);
+    modbusServerBegin(MODBUS_REGISTER_BLOCKS, LOOP_PROFILER_ENABLED ? blocks : blocks - 1, HEATPUMP_UNITS);
+  }
 }
 
-void maybeReconnectModbus()
+// mb->connect() waits for a server that does not answer as long as the
+// core's client timeout allows (5 s on the ESP8266), and the library has no
+// say in it. A probe connection with our own timeout goes first, so that a
+// dead server holds loop() for REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS at most.
+bool modbusServerReachable(const ModbusTarget &target)
 {
-  if (!mb->isConnected(REMOTE_MODBUS_IP))
-  {
-    bool connected = mb->connect(REMOTE_MODBUS_IP, REMOTE_MODBUS_PORT);
-    DEBUG_PRINTLN("Modbus client not connected. Trying to connect... Success: " + String(connected));
-  }
+  WiFiClient probe;
+#ifdef ESP32
+  bool reachable = probe.connect(target.ip, target.port, REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS);
+#else
+  probe.setTimeout(REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS);
+  bool reachable = probe.connect(target.ip, target.port);
+#endif
+  probe.stop();
+  return reachable;
 }
 
-boolean modbusRead()
+bool maybeReconnectModbus(ModbusTarget &target)
 {
-  bool readSuccess = false;
-  for (int i = 0; i < MODBUS_RETRIES; i++)
+  if (!mb->isConnected(target.ip))
   {
-    maybeReconnectModbus();
-    readSuccess = mb->readHreg(REMOTE_MODBUS_IP, 0, holdingDataRead.begin(), holdingDataRead.size(), nullptr, REMOTE_MODBUS_UNIT_ID);
-    if (readSuccess)
+    metricInc(COUNTER_MODBUS_CONNECTS);
+    bool connected = modbusServerReachable(target) && mb->connect(target.ip, target.port);
+    LOG_PRINTF(LOG_DEBUG, "Modbus client not connected to target %u. Trying to connect... Success: %d",
+               modbusTargetIndex(target), connected);
+    if (connected)
     {
-      prevModbusRead = millis();
-      break;
+      bootMark(BOOT_MODBUS_CONNECTED);
+    }
+    // Remote may have restarted, do not trust what it acknowledged before
+    for (RemoteBlock &remote : target.blocks)
+    {
+      remote.ackedValid = false;
     }
-    delay(MODBUS_RETRY_SLEEP);
+    return connected;
   }
-  return readSuccess;
+  return true;
 }
 
-boolean modbusWrite()
+// Completion callback for client transactions, called from mb->task()
+bool modbusTransactionDone(Modbus::ResultCode event, uint16_t transactionId, void *)
 {
-  holdingDataWrite = getHoldingRegistersToWrite();
-  bool writeSuccess = false;
-  for (int i = 0; i < MODBUS_RETRIES; i++)
+  for (ModbusTarget &target : modbusTargets)
   {
-    maybeReconnectModbus();
-    writeSuccess = mb->writeHreg(REMOTE_MODBUS_IP, /* offset */ HOLDING_READ_COUNT, holdingDataWrite.begin(), holdingDataWrite.size(), nullptr, REMOTE_MODBUS_UNIT_ID);
-    if (writeSuccess)
+    if (transactionId == target.transaction)
     {
-      String dataWritten = "Modbus data written: ";
-      for (auto it = holdingDataWrite.begin(), end = holdingDataWrite.end(); it != end; it++)
-      {
-        dataWritten += String(*it);
-        if (it + 1 != end)
-        {
-          dataWritten += ", ";
-        }
-      }
-      DEBUG_PRINTLN(dataWritten);
-      prevModbusWrite = millis();
-      return true;
-    }
-    else
-    {
-      mb->disconnect(REMOTE_MODBUS_IP);
+      target.result = event;
+      target.resultReady = true;
     }
-    delay(MODBUS_RETRY_SLEEP);
   }
-  return false;
+  return true;
 }
 
-void modbusLoop()
+void modbusClientEnter(ModbusTarget &target, ModbusClientState state)
 {
-  if (MODBUS_CLIENT_ENABLED)
+  target.state = state;
+  target.stateEntered = millis();
+}
+
+// A quarter of the way towards 100 on success, towards 0 on failure
+void modbusTargetHealth(ModbusTarget &target, bool ok)
+{
+  if (ok)
   {
-    yield();
-    maybeReconnectModbus();
-    //
-    // have a chance to progress on the background with other modbus activities
-    //
-    yield();
-    mb->task();
-    yield();
-
-    //
-    // read commands
-    //
-    if (mb->isConnected(REMOTE_MODBUS_IP) && millis() - prevModbusRead > REMOTE_MODBUS_READ_INTERVAL_MILLIS)
-    {
-      bool prevPowerOn = lastCommandPower;
-      bool readSuccess = modbusRead();
-      bool newCommand = holdingDataRead[0] != 0;
-      if (readSuccess)
-      {
-        if (prevModbusRead == 0 || lastCommandPower != newCommand)
-        {
-          hvacCommandsPending = true;
-        }
-        lastCommandPower = newCommand;
-      }
-      else
-      {
-        mb->disconnect(REMOTE_MODBUS_IP);
+    target.health += (100 - target.health + 3) / 4;
+  }
+  else
+  {
+    target.health -= (target.health + 3) / 4;
+  }
+}
+
+bool isCommandTarget(const ModbusTarget &target)
+{
+  return &target == &modbusTargets[commandTarget];
+}
+
+// Commands are read from the first target in REMOTE_MODBUS_TARGETS that is
+// at least REMOTE_MODBUS_HEALTHY, or from the healthiest if none is
+void modbusChooseCommandTarget()
+{
+  // The current one on a tie
+  uint8_t chosen = commandTarget;
+  for (uint8_t i = 0; i < REMOTE_TARGET_COUNT; i++)
+  {
+    if (modbusTargets[i].health > modbusTargets[chosen].health)
+    {
+      chosen = i;
+    }
+  }
+  for (uint8_t i = 0; i < REMOTE_TARGET_COUNT; i++)
+  {
+    if (modbusTargets[i].health >= REMOTE_MODBUS_HEALTHY)
+    {
+      chosen = i;
+      break;
+    }
+  }
+  if (chosen == commandTarget)
+  {
+    return;
+  }
+  metricInc(COUNTER_MODBUS_COMMAND_TARGET_CHANGES);
+  LOG_PRINTF(LOG_WARNING, "Reading commands from Modbus target %u (health %u) instead of %u (health %u)", chosen,
+             modbusTargets[chosen].health, commandTarget, modbusTargets[commandTarget].health);
+  commandTarget = chosen;
+  // Without waiting for the next read interval
+  for (PlcCommand &command : plcCommands)
+  {
+    command.readDue = true;
+  }
+}
+
+bool modbusReadDue(const ModbusTarget &target, uint8_t unit)
+{
+  return isCommandTarget(target) && plcCommands[unit].readDue;
+}
+
+// First register of the block of the unit in progress on the remote server
+uint16_t modbusUnitBase(const ModbusTarget &target)
+{
+  return target.unit * REMOTE_MODBUS_UNIT_OFFSET;
+}
+
+boolean modbusRead(ModbusTarget &target)
+{
+  RemoteBlock &remote = target.blocks[target.unit];
+  target.resultReady = false;
+  target.transaction = mb->readHreg(target.ip, modbusUnitBase(target), remote.read.begin(), remote.read.size(), modbusTransactionDone, REMOTE_MODBUS_UNIT_ID);
+  return target.transaction != 0;
+}
+
+// Registers that change on every write (MILLIS_SINCE_LAST_COMMS) go out
+// with full refreshes only
+bool isHeartbeatOnlyRegister(size_t address)
+{
+  return HOLDING_REGISTERS[address].heartbeatOnly;
+}
+
+void modbusWriteBegin(ModbusTarget &target)
+{
+  RemoteBlock &remote = target.blocks[target.unit];
+  remote.write = getHoldingRegistersToWrite(target.unit);
+  target.writeCycle = true;
+  remote.writeDue = false;
+  target.writeFull = !REMOTE_MODBUS_DELTA_WRITES || !remote.ackedValid || remote.fullWriteDue;
+  // TIMEOUT is the PLC's watchdog: it counts up there and goes back to
+  // zero with every write cycle, so it is never up to date on our side
+  size_t timeout = HOLDING_REG_TIMEOUT_COUNTER - HOLDING_WRITE_BEGIN;
+  remote.acked[timeout] = ~remote.write[timeout];
+}
+
+void modbusWriteEnd(ModbusTarget &target)
+{
+  target.writeCycle = false;
+}
+
+bool holdingRegisterDirty(const ModbusTarget &target, size_t i)
+{
+  const RemoteBlock &remote = target.blocks[target.unit];
+  return !isHeartbeatOnlyRegister(i + HOLDING_WRITE_BEGIN) && remote.write[i] != remote.acked[i];
+}
+
+// Picks the next range of the unit's write image to send: the whole block on full
+// refresh, otherwise the first run of adjacent changed registers.
+// Returns false once the remote image is up to date.
+bool nextModbusWriteRange(ModbusTarget &target)
+{
+  if (target.writeFull)
+  {
+    target.writeOffset = 0;
+    target.writeCount = HOLDING_WRITE_COUNT;
+    return true;
+  }
+  size_t begin = 0;
+  while (begin < HOLDING_WRITE_COUNT && !holdingRegisterDirty(target, begin))
+  {
+    begin++;
+  }
+  size_t end = begin;
+  while (end < HOLDING_WRITE_COUNT && holdingRegisterDirty(target, end))
+  {
+    end++;
+  }
+  target.writeOffset = begin;
+  target.writeCount = end - begin;
+  return target.writeCount > 0;
+}
+
+// Single registers go out as FC06, ranges as FC16
+boolean modbusWrite(ModbusTarget &target)
+{
+  RemoteBlock &remote = target.blocks[target.unit];
+  target.resultReady = false;
+  uint16_t offset = modbusUnitBase(target) + HOLDING_WRITE_BEGIN + target.writeOffset;
+  if (target.writeCount == 1)
+  {
+    target.transaction = mb->writeHreg(target.ip, offset, remote.write[target.writeOffset], modbusTransactionDone, REMOTE_MODBUS_UNIT_ID);
+  }
+  else
+  {
+    target.transaction = mb->writeHreg(target.ip, offset, remote.write.begin() + target.writeOffset, target.writeCount, modbusTransactionDone, REMOTE_MODBUS_UNIT_ID);
+  }
+  return target.transaction != 0;
+}
+
+// FC23: write the next range and read the command in the same transaction
+boolean modbusReadWrite(ModbusTarget &target)
+{
+  RemoteBlock &remote = target.blocks[target.unit];
+  target.resultReady = false;
+  target.transaction = mb->readWriteHreg(target.ip, modbusUnitBase(target), remote.read.begin(), remote.read.size(),
+                                         modbusUnitBase(target) + HOLDING_WRITE_BEGIN + target.writeOffset, remote.write.begin() + target.writeOffset,
+                                         target.writeCount, modbusTransactionDone, REMOTE_MODBUS_UNIT_ID);
+  return target.transaction != 0;
+}
+
+// Starts a write cycle when the interval has passed. Returns true while
+// the cycle has a range left to send.
+bool modbusWritePending(ModbusTarget &target)
+{
+  if (!target.writeCycle)
+  {
+    if (!target.blocks[target.unit].writeDue)
+    {
+      return false;
+    }
+    modbusWriteBegin(target);
+  }
+  if (nextModbusWriteRange(target))
+  {
+    return true;
+  }
+  modbusWriteEnd(target);
+  return false;
+}
+
+void rtcSaveTimer();
+
+// Each command is passed on at boot and whenever the PLC changes it, so
+// that unchanged ones cost no heat pump traffic and do not undo changes
+// made meanwhile from the web UI
+void modbusReadDone(ModbusTarget &target)
+{
+  bootMark(BOOT_MODBUS_FIRST_READ);
+  PlcCommand &command = plcCommands[target.unit];
+  const RemoteBlock &remote = target.blocks[target.unit];
+  int submitted = 0;
+  for (uint8_t address = 0; address < HOLDING_READ_COUNT; address++)
+  {
+    const HoldingRegister &reg = HOLDING_REGISTERS[address];
+    if (reg.access != REG_COMMAND)
+    {
+      continue;
+    }
+    // Any non-zero power command is on
+    uint16_t value = address == HOLDING_REG_POWER_COMMAND ? remote.read[address] != 0 : remote.read[address];
+    if (command.submitted[address] && command.values[address] == value)
+    {
+      continue;
+    }
+    command.values[address] = value;
+    if (!settingValueValid(HOLDING_REGISTERS[reg.setting], value))
+    {
+      LOG_THROTTLED(LOG_WARNING, 1000, 1, "Ignoring %s %u for unit %u, out of range", reg.name, value, target.unit);
+      command.submitted[address] = true;
+      continue;
+    }
+    // Tried again with the next read if the queue is full
+    command.submitted[address] = submitCommand(COMMAND_SOURCE_PLC, target.unit, reg.setting, value);
+    submitted++;
+  }
+  command.readDue = false;
+  if (submitted > 0)
+  {
+    // Not to lose them to a reset before the next save
+    rtcSaveTimer();
+  }
+  DEBUG_PRINTF_THROTTLED("Modbus client connected. Read registers of unit %u from target %u. Power command %u, %d commands submitted",
+                         target.unit, modbusTargetIndex(target), command.values[HOLDING_REG_POWER_COMMAND], submitted);
+}
+
+void modbusWriteDone(ModbusTarget &target)
+{
+  bootMark(BOOT_MODBUS_FIRST_WRITE);
+  RemoteBlock &remote = target.blocks[target.unit];
+  for (size_t i = target.writeOffset; i < target.writeOffset + target.writeCount; i++)
+  {
+    remote.acked[i] = remote.write[i];
+  }
+  static LogThrottle writeThrottle;
+  if (LOG_ENABLED(LOG_DEBUG) && logThrottleAllow(writeThrottle, 1000, 1))
+  {
+    char dataWritten[LOG_RECORD_MAX];
+    size_t len = snprintf(dataWritten, sizeof(dataWritten), "Modbus data written to target %u at %d:", modbusTargetIndex(target),
+                          int(modbusUnitBase(target) + HOLDING_WRITE_BEGIN + target.writeOffset));
+    for (size_t i = target.writeOffset; i < target.writeOffset + target.writeCount && len < sizeof(dataWritten); i++)
+    {
+      len += snprintf(dataWritten + len, sizeof(dataWritten) - len, " %u", remote.write[i]);
+    }
+    logThrottledAppend(LOG_DEBUG | LOG_NEWLINE, writeThrottle, dataWritten, std::min(len, sizeof(dataWritten) - 1));
+  }
+  if (target.writeFull)
+  {
+    remote.ackedValid = true;
+    target.writeFull = false;
+    remote.fullWriteDue = false;
+  }
+}
+
+// Back off exponentially from MODBUS_RETRY_SLEEP. Every MODBUS_RETRIES
+// consecutive failures the connection is dropped and re-established.
+void modbusClientFailed(ModbusTarget &target, const char *operation, Counter counter)
+{
+  metricInc(counter);
+  modbusTargetHealth(target, false);
+  target.failures++;
+  // A server without FC23 may just drop the connection or not answer
+  if (counter == COUNTER_MODBUS_READ_WRITE_FAILURES && target.fc23Supported &&
+      ++target.fc23Failures >= MODBUS_FC23_MAX_FAILURES)
+  {
+    LOG_PRINTF(LOG_WARNING, "FC23 failed %u times in a row on target %u, using separate read and write",
+               target.fc23Failures, modbusTargetIndex(target));
+    target.fc23Supported = false;
+  }
+  target.backoffMillis = MODBUS_RETRY_SLEEP << std::min(target.failures - 1, 7);
+  target.backoffMillis = std::min(target.backoffMillis, (unsigned long)MODBUS_BACKOFF_MAX_MILLIS);
+  if (target.failures % MODBUS_RETRIES == 0)
+  {
+    mb->disconnect(target.ip);
+  }
+  if (target.writeCycle)
+  {
+    // Unknown whether the remote applied the write; start over with a full
+    // one right after the backoff
+    target.blocks[target.unit].ackedValid = false;
+    target.writeCycle = false;
+    target.blocks[target.unit].writeDue = true;
+  }
+  LOG_THROTTLED(LOG_WARNING, 1000, 1, "Modbus %s on target %u failed (%d in a row, result %d). Retrying in %lu ms",
+                operation, modbusTargetIndex(target), target.failures, int(target.result), target.backoffMillis);
+  modbusClientEnter(target, MODBUS_CLIENT_BACKOFF);
+}
+
+// Moves on to the next unit with a read or write due, round robin, unless
+// a write cycle is in progress
+void modbusNextUnit(ModbusTarget &target)
+{
+  if (target.writeCycle)
+  {
+    return;
+  }
+  for (uint8_t i = 1; i <= HEATPUMP_UNITS; i++)
+  {
+    uint8_t unit = (target.unit + i) % HEATPUMP_UNITS;
+    if (modbusReadDue(target, unit) || target.blocks[unit].writeDue)
+    {
+      target.unit = unit;
+      return;
+    }
+  }
+}
+
+//
+// Client state machine of one target. Starts at most one transaction at a
+// time and never waits for it: completion is signalled by
+// modbusTransactionDone() and picked up on a later pass. Units take turns.
+// connectTried is set once a target has tried to connect in this pass.
+//
+void modbusTargetLoop(ModbusTarget &target, bool &connectTried)
+{
+  switch (target.state)
+  {
+  case MODBUS_CLIENT_BACKOFF:
+    if (millis() - target.stateEntered < target.backoffMillis)
+    {
+      break;
+    }
+    modbusClientEnter(target, MODBUS_CLIENT_IDLE);
+    // fall through
+  case MODBUS_CLIENT_IDLE:
+  {
+    modbusNextUnit(target);
+    bool readDue = modbusReadDue(target, target.unit);
+    bool writePending = modbusWritePending(target);
+    if (!readDue && !writePending)
+    {
+      break;
+    }
+    if (!mb->isConnected(target.ip))
+    {
+      if (connectTried)
+      {
+        // Next pass, see modbusClientLoop()
+        break;
       }
-      DEBUG_PRINTLN_THROTTLED(2, "Modbus client connected. Reading registers, success: " + String(readSuccess) + String(". Last command power=") + String(newCommand) //
-                                     + String(", before that ") + String(prevPowerOn)                                                                                 //
-                                     + String(", pending write: ") + String(hvacCommandsPending));
+      connectTried = true;
     }
-    else
+    target.result = Modbus::EX_SUCCESS;
+    if (!maybeReconnectModbus(target))
     {
-      DEBUG_PRINTLN_THROTTLED(6, "(read skipped)");
+      modbusClientFailed(target, "connect", COUNTER_MODBUS_CONNECT_FAILURES);
     }
-    //
-    // have a chance to progress on the background with other modbus activities
-    //
-    yield();
-    mb->task();
-    yield();
-    //
-    // write current state
-    //
-    if (mb->isConnected(REMOTE_MODBUS_IP) && millis() - prevModbusWrite > REMOTE_MODBUS_WRITE_INTERVAL_MILLIS)
+    else if (writePending && isCommandTarget(target) && REMOTE_MODBUS_FC23 && target.fc23Supported)
     {
-      bool writeSuccess = modbusWrite();
-      DEBUG_PRINT_THROTTLED(3, "Modbus client connected. Wrote registers, success: " + String(writeSuccess));
+      // Every write carries a command read along
+      if (modbusReadWrite(target))
+      {
+        modbusClientEnter(target, MODBUS_CLIENT_READWRITING);
+      }
+      else
+      {
+        modbusClientFailed(target, "read/write request", COUNTER_MODBUS_READ_WRITE_FAILURES);
+      }
+    }
+    else if (readDue)
+    {
+      if (modbusRead(target))
+      {
+        modbusClientEnter(target, MODBUS_CLIENT_READING);
+      }
+      else
+      {
+        modbusClientFailed(target, "read request", COUNTER_MODBUS_READ_FAILURES);
+      }
     }
     else
     {
-      DEBUG_PRINTLN_THROTTLED(4, "(write skipped)");
+      if (modbusWrite(target))
+      {
+        modbusClientEnter(target, MODBUS_CLIENT_WRITING);
+      }
+      else
+      {
+        modbusClientFailed(target, "write request", COUNTER_MODBUS_WRITE_FAILURES);
+      }
+    }
+    break;
+  }
+  case MODBUS_CLIENT_READING:
+  case MODBUS_CLIENT_WRITING:
+  case MODBUS_CLIENT_READWRITING:
+  {
+    const char *operation = target.state == MODBUS_CLIENT_READING   ? "read"
+                            : target.state == MODBUS_CLIENT_WRITING ? "write"
+                                                                    : "read/write";
+    Counter failures = target.state == MODBUS_CLIENT_READING   ? COUNTER_MODBUS_READ_FAILURES
+                       : target.state == MODBUS_CLIENT_WRITING ? COUNTER_MODBUS_WRITE_FAILURES
+                                                               : COUNTER_MODBUS_READ_WRITE_FAILURES;
+    if (!target.resultReady)
+    {
+      if (millis() - target.stateEntered > MODBUS_TRANSACTION_TIMEOUT_MILLIS)
+      {
+        // Library never reported back, e.g. connection torn down underneath
+        target.transaction = 0;
+        target.result = Modbus::EX_TIMEOUT;
+        modbusClientFailed(target, operation, failures);
+      }
+      break;
+    }
+    if (target.state == MODBUS_CLIENT_READWRITING && target.result == Modbus::EX_ILLEGAL_FUNCTION)
+    {
+      // Nothing was written; the same range goes out with FC06/FC16 next
+      DEBUG_PRINTLN("Modbus server does not support FC23, using separate read and write");
+      target.fc23Supported = false;
+      modbusClientEnter(target, MODBUS_CLIENT_IDLE);
+      break;
+    }
+    if (target.result != Modbus::EX_SUCCESS)
+    {
+      modbusClientFailed(target, operation, failures);
+      break;
+    }
+    target.failures = 0;
+    if (target.state == MODBUS_CLIENT_READWRITING)
+    {
+      target.fc23Failures = 0;
+    }
+    modbusTargetHealth(target, true);
+    metricInc(target.state == MODBUS_CLIENT_READING   ? COUNTER_MODBUS_READS
+              : target.state == MODBUS_CLIENT_WRITING ? COUNTER_MODBUS_WRITES
+                                                      : COUNTER_MODBUS_READ_WRITES);
+    if (target.state != MODBUS_CLIENT_WRITING)
+    {
+      modbusReadDone(target);
     }
+    if (target.state != MODBUS_CLIENT_READING)
+    {
+      modbusWriteDone(target);
+    }
+    modbusClientEnter(target, MODBUS_CLIENT_IDLE);
+    break;
+  }
+  }
+}
+
+// Targets run side by side, each with its own transaction in flight, so
+// writes reach all of them in about the time one takes. Connecting blocks
+// until the server answers or REMOTE_MODBUS_CONNECT_TIMEOUT_MILLIS, so only
+// one target may try per pass: servers that are down take turns instead of
+// adding up.
+void modbusClientLoop()
+{
+  modbusChooseCommandTarget();
+  bool connectTried = false;
+  for (ModbusTarget &target : modbusTargets)
+  {
+    modbusTargetLoop(target, connectTried);
+  }
+}
+
+void modbusLoop()
+{
+  if (!networkStarted)
+  {
+    return;
   }
-  // TODO: simplify above (NOTE ONE BUG FOUND ALREADY)
   //
   // have a chance to progress on the background with other modbus activities
   //
   yield();
   mb->task();
   yield();
+  if (MODBUS_SERVER_ENABLED)
+  {
+    modbusServerLoop();
+  }
+  if (MODBUS_CLIENT_ENABLED)
+  {
+    modbusClientLoop();
+  }
 }
 
-void loop()
+void wifiLoop()
 {
-  DEBUG_PRINT_THROTTLED(0, "loop, uptime in secs: " + String(float(millis() / 1000.)));
-  connectWifiOrRestart(false);
-  yield();
-  if (!otaInProgress && WiFi.status() != WL_CONNECTED)
+  DEBUG_PRINTF_THROTTLED("loop, uptime in secs: %lu", millis() / 1000);
+  wifiFlow(wifiThread);
+}
+
+// Frees what the HTTP server holds, for good
+void httpStop()
+{
+  if (httpServer)
   {
-    DEBUG_PRINT("Wifi not connected, restarting!");
-    ESP.restart();
-    while (true)
-    {
-      // wait for reboot
-      delay(1000);
-    }
+    webUIEventsStop();
+    httpServer->stop();
+    httpServer.reset();
   }
-  modbusLoop();
-  yield();
-  ArduinoOTA.handle();
-  yield();
+}
+
+void otaLoop()
+{
+  if (networkStarted)
+  {
+    ArduinoOTA.handle();
+  }
+}
+
+void httpLoop()
+{
   if (httpServer)
   {
     httpServer->handleClient();
+    webUIEventsLoop(httpSnapshots[0]);
   }
-  yield();
-#ifdef DEBUG
-  DEBUG_PRINTLN_THROTTLED(5, "In debug mode, not syncing/connecting heat pump");
-#else
-  if (!hp->isConnected())
+}
+
+// Sends the connect packet to a unit that is not connected, and on its
+// next turn ends with probeAnswered[unit] set if anything came back. Only
+// then is it worth HeatPump::connect(), which waits 2 s for the line to
+// settle before it sends anything, holding up loop() all the while.
+PtState heatpumpProbeFlow(Protothread &pt, uint8_t unit)
+{
+  HardwareSerial &serial = *heatpumpSerials[unit];
+  PT_BEGIN(pt);
+  PT_WAIT_UNTIL(pt, millis() - lastConnectMillis[unit] >= HEATPUMP_RECONNECT_MILLIS);
+  lastConnectMillis[unit] = millis();
+  serial.begin(HEATPUMP_BAUD, SERIAL_8E1);
+  while (serial.available() > 0)
   {
-    hp->connect(&heatpumpSerial);
+    serial.read();
   }
-  yield();
+  serial.write(CN105_CONNECT, sizeof(CN105_CONNECT));
+  PT_YIELD(pt);
+  probeAnswered[unit] = serial.available() > 0;
+  // connect() gets its own answer
+  while (serial.available() > 0)
+  {
+    serial.read();
+  }
+  PT_END(pt);
+}
+
+// Right away at boot, when a unit is expected. After that only once a
+// probe was answered.
+bool heatpumpConnectDue(uint8_t unit)
+{
+  if (!connectTried[unit])
+  {
+    connectTried[unit] = true;
+    return true;
+  }
+  return heatpumpProbeFlow(probeThreads[unit], unit) == PT_ENDED && probeAnswered[unit];
+}
+
+// Polls one unit per call, in turn, so that each has its exchange every
+// HEATPUMP_POLL_INTERVAL_MILLIS
+// True if this turn connected the unit. Its first exchange is then due
+// as soon as the packet gap after the connect packet is over, and it has
+// the next turn.
+bool heatpumpLoop()
+{
+  commandsReceive();
+  uint8_t unit = heatpumpNext;
+  heatpumpNext = (heatpumpNext + 1) % HEATPUMP_UNITS;
+  HeatPump &hp = heatpumps[unit];
   bool updated = false;
-  if (hp->isConnected())
+#ifdef DEBUG
+  DEBUG_PRINTF_THROTTLED("In debug mode, not syncing/connecting heat pump");
+#else
+  if (!hp.isConnected() && heatpumpConnectDue(unit))
   {
-    bool upToDatePowerCommandAvailable = (prevModbusRead != 0) && (millis() - prevModbusRead < 60000);
-    if (hvacCommandsPending && upToDatePowerCommandAvailable)
+    lastConnectMillis[unit] = millis();
+    if (hp.connect(heatpumpSerials[unit].get()))
     {
-      DEBUG_PRINTLN("Setting power to " + String(lastCommandPower));
-      hp->setPowerSetting(lastCommandPower);
+      bootMark(BOOT_HEATPUMP_CONNECTED);
+      // update() would hold loop() for the library's packet gap after the
+      // connect packet
+      heatpumpNext = unit;
+      return true;
     }
-    updated = hp->update();
+  }
+  yield();
+  if (hp.isConnected())
+  {
+    // All pending changes go out with this one update()
+    applyPendingCommands(unit);
+    updated = hp.update();
   }
 #endif
   yield();
   if (updated)
   {
-    prevHeatpumpComms = millis();
-    bool powerOnCurrently = hp->getPowerSettingBool();
-    if (powerOnCurrently == lastCommandPower)
+    bootMark(BOOT_HEATPUMP_CONTACT);
+    metricInc(COUNTER_HEATPUMP_UPDATES);
+    snapshotRestored[unit] = false;
+    prevHeatpumpComms[unit] = millis();
+    refreshSnapshot(unit);
+    confirmPendingCommands(unit);
+  }
+  else
+  {
+    metricInc(COUNTER_HEATPUMP_UPDATE_FAILURES);
+    LOG_PRINTF(LOG_WARNING, "Failed to update() heatpump %u", unit);
+  }
+  if (snapshotStale[unit] && !snapshotRestored[unit])
+  {
+    refreshSnapshot(unit);
+  }
+  return false;
+}
+
+//
+// Timer callbacks. Under loop() they mark their profiler stage, in ESP32
+// tasks they time themselves.
+//
+#if TASKS_ENABLED
+struct TaskStage
+{
+  LoopStage stage;
+  uint32_t start;
+  TaskStage(LoopStage stage) : stage(stage), start(micros()) {}
+  ~TaskStage() { profilerRecord(stage, micros() - start); }
+};
+#define TIMER_STAGE(stage) TaskStage taskStage(stage)
+#else
+#define TIMER_STAGE(stage) LOOP_STAGE(stage)
+#endif
+
+void wifiTimer()
+{
+  TIMER_STAGE(LOOP_STAGE_WIFI);
+  wifiLoop();
+}
+
+static TimerId heatpumpTimerId = TIMER_NONE;
+
+void heatpumpTimer()
+{
+  TIMER_STAGE(LOOP_STAGE_HEATPUMP);
+  // Counted from the end of the exchange, which update() would otherwise
+  // hold up to keep its 1 s gap between packets. After a connect, a tick
+  // short of the gap: the wheel may fire a tick late, and update() waits
+  // out the rest.
+  uint32_t next = heatpumpLoop() ? HEATPUMP_PACKET_GAP_MILLIS
+                                 : heatpumpTimers.period(heatpumpTimerId);
+  heatpumpTimers.start(heatpumpTimerId, next);
+}
+
+void logTimer()
+{
+  TIMER_STAGE(LOOP_STAGE_LOG);
+  logFlush();
+  restartFlow(restartThread);
+}
+
+void modbusReadTimer()
+{
+  for (PlcCommand &command : plcCommands)
+  {
+    command.readDue = true;
+  }
+}
+
+void modbusWriteTimer()
+{
+  for (ModbusTarget &target : modbusTargets)
+  {
+    for (RemoteBlock &remote : target.blocks)
     {
-      if (hvacCommandsPending)
+      remote.writeDue = true;
+    }
+  }
+}
+
+void modbusFullWriteTimer()
+{
+  for (ModbusTarget &target : modbusTargets)
+  {
+    for (RemoteBlock &remote : target.blocks)
+    {
+      remote.fullWriteDue = true;
+    }
+  }
+}
+
+// Right after a heat pump exchange, so that a restart does not cut one
+// short, with no OTA update and no settings change for a while
+bool quietMoment()
+{
+  // Since the latest exchange with any unit
+  unsigned long commsAge = ULONG_MAX;
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+  {
+    unsigned long commsMillis = httpSnapshots[unit].commsMillis;
+    if (commsMillis != 0)
+    {
+      commsAge = std::min(commsAge, millis() - commsMillis);
+    }
+  }
+  return !otaInProgress && millis() - commandLastSubmitMillis() > LOW_MEMORY_QUIET_MILLIS &&
+         commsAge < HEATPUMP_POLL_INTERVAL_MILLIS / HEATPUMP_UNITS / 2;
+}
+
+// Once the heap runs low, sheds the HTTP server so that Modbus and the heat
+// pump keep going, then restarts at a quiet moment
+PtState lowMemoryFlow(Protothread &pt)
+{
+  PT_BEGIN(pt);
+  PT_WAIT_UNTIL(pt, heapLow());
+  LOG_PRINTF(LOG_WARNING, "Low memory, largest free block %lu bytes. Stopping HTTP server, restarting when quiet",
+             (unsigned long)heapLowestMaxBlock());
+  httpStop();
+  pt.millis = millis();
+  PT_WAIT_UNTIL(pt, quietMoment() || millis() - pt.millis > LOW_MEMORY_RESTART_MAX_WAIT_MILLIS);
+  LOG_PRINTLN(LOG_WARNING, "Restarting for low memory");
+  restart(RESTART_LOW_MEMORY);
+  PT_WAIT_UNTIL(pt, false);
+  PT_END(pt);
+}
+
+// Serves what a unit reported before the restart until it answers
+void restoreSnapshot(uint8_t unit, const uint16_t *holding)
+{
+  HeatpumpSnapshot &snapshot = snapshots[unit];
+  memcpy(snapshot.holding, holding, sizeof(snapshot.holding));
+  snapshot.holding[HOLDING_REG_CONNECTED_INDEX] = 0;
+  snapshot.settings.power = POWER_ENUM.fromIndex(holding[HOLDING_REG_POWER_INDEX]);
+  snapshot.settings.mode = MODE_ENUM.fromIndex(holding[HOLDING_REG_MODE_INDEX]);
+  snapshot.settings.temperature = holding[HOLDING_REG_TEMPERATURE_INDEX] / 10.0f;
+  snapshot.settings.fan = FAN_ENUM.fromIndex(holding[HOLDING_REG_FAN_INDEX]);
+  snapshot.settings.vane = VANE_ENUM.fromIndex(holding[HOLDING_REG_VANE_INDEX]);
+  snapshot.settings.wideVane = WIDEVANE_ENUM.fromIndex(holding[HOLDING_REG_WIDEVANE_INDEX]);
+  snapshot.settings.connected = false;
+  snapshot.roomTemperature = holding[HOLDING_REG_ROOM_TEMPERATURE_INDEX] / 10.0f;
+  snapshot.sequence++;
+  snapshotRestored[unit] = true;
+#if TASKS_ENABLED
+  sharedSnapshots[unit].write(snapshot);
+#endif
+}
+
+// Picks up where the last run left off, see rtc_state.h. The last PLC
+// commands go out with the first heat pump exchange instead of after WiFi
+// and the first read, which then only passes on what changed meanwhile.
+void rtcRestore()
+{
+  if (!rtcStateBegin())
+  {
+    return;
+  }
+  // The heat pump was switched off on purpose, see wifiFlow(). The PLC
+  // decides again once it can be reached.
+  bool reapply = rtcLastRestartReason() != RESTART_WIFI_DOWN;
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+  {
+    const RtcUnitState &saved = rtcUnitState(unit);
+    if (saved.snapshotValid)
+    {
+      restoreSnapshot(unit, saved.holding);
+    }
+    for (uint8_t address = 0; reapply && address < HOLDING_LEN; address++)
+    {
+      const HoldingRegister &reg = HOLDING_REGISTERS[address];
+      uint16_t value = saved.commands[address];
+      if (reg.access != REG_COMMAND || !(saved.commandsSubmitted & (1UL << address)) ||
+          !settingValueValid(HOLDING_REGISTERS[reg.setting], value))
       {
-        DEBUG_PRINTLN("Power successfully set to " + String(lastCommandPower) +
-                      ". Reseting hvacCommandsPending flag");
+        continue;
       }
-      // HVAC state is synchronized to target state
-      hvacCommandsPending = false;
+      PlcCommand &command = plcCommands[unit];
+      command.values[address] = value;
+      // Left to the first read if the queue is full
+      command.submitted[address] = submitCommand(COMMAND_SOURCE_PLC, unit, reg.setting, value);
     }
   }
-  else
+}
+
+// From the Modbus side, whose snapshot copies and PLC commands these are
+void rtcSaveTimer()
+{
+  RtcUnitState units[HEATPUMP_UNITS] = {};
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+  {
+    const HeatpumpSnapshot &snapshot = modbusSnapshots[unit];
+    const PlcCommand &command = plcCommands[unit];
+    RtcUnitState &state = units[unit];
+    // Before the unit first answers, the snapshot is what was restored
+    state.snapshotValid = snapshot.commsMillis != 0 || rtcUnitState(unit).snapshotValid;
+    memcpy(state.holding, snapshot.holding, sizeof(state.holding));
+    memcpy(state.commands, command.values, sizeof(state.commands));
+    for (uint8_t address = 0; address < HOLDING_LEN; address++)
+    {
+      state.commandsSubmitted |= command.submitted[address] ? 1UL << address : 0;
+    }
+  }
+  rtcStateSave(units);
+}
+
+void heapTimer()
+{
+  heapCheck();
+  lowMemoryFlow(lowMemoryThread);
+}
+
+// Periods can be changed at runtime, see /api/timers
+void timersSetup()
+{
+  bool added = true;
+  // One unit per run
+  heatpumpTimerId = heatpumpTimers.add("heatpump", heatpumpTimer, HEATPUMP_POLL_INTERVAL_MILLIS / HEATPUMP_UNITS);
+  added &= heatpumpTimerId != TIMER_NONE;
+  // Polled fast until associated, see wifiFlow()
+  wifiTimerId = networkTimers.add("wifi", wifiTimer, WIFI_CONNECT_POLL_MILLIS);
+  added &= wifiTimerId != TIMER_NONE;
+  added &= networkTimers.add("log", logTimer, LOG_FLUSH_INTERVAL_MILLIS) != TIMER_NONE;
+  added &= networkTimers.add("heap", heapTimer, HEAP_CHECK_INTERVAL_MILLIS) != TIMER_NONE;
+  added &= modbusTimers.add("rtc_save", rtcSaveTimer, RTC_STATE_SAVE_INTERVAL_MILLIS) != TIMER_NONE;
+  if (MODBUS_CLIENT_ENABLED)
+  {
+    added &= modbusTimers.add("modbus_read", modbusReadTimer, REMOTE_MODBUS_READ_INTERVAL_MILLIS,
+                              REMOTE_MODBUS_JITTER_MILLIS) != TIMER_NONE;
+    added &= modbusTimers.add("modbus_write", modbusWriteTimer, REMOTE_MODBUS_WRITE_INTERVAL_MILLIS,
+                              REMOTE_MODBUS_JITTER_MILLIS) != TIMER_NONE;
+    added &= modbusTimers.add("modbus_full_write", modbusFullWriteTimer, REMOTE_MODBUS_FULL_REFRESH_MILLIS) != TIMER_NONE;
+  }
+  if (!added)
+  {
+    LOG_PRINTF(LOG_ERR, "Some periodic work will never run, raise TIMER_WHEEL_CAPACITY (%u)", TIMER_WHEEL_CAPACITY);
+  }
+}
+
+#if TASKS_ENABLED
+//
+// ESP32 tasks. The heat pump task has core 1 to itself and the highest
+// priority of the three, so its serial exchanges keep their pace whatever
+// the network does. Modbus and HTTP/OTA/logging share core 0 with the WiFi
+// stack. The tasks talk only through the command queue (commands.h) and
+// sharedSnapshots.
+//
+#define HEATPUMP_TASK_CORE 1
+#define HEATPUMP_TASK_PRIORITY 3
+#define HEATPUMP_TASK_STACK 4096
+#define MODBUS_TASK_CORE 0
+#define MODBUS_TASK_PRIORITY 2
+#define MODBUS_TASK_STACK 4096
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 1
+#define NETWORK_TASK_STACK 8192
+
+// Copies the published snapshots of all units into a task's own
+void readSnapshots(HeatpumpSnapshot *copies)
+{
+  for (uint8_t unit = 0; unit < HEATPUMP_UNITS; unit++)
+  {
+    sharedSnapshots[unit].read(copies[unit]);
+  }
+}
+
+// Sleeps until the next heat pump timer is due
+void heatpumpTask(void *)
+{
+  while (true)
+  {
+    heatpumpTimers.run();
+    uint32_t sleepMillis = heatpumpTimers.millisUntilNext(HEATPUMP_POLL_INTERVAL_MILLIS / HEATPUMP_UNITS);
+    vTaskDelay(std::max<TickType_t>(1, pdMS_TO_TICKS(sleepMillis)));
+  }
+}
+
+void modbusTask(void *)
+{
+  while (true)
   {
-    DEBUG_PRINTLN("Failed to update() heatpump");
+    modbusTimers.run();
+    uint32_t start = micros();
+    readSnapshots(modbusSnapshots);
+    modbusLoop();
+    profilerRecord(LOOP_STAGE_MODBUS, micros() - start);
+    vTaskDelay(1);
   }
-}
\ No newline at end of file
+}
+
+void networkTask(void *)
+{
+  while (true)
+  {
+    networkTimers.run();
+    uint32_t start = micros();
+    otaLoop();
+    uint32_t otaDone = micros();
+    profilerRecord(LOOP_STAGE_OTA, otaDone - start);
+    readSnapshots(httpSnapshots);
+    httpLoop();
+    profilerRecord(LOOP_STAGE_HTTP, micros() - otaDone);
+    vTaskDelay(1);
+  }
+}
+
+void startTasks()
+{
+  readSnapshots(modbusSnapshots);
+  readSnapshots(httpSnapshots);
+  xTaskCreatePinnedToCore(heatpumpTask, "heatpump", HEATPUMP_TASK_STACK, NULL, HEATPUMP_TASK_PRIORITY, NULL, HEATPUMP_TASK_CORE);
+  xTaskCreatePinnedToCore(modbusTask, "modbus", MODBUS_TASK_STACK, NULL, MODBUS_TASK_PRIORITY, NULL, MODBUS_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, NULL, NETWORK_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
+}
+#endif
+
+// Sockets are serviced on every pass, everything else only when its timer
+// is due
+void loop()
+{
+#if TASKS_ENABLED
+  // Everything runs in the tasks started by setup()
+  vTaskDelete(NULL);
+#else
+  LOOP_STAGE(LOOP_STAGE_MODBUS);
+  modbusLoop();
+  yield();
+  LOOP_STAGE(LOOP_STAGE_OTA);
+  otaLoop();
+  yield();
+  LOOP_STAGE(LOOP_STAGE_HTTP);
+  httpLoop();
+  yield();
+  // Due callbacks mark their own stages
+  timers.run();
+  LOOP_END();
+#endif
+}
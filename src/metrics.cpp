@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include "constants.h"
+#include "debug_utils.h"
+#include "heap_monitor.h"
+#include "metrics.h"
+#include "modbus_server.h"
+#include "rtc_state.h"
+
+#define METRIC_PREFIX "mitsuremote_"
+
+uint32_t metricCounters[COUNTER_LEN];
+
+struct CounterInfo
+{
+    const char *name;
+    // Label set including braces, or empty
+    const char *labels;
+    const char *help;
+};
+
+static const CounterInfo COUNTER_INFO[COUNTER_LEN] = {
+    {"modbus_connects_total", "", "Connection attempts to the remote Modbus server"},
+    {"modbus_connect_failures_total", "", "Failed connection attempts to the remote Modbus server"},
+    {"modbus_transactions_total", "{op=\"read\"}", "Completed Modbus client transactions"},
+    {"modbus_transactions_total", "{op=\"write\"}", ""},
+    {"modbus_transactions_total", "{op=\"read_write\"}", ""},
+    {"modbus_transaction_failures_total", "{op=\"read\"}", "Failed Modbus client transactions, retried after a backoff"},
+    {"modbus_transaction_failures_total", "{op=\"write\"}", ""},
+    {"modbus_transaction_failures_total", "{op=\"read_write\"}", ""},
+    {"modbus_command_target_changes_total", "", "Times the power command moved to another remote Modbus server"},
+    {"modbus_server_connections_total", "{event=\"accepted\"}", "Modbus server connections by event, see modbus_server.h"},
+    {"modbus_server_connections_total", "{event=\"evicted\"}", ""},
+    {"modbus_server_connections_total", "{event=\"rejected\"}", ""},
+    {"modbus_server_connections_total", "{event=\"idle_closed\"}", ""},
+    {"modbus_server_requests_total", "", "Requests answered by the Modbus server, exceptions included"},
+    {"modbus_server_exceptions_total", "", "Modbus server exception responses"},
+    {"heatpump_updates_total", "", "Successful HeatPump::update() calls"},
+    {"heatpump_update_failures_total", "", "Failed HeatPump::update() calls"},
+    {"heatpump_commands_total", "{result=\"applied\"}", "Settings commands by outcome, see commands.h"},
+    {"heatpump_commands_total", "{result=\"superseded\"}", ""},
+    {"heatpump_commands_total", "{result=\"rejected\"}", ""},
+    {"heatpump_commands_total", "{result=\"expired\"}", ""},
+    {"wifi_disconnects_total", "", "Times the WiFi connection was found down in loop()"},
+    {"ota_starts_total", "", "OTA updates started"},
+    {"ota_failures_total", "", "OTA updates failed"},
+};
+
+static void writeHeader(HttpStream &out, const char *name, const char *type, const char *help)
+{
+    out.printf("# HELP " METRIC_PREFIX "%s %s\n# TYPE " METRIC_PREFIX "%s %s\n", name, help, name, type);
+}
+
+static void writeGauge(HttpStream &out, const char *name, const char *help, unsigned long value)
+{
+    writeHeader(out, name, "gauge", help);
+    out.printf(METRIC_PREFIX "%s %lu\n", name, value);
+}
+
+void sendMetrics(WebServer &server, const HeatpumpSnapshot *snapshots, uint8_t units,
+                 const ModbusTargetMetrics *targets, uint8_t targetCount)
+{
+    HttpStream out(server, 200, "text/plain; version=0.0.4");
+    for (uint8_t i = 0; i < COUNTER_LEN; i++)
+    {
+        const CounterInfo &info = COUNTER_INFO[i];
+        if (i == 0 || strcmp(info.name, COUNTER_INFO[i - 1].name) != 0)
+        {
+            writeHeader(out, info.name, "counter", info.help);
+        }
+        out.printf(METRIC_PREFIX "%s%s %lu\n", info.name, info.labels, (unsigned long)metricCounters[i]);
+    }
+    writeHeader(out, "log_records_dropped_total", "counter", "Log records dropped because the log buffer was full");
+    out.printf(METRIC_PREFIX "log_records_dropped_total %lu\n", (unsigned long)logDroppedCount());
+
+    writeHeader(out, "restarts_total", "counter", "Restarts since power on by reason, see rtc_state.h");
+    for (uint8_t i = 0; i < RESTART_REASON_LEN; i++)
+    {
+        out.printf(METRIC_PREFIX "restarts_total{reason=\"%s\"} %lu\n", restartReasonName(RestartReason(i)),
+                   (unsigned long)rtcRestarts(RestartReason(i)));
+    }
+
+    writeGauge(out, "uptime_seconds", "Time since boot", millis() / 1000);
+    writeGauge(out, "last_run_uptime_seconds", "Uptime when the previous run ended, 0 after power on",
+               rtcLastRestartUptimeSeconds());
+    writeGauge(out, "rtc_state_restored", "1 if counters and state were restored from RTC memory at boot",
+               rtcStateRestored() ? 1 : 0);
+    HeapSample heap = heapRead();
+    writeGauge(out, "heap_free_bytes", "Free heap", heap.freeBytes);
+    writeGauge(out, "heap_max_free_block_bytes", "Largest allocatable heap block", heap.maxBlockBytes);
+    writeGauge(out, "heap_fragmentation_percent", "Heap fragmentation, 100 - largest block * 100 / free", heap.fragmentation);
+    writeGauge(out, "heap_lowest_max_free_block_bytes", "Lowest largest allocatable heap block since boot", heapLowestMaxBlock());
+    writeGauge(out, "modbus_server_clients", "Open Modbus server connections", modbusServerClients());
+    writeHeader(out, "modbus_target_health", "gauge", "Remote Modbus server health, 0 to 100");
+    for (uint8_t i = 0; i < targetCount; i++)
+    {
+        const uint8_t *ip = targets[i].ip;
+        out.printf(METRIC_PREFIX "modbus_target_health{target=\"%u\",ip=\"%u.%u.%u.%u\"} %u\n", i, ip[0], ip[1], ip[2],
+                   ip[3], targets[i].health);
+    }
+    writeHeader(out, "modbus_target_command_source", "gauge", "1 for the remote Modbus server the power command is read from");
+    for (uint8_t i = 0; i < targetCount; i++)
+    {
+        out.printf(METRIC_PREFIX "modbus_target_command_source{target=\"%u\"} %u\n", i, targets[i].commandSource ? 1 : 0);
+    }
+    writeHeader(out, "heatpump_connected", "gauge", "1 if the heat pump is connected");
+    for (uint8_t unit = 0; unit < units; unit++)
+    {
+        out.printf(METRIC_PREFIX "heatpump_connected{unit=\"%u\"} %u\n", unit, snapshots[unit].settings.connected ? 1 : 0);
+    }
+    writeHeader(out, "heatpump_last_comms_age_seconds", "gauge", "Time since the last successful heat pump update");
+    for (uint8_t unit = 0; unit < units; unit++)
+    {
+        if (snapshots[unit].commsMillis != 0)
+        {
+            out.printf(METRIC_PREFIX "heatpump_last_comms_age_seconds{unit=\"%u\"} %.3f\n", unit,
+                       (millis() - snapshots[unit].commsMillis) / 1000.0);
+        }
+    }
+    out.end();
+}
@@ -0,0 +1,68 @@
+#ifndef METRICS_H__
+#define METRICS_H__
+
+#include <stdint.h>
+#include "http_stream.h"
+#include "snapshot.h"
+
+///
+/// Operational counters. Code paths bump them with metricInc(), which is
+/// a single increment, and /metrics renders them in Prometheus text
+/// format together with a few gauges read at scrape time.
+///
+/// With ESP32_TASKS each counter is bumped from one task only, so the
+/// plain increment loses nothing.
+///
+/// Counters of one family (same metric name, different labels) must be
+/// consecutive, see COUNTER_INFO in metrics.cpp.
+///
+enum Counter : uint8_t
+{
+    COUNTER_MODBUS_CONNECTS,
+    COUNTER_MODBUS_CONNECT_FAILURES,
+    COUNTER_MODBUS_READS,
+    COUNTER_MODBUS_WRITES,
+    COUNTER_MODBUS_READ_WRITES,
+    COUNTER_MODBUS_READ_FAILURES,
+    COUNTER_MODBUS_WRITE_FAILURES,
+    COUNTER_MODBUS_READ_WRITE_FAILURES,
+    COUNTER_MODBUS_COMMAND_TARGET_CHANGES,
+    COUNTER_MODBUS_SERVER_ACCEPTED,
+    COUNTER_MODBUS_SERVER_EVICTED,
+    COUNTER_MODBUS_SERVER_REJECTED,
+    COUNTER_MODBUS_SERVER_IDLE_CLOSED,
+    COUNTER_MODBUS_SERVER_REQUESTS,
+    COUNTER_MODBUS_SERVER_EXCEPTIONS,
+    COUNTER_HEATPUMP_UPDATES,
+    COUNTER_HEATPUMP_UPDATE_FAILURES,
+    COUNTER_COMMANDS_APPLIED,
+    COUNTER_COMMANDS_SUPERSEDED,
+    COUNTER_COMMANDS_REJECTED,
+    COUNTER_COMMANDS_EXPIRED,
+    COUNTER_WIFI_DISCONNECTS,
+    COUNTER_OTA_STARTS,
+    COUNTER_OTA_FAILURES,
+    COUNTER_LEN
+};
+
+extern uint32_t metricCounters[COUNTER_LEN];
+
+inline void metricInc(Counter counter)
+{
+    metricCounters[counter]++;
+}
+
+// A remote Modbus server, see REMOTE_MODBUS_TARGETS
+struct ModbusTargetMetrics
+{
+    uint8_t ip[4];
+    uint8_t health;
+    bool commandSource;
+};
+
+// Heat pump gauges are labelled with the unit, one per snapshot, remote
+// Modbus server gauges with the target
+void sendMetrics(WebServer &server, const HeatpumpSnapshot *snapshots, uint8_t units,
+                 const ModbusTargetMetrics *targets, uint8_t targetCount);
+
+#endif // METRICS_H__
@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <atomic>
+#include <Arduino.h>
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include "constants.h"
+#include "debug_utils.h"
+#include "metrics.h"
+#include "modbus_server.h"
+
+// Transaction id, protocol id, length, unit id
+#define MBAP_LEN 7
+// Quantities per request, from the Modbus spec
+#define READ_COILS_MAX 2000
+#define READ_REGISTERS_MAX 125
+#define WRITE_COILS_MAX 1968
+#define WRITE_REGISTERS_MAX 123
+
+enum ModbusException : uint8_t
+{
+    EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+    EXCEPTION_ILLEGAL_ADDRESS = 0x02,
+    EXCEPTION_ILLEGAL_VALUE = 0x03,
+    EXCEPTION_GATEWAY_PATH_UNAVAILABLE = 0x0A
+};
+
+enum ReceiveResult : uint8_t
+{
+    RECEIVE_PENDING,
+    RECEIVE_COMPLETE,
+    RECEIVE_INVALID
+};
+
+struct Connection
+{
+    WiFiClient client;
+    bool active;
+    unsigned long lastRequestMillis;
+    // Bytes of the next request received so far
+    uint16_t rxLen;
+    uint8_t rx[MODBUS_ADU_MAX];
+};
+
+static WiFiServer server(MODBUS_SERVER_PORT);
+static Connection connections[MODBUS_SERVER_MAX_CLIENTS];
+// Read from other tasks for /metrics
+static std::atomic<uint8_t> clientCount(0);
+static const ModbusRegisterBlock *registerBlocks;
+static uint8_t registerBlockCount;
+// Routed unit ids, 0 to answer any
+static uint8_t routedUnits;
+// Where the next pass starts, the connection after the one looked at last
+static uint8_t nextConnection;
+// Each response is sent before the next request is handled
+static uint8_t tx[MODBUS_ADU_MAX];
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+static const ModbusRegisterBlock *findBlock(ModbusTable table, uint32_t address)
+{
+    for (uint8_t i = 0; i < registerBlockCount; i++)
+    {
+        const ModbusRegisterBlock &block = registerBlocks[i];
+        if (block.table == table && address >= block.offset && address - block.offset < block.count)
+        {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+// Every address in [address, address + count) is served, and writable if write
+static bool covered(ModbusTable table, uint16_t address, uint16_t count, bool write)
+{
+    uint32_t end = uint32_t(address) + count;
+    for (uint32_t next = address; next < end;)
+    {
+        const ModbusRegisterBlock *block = findBlock(table, next);
+        if (!block || (write && !block->write))
+        {
+            return false;
+        }
+        next = uint32_t(block->offset) + block->count;
+    }
+    return true;
+}
+
+static uint16_t readAt(ModbusTable table, uint8_t unit, uint16_t address)
+{
+    return findBlock(table, address)->read(unit, address);
+}
+
+static bool writeAt(ModbusTable table, uint8_t unit, uint16_t address, uint16_t value)
+{
+    return findBlock(table, address)->write(unit, address, value);
+}
+
+static uint16_t exception(uint8_t function, ModbusException code, uint8_t *out)
+{
+    metricInc(COUNTER_MODBUS_SERVER_EXCEPTIONS);
+    out[0] = function | 0x80;
+    out[1] = code;
+    return 2;
+}
+
+// The handlers below take a request PDU for unit and write the response
+// PDU to out, returning its length
+
+static uint16_t readCoils(uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    uint16_t count = get16(pdu + 3);
+    if (len != 5 || count == 0 || count > READ_COILS_MAX)
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(MODBUS_COILS, address, count, false))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    uint8_t bytes = (count + 7) / 8;
+    out[0] = pdu[0];
+    out[1] = bytes;
+    memset(out + 2, 0, bytes);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (readAt(MODBUS_COILS, unit, address + i))
+        {
+            out[2 + i / 8] |= 1 << (i % 8);
+        }
+    }
+    return 2 + bytes;
+}
+
+static uint16_t readRegisters(ModbusTable table, uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    uint16_t count = get16(pdu + 3);
+    if (len != 5 || count == 0 || count > READ_REGISTERS_MAX)
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(table, address, count, false))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    out[0] = pdu[0];
+    out[1] = count * 2;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        put16(out + 2 + i * 2, readAt(table, unit, address + i));
+    }
+    return 2 + count * 2;
+}
+
+static uint16_t writeCoil(uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    uint16_t value = get16(pdu + 3);
+    if (len != 5 || (value != 0xFF00 && value != 0x0000))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(MODBUS_COILS, address, 1, true))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    if (!writeAt(MODBUS_COILS, unit, address, value == 0xFF00))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    memcpy(out, pdu, 5);
+    return 5;
+}
+
+static uint16_t writeRegister(uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    if (len != 5)
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(MODBUS_HOLDING_REGISTERS, address, 1, true))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    if (!writeAt(MODBUS_HOLDING_REGISTERS, unit, address, get16(pdu + 3)))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    memcpy(out, pdu, 5);
+    return 5;
+}
+
+// Values rejected by the callback fail the request, the others are still
+// written
+static uint16_t writeCoils(uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    uint16_t count = get16(pdu + 3);
+    if (len < 6 || count == 0 || count > WRITE_COILS_MAX || pdu[5] != (count + 7) / 8 || len != 6 + pdu[5])
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(MODBUS_COILS, address, count, true))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    bool accepted = true;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        accepted &= writeAt(MODBUS_COILS, unit, address + i, (pdu[6 + i / 8] >> (i % 8)) & 1);
+    }
+    if (!accepted)
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    memcpy(out, pdu, 5);
+    return 5;
+}
+
+static uint16_t writeRegisters(uint8_t unit, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    uint16_t address = get16(pdu + 1);
+    uint16_t count = get16(pdu + 3);
+    if (len < 6 || count == 0 || count > WRITE_REGISTERS_MAX || pdu[5] != count * 2 || len != 6 + pdu[5])
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    if (!covered(MODBUS_HOLDING_REGISTERS, address, count, true))
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_ADDRESS, out);
+    }
+    bool accepted = true;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        accepted &= writeAt(MODBUS_HOLDING_REGISTERS, unit, address + i, get16(pdu + 6 + i * 2));
+    }
+    if (!accepted)
+    {
+        return exception(pdu[0], EXCEPTION_ILLEGAL_VALUE, out);
+    }
+    memcpy(out, pdu, 5);
+    return 5;
+}
+
+static uint16_t handle(uint8_t unitId, const uint8_t *pdu, uint16_t len, uint8_t *out)
+{
+    if (routedUnits > 0 && (unitId == 0 || unitId > routedUnits))
+    {
+        return exception(pdu[0], EXCEPTION_GATEWAY_PATH_UNAVAILABLE, out);
+    }
+    uint8_t unit = routedUnits > 0 ? unitId - 1 : 0;
+    switch (pdu[0])
+    {
+    case 0x01:
+        return readCoils(unit, pdu, len, out);
+    case 0x03:
+        return readRegisters(MODBUS_HOLDING_REGISTERS, unit, pdu, len, out);
+    case 0x04:
+        return readRegisters(MODBUS_INPUT_REGISTERS, unit, pdu, len, out);
+    case 0x05:
+        return writeCoil(unit, pdu, len, out);
+    case 0x06:
+        return writeRegister(unit, pdu, len, out);
+    case 0x0F:
+        return writeCoils(unit, pdu, len, out);
+    case 0x10:
+        return writeRegisters(unit, pdu, len, out);
+    default:
+        return exception(pdu[0], EXCEPTION_ILLEGAL_FUNCTION, out);
+    }
+}
+
+// Reads what has arrived of the next request, and nothing past it
+static ReceiveResult receive(Connection &connection)
+{
+    while (true)
+    {
+        uint16_t want = MBAP_LEN;
+        if (connection.rxLen >= MBAP_LEN)
+        {
+            uint16_t length = get16(connection.rx + 4);
+            if (get16(connection.rx + 2) != 0 || length < 2 || length > MODBUS_ADU_MAX - 6)
+            {
+                return RECEIVE_INVALID;
+            }
+            want = 6 + length;
+            if (connection.rxLen == want)
+            {
+                return RECEIVE_COMPLETE;
+            }
+        }
+        int available = connection.client.available();
+        if (available <= 0)
+        {
+            return RECEIVE_PENDING;
+        }
+        int got = connection.client.read(connection.rx + connection.rxLen, std::min(want - connection.rxLen, available));
+        if (got <= 0)
+        {
+            return RECEIVE_PENDING;
+        }
+        connection.rxLen += got;
+    }
+}
+
+static void respond(Connection &connection)
+{
+    uint16_t len = handle(connection.rx[6], connection.rx + MBAP_LEN, connection.rxLen - MBAP_LEN, tx + MBAP_LEN);
+    // Transaction and protocol id as received, length counts the unit id
+    memcpy(tx, connection.rx, 4);
+    put16(tx + 4, len + 1);
+    tx[6] = connection.rx[6];
+    connection.client.write(tx, MBAP_LEN + len);
+    connection.rxLen = 0;
+    connection.lastRequestMillis = millis();
+    metricInc(COUNTER_MODBUS_SERVER_REQUESTS);
+}
+
+static void closeConnection(Connection &connection)
+{
+    connection.client.stop();
+    connection.active = false;
+    clientCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void acceptConnections()
+{
+    while (true)
+    {
+        WiFiClient client = server.accept();
+        if (!client)
+        {
+            return;
+        }
+        Connection *slot = nullptr;
+        Connection *idlest = nullptr;
+        for (Connection &connection : connections)
+        {
+            if (!connection.active)
+            {
+                slot = &connection;
+                break;
+            }
+            if (!idlest || long(connection.lastRequestMillis - idlest->lastRequestMillis) < 0)
+            {
+                idlest = &connection;
+            }
+        }
+        if (!slot)
+        {
+            if (millis() - idlest->lastRequestMillis < MODBUS_SERVER_EVICT_IDLE_MILLIS)
+            {
+                metricInc(COUNTER_MODBUS_SERVER_REJECTED);
+                LOG_THROTTLED(LOG_WARNING, 10000, 1, "Modbus server full, %u clients, turned a connection away", MODBUS_SERVER_MAX_CLIENTS);
+                client.stop();
+                continue;
+            }
+            metricInc(COUNTER_MODBUS_SERVER_EVICTED);
+            LOG_PRINTF(LOG_INFO, "Modbus server full, closing a connection idle for %lu ms", millis() - idlest->lastRequestMillis);
+            closeConnection(*idlest);
+            slot = idlest;
+        }
+        client.setNoDelay(true);
+        IPAddress ip = client.remoteIP();
+        slot->client = client;
+        slot->active = true;
+        slot->lastRequestMillis = millis();
+        slot->rxLen = 0;
+        uint8_t clients = clientCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        metricInc(COUNTER_MODBUS_SERVER_ACCEPTED);
+        LOG_PRINTF(LOG_INFO, "Modbus client %u.%u.%u.%u connected, %u of %u", ip[0], ip[1], ip[2], ip[3], clients, MODBUS_SERVER_MAX_CLIENTS);
+    }
+}
+
+// Frees the slots of connections closed by the peer or idle too long
+static void reapConnections()
+{
+    for (Connection &connection : connections)
+    {
+        if (!connection.active)
+        {
+            continue;
+        }
+        if (!connection.client.connected())
+        {
+            closeConnection(connection);
+        }
+        else if (millis() - connection.lastRequestMillis >= MODBUS_SERVER_IDLE_MILLIS)
+        {
+            metricInc(COUNTER_MODBUS_SERVER_IDLE_CLOSED);
+            LOG_PRINTLN(LOG_INFO, "Closing idle Modbus client connection");
+            closeConnection(connection);
+        }
+    }
+}
+
+void modbusServerBegin(const ModbusRegisterBlock *blocks, uint8_t count, uint8_t units)
+{
+    registerBlocks = blocks;
+    registerBlockCount = count;
+    routedUnits = units > 1 ? units : 0;
+    server.begin();
+    server.setNoDelay(true);
+}
+
+void modbusServerLoop()
+{
+    if (!registerBlocks)
+    {
+        return;
+    }
+    acceptConnections();
+    reapConnections();
+    // Passes over the connections, one request from each, until none has
+    // one waiting or the slice is used up
+    unsigned long start = micros();
+    bool served = true;
+    while (served && micros() - start < MODBUS_SERVER_SLICE_MICROS)
+    {
+        served = false;
+        for (uint8_t n = 0; n < MODBUS_SERVER_MAX_CLIENTS && micros() - start < MODBUS_SERVER_SLICE_MICROS; n++)
+        {
+            Connection &connection = connections[nextConnection];
+            nextConnection = (nextConnection + 1) % MODBUS_SERVER_MAX_CLIENTS;
+            if (!connection.active)
+            {
+                continue;
+            }
+            switch (receive(connection))
+            {
+            case RECEIVE_COMPLETE:
+                respond(connection);
+                served = true;
+                break;
+            case RECEIVE_INVALID:
+                LOG_THROTTLED(LOG_WARNING, 10000, 1, "Closing Modbus client connection, not Modbus TCP");
+                closeConnection(connection);
+                break;
+            case RECEIVE_PENDING:
+                break;
+            }
+        }
+    }
+}
+
+uint8_t modbusServerClients()
+{
+    return clientCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,61 @@
+#ifndef MODBUS_SERVER_H__
+#define MODBUS_SERVER_H__
+
+#include <stdint.h>
+
+///
+/// Modbus TCP server for several masters polling at once, in place of the
+/// one in modbus-esp8266, which answers whichever client it finds first
+/// and keeps connections until the peer closes them.
+///
+/// - At most MODBUS_SERVER_MAX_CLIENTS connections. When all are taken, a
+///   new connection replaces the one idle the longest if that has had no
+///   request for MODBUS_SERVER_EVICT_IDLE_MILLIS, and is closed otherwise.
+/// - modbusServerLoop() answers one request per connection in turn,
+///   starting after the connection it answered last, until none has a
+///   complete request waiting or MODBUS_SERVER_SLICE_MICROS have passed.
+///   A master sending back to back cannot starve the others, and the
+///   modbus stage of loop() stays bounded however many are polling.
+/// - Connections without a request for MODBUS_SERVER_IDLE_MILLIS are
+///   closed, so that masters that went away without closing do not hold
+///   slots.
+///
+/// Function codes 01, 03, 04, 05, 06, 15 and 16 are served from a table
+/// of ModbusRegisterBlocks.
+///
+/// With several heat pumps the server is a gateway: unit ids 1 to units
+/// each address one heat pump, whose index the callbacks get, and other
+/// unit ids are answered with exception 0x0A (gateway path unavailable).
+/// Otherwise any unit id is answered, as unit 0.
+///
+#define MODBUS_SERVER_PORT 502
+// MBAP header and the longest PDU
+#define MODBUS_ADU_MAX 260
+
+enum ModbusTable : uint8_t
+{
+    MODBUS_COILS,
+    MODBUS_HOLDING_REGISTERS,
+    MODBUS_INPUT_REGISTERS
+};
+
+// Address range of one table and its callbacks, which get the unit the
+// request is for. Coils are read and written as 0 and 1.
+struct ModbusRegisterBlock
+{
+    ModbusTable table;
+    uint16_t offset;
+    uint16_t count;
+    uint16_t (*read)(uint8_t unit, uint16_t address);
+    // False rejects the value (illegal data value). Null for read-only.
+    bool (*write)(uint8_t unit, uint16_t address, uint16_t value);
+};
+
+// Starts listening. blocks must outlive the server. units above 1 routes
+// unit ids, see above.
+void modbusServerBegin(const ModbusRegisterBlock *blocks, uint8_t count, uint8_t units);
+// Accepts, serves and reaps connections, within MODBUS_SERVER_SLICE_MICROS
+void modbusServerLoop();
+uint8_t modbusServerClients();
+
+#endif // MODBUS_SERVER_H__
@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include "constants.h"
+#include "profiler.h"
+
+static const char *const SLOT_NAMES[PROFILER_SLOTS] = {"wifi", "modbus", "ota", "http", "heatpump", "log", "loop"};
+
+static ProfilerStats stats[PROFILER_SLOTS];
+static LoopStage currentStage;
+static bool inLoop;
+static uint32_t stageStart;
+static uint32_t loopStart;
+
+static void record(uint8_t slot, uint32_t micros)
+{
+    ProfilerStats &s = stats[slot];
+    if (s.count == 0 || micros < s.min)
+    {
+        s.min = micros;
+    }
+    if (micros > s.max)
+    {
+        s.max = micros;
+    }
+    s.count++;
+    s.sum += micros;
+    uint8_t bucket = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+    s.histogram[bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1]++;
+}
+
+void profilerStage(LoopStage stage)
+{
+    if (!LOOP_PROFILER_ENABLED)
+    {
+        return;
+    }
+    uint32_t now = micros();
+    if (inLoop)
+    {
+        record(currentStage, now - stageStart);
+    }
+    else
+    {
+        loopStart = now;
+        inLoop = true;
+    }
+    currentStage = stage;
+    stageStart = now;
+}
+
+void profilerLoopEnd()
+{
+    if (!LOOP_PROFILER_ENABLED || !inLoop)
+    {
+        return;
+    }
+    uint32_t now = micros();
+    record(currentStage, now - stageStart);
+    record(PROFILER_SLOT_LOOP, now - loopStart);
+    inLoop = false;
+}
+
+void profilerRecord(LoopStage stage, uint32_t micros)
+{
+    if (LOOP_PROFILER_ENABLED)
+    {
+        record(stage, micros);
+    }
+}
+
+void profilerReset()
+{
+    memset(stats, 0, sizeof(stats));
+}
+
+const ProfilerStats &profilerStats(uint8_t slot)
+{
+    return stats[slot];
+}
+
+const char *profilerSlotName(uint8_t slot)
+{
+    return slot < PROFILER_SLOTS ? SLOT_NAMES[slot] : "";
+}
+
+uint32_t profilerBucketLimit(uint8_t bucket)
+{
+    return bucket + 1 < PROFILER_BUCKETS ? uint32_t(1) << bucket : 0;
+}
+
+uint16_t profilerRegister(uint16_t offset)
+{
+    if (offset >= PROFILER_REGS_LEN)
+    {
+        return 0;
+    }
+    const ProfilerStats &s = stats[offset / PROFILER_REGS_PER_SLOT];
+    uint8_t field = offset % PROFILER_REGS_PER_SLOT;
+    if (field >= 8)
+    {
+        uint32_t count = s.histogram[field - 8];
+        return count > 0xFFFF ? 0xFFFF : count;
+    }
+    uint32_t value;
+    switch (field / 2)
+    {
+    case 0:
+        value = s.count;
+        break;
+    case 1:
+        value = s.min;
+        break;
+    case 2:
+        value = s.count == 0 ? 0 : uint32_t(s.sum / s.count);
+        break;
+    default:
+        value = s.max;
+        break;
+    }
+    return field % 2 == 0 ? value >> 16 : value & 0xFFFF;
+}
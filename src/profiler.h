@@ -0,0 +1,51 @@
+#ifndef PROFILER_H__
+#define PROFILER_H__
+
+#include <stdint.h>
+#include "loop_stages.h"
+
+///
+/// Time spent in each loop() stage, and in the whole loop, measured with
+/// micros() between LOOP_STAGE() marks. Each slot keeps count, min, max,
+/// sum and a histogram with power of two buckets, all in fixed memory.
+///
+/// Bucket 0 counts durations under 1 us, bucket i durations of
+/// [2^(i-1), 2^i) us. The last bucket also takes everything longer.
+///
+/// With ESP32_TASKS there is no loop(): the tasks time their stages with
+/// profilerRecord() instead, and the loop slot stays empty.
+///
+#define PROFILER_BUCKETS 21
+// Stages, then the whole loop
+#define PROFILER_SLOT_LOOP LOOP_STAGE_COUNT
+#define PROFILER_SLOTS (LOOP_STAGE_COUNT + 1)
+
+///
+/// Modbus input register view, PROFILER_REGS_PER_SLOT registers per slot
+/// in slot order. 32-bit values are high word first:
+///   0-1 count, 2-3 min us, 4-5 mean us, 6-7 max us,
+///   8.. histogram bucket counts, saturated at 65535
+///
+#define PROFILER_REGS_PER_SLOT (8 + PROFILER_BUCKETS)
+#define PROFILER_REGS_LEN (PROFILER_SLOTS * PROFILER_REGS_PER_SLOT)
+
+struct ProfilerStats
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t histogram[PROFILER_BUCKETS];
+};
+
+// Records one run of stage measured by the caller. Each stage must be
+// recorded from one task only.
+void profilerRecord(LoopStage stage, uint32_t micros);
+void profilerReset();
+const ProfilerStats &profilerStats(uint8_t slot);
+const char *profilerSlotName(uint8_t slot);
+// Exclusive upper bound of a histogram bucket in us, 0 for the open last one
+uint32_t profilerBucketLimit(uint8_t bucket);
+uint16_t profilerRegister(uint16_t offset);
+
+#endif // PROFILER_H__
@@ -0,0 +1,117 @@
+#ifndef PROTOTHREAD_H__
+#define PROTOTHREAD_H__
+
+#include <Arduino.h>
+#include <stdint.h>
+
+///
+/// Stackless protothreads, for flows that have to wait for something
+/// without holding up loop() or their task. A protothread is a function
+/// taking its Protothread; where it would block it returns PT_WAITING, and
+/// the next call carries on from there. Call it again from a timer or a
+/// loop until it returns PT_ENDED, after which it starts over.
+///
+///     PtState blink(Protothread &pt)
+///     {
+///         PT_BEGIN(pt);
+///         digitalWrite(LED, HIGH);
+///         PT_SLEEP(pt, 100);
+///         digitalWrite(LED, LOW);
+///         PT_END(pt);
+///     }
+///
+/// The macros expand to one switch statement over the line number, which
+/// brings the usual restrictions: locals do not survive a wait (keep state
+/// in statics or in the Protothread), a wait must not sit inside a switch
+/// of its own, and there is at most one wait per source line.
+///
+/// C++20 coroutines would lift these, but the ESP8266 and ESP32 Arduino
+/// toolchains do not support them.
+///
+
+struct Protothread
+{
+    // Where to resume, 0 for the start
+    uint16_t line;
+    // For PT_SLEEP() and timeouts of the flow's own
+    unsigned long millis;
+};
+
+enum PtState : uint8_t
+{
+    PT_WAITING,
+    PT_ENDED
+};
+
+// The waits set the line and fall into its case label on purpose
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(fallthrough)
+#define PT_FALLTHROUGH [[fallthrough]]
+#endif
+#endif
+#ifndef PT_FALLTHROUGH
+#define PT_FALLTHROUGH
+#endif
+
+#define PT_BEGIN(pt) \
+    switch ((pt).line) \
+    { \
+    case 0:
+
+#define PT_END(pt) \
+    } \
+    (pt).line = 0; \
+    return PT_ENDED
+
+// Returns until condition holds, which is checked on every call
+#define PT_WAIT_UNTIL(pt, condition) \
+    do \
+    { \
+        (pt).line = __LINE__; \
+        PT_FALLTHROUGH; \
+    case __LINE__: \
+        if (!(condition)) \
+            return PT_WAITING; \
+    } while (0)
+
+// Returns once, carries on with the next call
+#define PT_YIELD(pt) \
+    do \
+    { \
+        (pt).line = __LINE__; \
+        return PT_WAITING; \
+    case __LINE__:; \
+    } while (0)
+
+#define PT_SLEEP(pt, sleepMillis) \
+    do \
+    { \
+        (pt).millis = ::millis(); \
+        (pt).line = __LINE__; \
+        PT_FALLTHROUGH; \
+    case __LINE__: \
+        if (::millis() - (pt).millis < (unsigned long)(sleepMillis)) \
+            return PT_WAITING; \
+    } while (0)
+
+// Runs the child protothread, a call such as flow(child), to its end
+#define PT_SPAWN(pt, child, call) \
+    do \
+    { \
+        (child).line = 0; \
+        (pt).line = __LINE__; \
+        PT_FALLTHROUGH; \
+    case __LINE__: \
+        if ((call) != PT_ENDED) \
+            return PT_WAITING; \
+    } while (0)
+
+// Ends the protothread early
+#define PT_EXIT(pt) \
+    do \
+    { \
+        (pt).line = 0; \
+        return PT_ENDED; \
+    } while (0)
+
+#endif // PROTOTHREAD_H__
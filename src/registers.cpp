@@ -0,0 +1,18 @@
+#include <Arduino.h>
+#include "registers.h"
+#include "utils.h"
+
+uint16_t RegisterEnum::fromStr(const char *value) const
+{
+    if (value == NULL)
+    {
+        return -1;
+    }
+    int8_t index = slots[enumHash(value, strlen(value))];
+    // Single compare to reject strings that merely share a slot
+    if (index < 0 || !streq(value, values[index]))
+    {
+        return -1;
+    }
+    return index;
+}
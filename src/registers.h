@@ -0,0 +1,197 @@
+#ifndef REGISTERS_H__
+#define REGISTERS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <HeatPump.h>
+
+///
+/// Compile-time description of the Modbus holding register block.
+///
+/// Each register is one HoldingRegister entry in a constexpr table indexed
+/// by address, so reads and writes dispatch with a table lookup and the
+/// layout cannot drift between the getters, the setters and the enum maps.
+///
+
+#define ENUM_HASH_SLOTS 16
+
+constexpr uint8_t foldEnumHash(size_t x)
+{
+    return (x ^ (x >> 4)) % ENUM_HASH_SLOTS;
+}
+
+// Hash of length, first and last character. Every value of every enum map
+// gets its own slot; IMPL_ENUM_HELPERS checks this at compile time.
+constexpr uint8_t enumHash(const char *s, size_t len)
+{
+    return len == 0 ? 0 : foldEnumHash(len * 6 + uint8_t(s[0]) + uint8_t(s[len - 1]));
+}
+
+constexpr size_t constStrlen(const char *s)
+{
+    return *s ? 1 + constStrlen(s + 1) : 0;
+}
+
+///
+/// String values of an enum register, ordered by register value.
+/// slots maps enumHash() of a string to its index, -1 for no value.
+///
+struct RegisterEnum
+{
+    const char *const *values;
+    uint8_t size;
+    const int8_t *slots;
+
+    // -1 (0xFFFF) for NULL or unknown strings
+    uint16_t fromStr(const char *value) const;
+    // NULL for out of range indices
+    const char *fromIndex(uint16_t index) const
+    {
+        return index < size ? values[index] : NULL;
+    }
+};
+
+// READ registers (commands from the PLC)
+// 0: hvac power on
+// 12..16: temperature, mode, fan, vane and wide vane, with
+//         REMOTE_MODBUS_SETPOINTS
+// WRITE registers: 1..11
+// See HOLDING_REGISTERS in main.cpp for the definitions
+enum HoldingRegisterAddress
+{
+    HOLDING_REG_POWER_COMMAND,
+    HOLDING_REG_TIMEOUT_COUNTER,
+    HOLDING_REG_TEMPERATURE_INDEX,
+    HOLDING_REG_POWER_INDEX,
+    HOLDING_REG_MODE_INDEX,
+    HOLDING_REG_FAN_INDEX,
+    HOLDING_REG_VANE_INDEX,
+    HOLDING_REG_WIDEVANE_INDEX,
+    HOLDING_REG_CONNECTED_INDEX,
+    HOLDING_REG_ROOM_TEMPERATURE_INDEX,
+    HOLDING_REG_OPERATING_INDEX,
+    HOLDING_REG_MILLIS_SINCE_LAST_COMMS_INDEX,
+    HOLDING_REG_TEMPERATURE_COMMAND,
+    HOLDING_REG_MODE_COMMAND,
+    HOLDING_REG_FAN_COMMAND,
+    HOLDING_REG_VANE_COMMAND,
+    HOLDING_REG_WIDEVANE_COMMAND,
+    HOLDING_LEN
+};
+
+enum RegisterAccess
+{
+    // Read by the ESP from the remote server, sets the register in setting
+    REG_COMMAND,
+    // Written by the ESP, writable by Modbus server clients
+    REG_READ_WRITE,
+    // Written by the ESP, read-only for Modbus server clients
+    REG_READ_ONLY
+};
+
+///
+/// One holding register. Enum registers set values and getEnum/setEnum,
+/// scaled ones scale and getScaled/setScaled, the rest get/set.
+///
+struct HoldingRegister
+{
+    uint8_t address;
+    const char *name;
+    RegisterAccess access;
+    // Sent only with full refreshes of delta writes (see REMOTE_MODBUS_DELTA_WRITES)
+    bool heartbeatOnly;
+    // Not part of the heat pump state: computed on every read instead of
+    // being kept in the snapshot
+    bool live;
+    const RegisterEnum *values;
+    const char *(HeatPump::*getEnum)();
+    void (HeatPump::*setEnum)(const char *);
+    uint16_t scale;
+    float (HeatPump::*getScaled)();
+    void (HeatPump::*setScaled)(float);
+    uint16_t (*get)(uint8_t unit);
+    // Register a REG_COMMAND register sets
+    uint8_t setting;
+};
+
+// Whether a command may set the register at address to value: one of its
+// enum values, or a temperature in range. See main.cpp.
+bool settingValueValid(uint8_t address, uint16_t value);
+
+constexpr bool registersInAddressOrder(const HoldingRegister *registers, size_t size, size_t i = 0)
+{
+    return i == size || (registers[i].address == i && registersInAddressOrder(registers, size, i + 1));
+}
+
+//
+// Compile-time enum slot tables
+//
+template <size_t... I>
+struct IndexSeq
+{
+};
+template <size_t N, size_t... I>
+struct MakeIndexSeq : MakeIndexSeq<N - 1, N - 1, I...>
+{
+};
+template <size_t... I>
+struct MakeIndexSeq<0, I...>
+{
+    typedef IndexSeq<I...> type;
+};
+
+constexpr int8_t findEnumSlot(const char *const *values, size_t size, size_t slot, size_t i = 0)
+{
+    return i == size ? -1 : enumHash(values[i], constStrlen(values[i])) == slot ? int8_t(i) : findEnumSlot(values, size, slot, i + 1);
+}
+
+constexpr size_t countEnumSlot(const char *const *values, size_t size, size_t slot, size_t i = 0)
+{
+    return i == size ? 0 : (enumHash(values[i], constStrlen(values[i])) == slot ? 1 : 0) + countEnumSlot(values, size, slot, i + 1);
+}
+
+constexpr bool enumHashesUnique(const char *const *values, size_t size, size_t i = 0)
+{
+    return i == size || (countEnumSlot(values, size, enumHash(values[i], constStrlen(values[i]))) == 1 && enumHashesUnique(values, size, i + 1));
+}
+
+template <size_t... I>
+struct EnumSlots
+{
+    const int8_t slots[sizeof...(I)];
+};
+
+template <size_t... I>
+constexpr EnumSlots<I...> makeEnumSlots(const char *const *values, size_t size, IndexSeq<I...>)
+{
+    return EnumSlots<I...>{{findEnumSlot(values, size, I)...}};
+}
+
+#define IMPL_ENUM_HELPERS(NAME, ...)                                                                          \
+    static constexpr const char *NAME##_MAP[] = {__VA_ARGS__};                                                \
+    static constexpr size_t NAME##_SIZE = sizeof(NAME##_MAP) / sizeof(NAME##_MAP[0]);                         \
+    static_assert(enumHashesUnique(NAME##_MAP, NAME##_SIZE), #NAME " values collide in enumHash");            \
+    static constexpr auto NAME##_SLOTS = makeEnumSlots(NAME##_MAP, NAME##_SIZE, MakeIndexSeq<ENUM_HASH_SLOTS>::type()); \
+    static constexpr RegisterEnum NAME##_ENUM = {NAME##_MAP, NAME##_SIZE, NAME##_SLOTS.slots};
+
+//
+// do not change ordering of below values, they are the register values
+//
+IMPL_ENUM_HELPERS(POWER, "OFF", "ON")
+IMPL_ENUM_HELPERS(MODE, "HEAT", "DRY", "COOL", "FAN", "AUTO")
+IMPL_ENUM_HELPERS(FAN, "AUTO", "QUIET", "1", "2", "3", "4")
+IMPL_ENUM_HELPERS(VANE, "AUTO", "1", "2", "3", "4", "5", "SWING")
+IMPL_ENUM_HELPERS(WIDEVANE, "<<", "<", "|", ">", ">>", "<>", "SWING")
+
+inline uint16_t fromStrPower(const char *value) { return POWER_ENUM.fromStr(value); }
+inline uint16_t fromStrMode(const char *value) { return MODE_ENUM.fromStr(value); }
+inline uint16_t fromStrFan(const char *value) { return FAN_ENUM.fromStr(value); }
+inline uint16_t fromStrVane(const char *value) { return VANE_ENUM.fromStr(value); }
+inline uint16_t fromStrWideVane(const char *value) { return WIDEVANE_ENUM.fromStr(value); }
+inline const char *fromIndexPower(uint16_t index) { return POWER_ENUM.fromIndex(index); }
+inline const char *fromIndexMode(uint16_t index) { return MODE_ENUM.fromIndex(index); }
+inline const char *fromIndexFan(uint16_t index) { return FAN_ENUM.fromIndex(index); }
+inline const char *fromIndexVane(uint16_t index) { return VANE_ENUM.fromIndex(index); }
+inline const char *fromIndexWideVane(uint16_t index) { return WIDEVANE_ENUM.fromIndex(index); }
+
+#endif // REGISTERS_H__
@@ -0,0 +1,211 @@
+#include <stddef.h>
+#include <string.h>
+#include <Arduino.h>
+#ifdef ESP32
+#include <esp_system.h>
+#endif
+#include "constants.h"
+#include "debug_utils.h"
+#include "metrics.h"
+#include "rtc_state.h"
+
+// Layout version in the low byte
+#define RTC_STATE_MAGIC 0x52544301
+#ifdef ESP8266
+// In 4 byte blocks. OTA updates use the first 32 of the 128.
+#define RTC_STATE_OFFSET_BLOCKS 32
+#define RTC_USER_MEMORY_BYTES 512
+#endif
+
+struct RtcImage
+{
+    uint32_t magic;
+    // CRC-32 of everything after it
+    uint32_t crc;
+    // sizeof(RtcImage), so that a firmware with other HEATPUMP_UNITS or
+    // counters does not take it
+    uint32_t size;
+    uint32_t boots;
+    // Of the run that wrote it, as of the last write
+    uint32_t uptimeSeconds;
+    uint32_t restarts[RESTART_REASON_LEN];
+    uint32_t counters[COUNTER_LEN];
+    RtcUnitState units[HEATPUMP_UNITS];
+    // Why the run that wrote it ended, unexpected until restart()
+    RestartReason reason;
+};
+static_assert(sizeof(RtcImage) % 4 == 0, "RTC memory is written in 4 byte blocks");
+#ifdef ESP8266
+static_assert(sizeof(RtcImage) <= RTC_USER_MEMORY_BYTES - RTC_STATE_OFFSET_BLOCKS * 4, "RtcImage does not fit RTC user memory");
+#elif defined(ESP32)
+// Left alone by software resets, the watchdog and panics
+RTC_NOINIT_ATTR static RtcImage rtcMemory;
+#endif
+
+static const char *const REASON_NAMES[RESTART_REASON_LEN] = {"unexpected", "modbus", "wifi_down", "low_memory", "ota"};
+
+// What was last written, and what later writes start from
+static RtcImage image;
+static bool restored;
+static RestartReason lastReason;
+static uint32_t lastUptimeSeconds;
+#if TASKS_ENABLED
+static portMUX_TYPE writeMux = portMUX_INITIALIZER_UNLOCKED;
+#define WRITE_LOCK() portENTER_CRITICAL(&writeMux)
+#define WRITE_UNLOCK() portEXIT_CRITICAL(&writeMux)
+#else
+#define WRITE_LOCK()
+#define WRITE_UNLOCK()
+#endif
+
+// Four bits at a time, with a 64 byte table
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    static const uint32_t TABLE[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = TABLE[(crc ^ data[i]) & 0x0f] ^ (crc >> 4);
+        crc = TABLE[(crc ^ (data[i] >> 4)) & 0x0f] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static uint32_t imageCrc(const RtcImage &image)
+{
+    size_t begin = offsetof(RtcImage, size);
+    return crc32(reinterpret_cast<const uint8_t *>(&image) + begin, sizeof(image) - begin);
+}
+
+static void readMemory(RtcImage &image)
+{
+#ifdef ESP8266
+    ESP.rtcUserMemoryRead(RTC_STATE_OFFSET_BLOCKS, reinterpret_cast<uint32_t *>(&image), sizeof(image));
+#elif defined(ESP32)
+    memcpy(&image, &rtcMemory, sizeof(image));
+#endif
+}
+
+// Stamps the counters and uptime, and writes image. Under WRITE_LOCK().
+static void writeMemory()
+{
+    memcpy(image.counters, metricCounters, sizeof(image.counters));
+    image.uptimeSeconds = millis() / 1000;
+    image.crc = imageCrc(image);
+#ifdef ESP8266
+    ESP.rtcUserMemoryWrite(RTC_STATE_OFFSET_BLOCKS, reinterpret_cast<uint32_t *>(&image), sizeof(image));
+#elif defined(ESP32)
+    memcpy(&rtcMemory, &image, sizeof(image));
+#endif
+}
+
+// What the chip says about the reset, for the log
+static const char *platformResetReason()
+{
+#ifdef ESP8266
+    static String reason;
+    reason = ESP.getResetReason();
+    return reason.c_str();
+#elif defined(ESP32)
+    switch (esp_reset_reason())
+    {
+    case ESP_RST_POWERON:
+        return "power on";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    default:
+        return "other";
+    }
+#endif
+}
+
+bool rtcStateBegin()
+{
+    readMemory(image);
+    restored = image.magic == RTC_STATE_MAGIC && image.size == sizeof(image) && image.crc == imageCrc(image) &&
+               image.reason < RESTART_REASON_LEN;
+    if (restored)
+    {
+        lastReason = image.reason;
+        lastUptimeSeconds = image.uptimeSeconds;
+        image.restarts[lastReason]++;
+        memcpy(metricCounters, image.counters, sizeof(image.counters));
+        LOG_PRINTF(LOG_NOTICE, "Boot %lu, last run ended by %s restart after %lu s (reset reason: %s)",
+                   (unsigned long)image.boots + 1, restartReasonName(lastReason), (unsigned long)lastUptimeSeconds,
+                   platformResetReason());
+    }
+    else
+    {
+        memset(&image, 0, sizeof(image));
+        image.magic = RTC_STATE_MAGIC;
+        image.size = sizeof(image);
+        LOG_PRINTF(LOG_NOTICE, "Cold boot, nothing to restore (reset reason: %s)", platformResetReason());
+    }
+    image.boots++;
+    image.reason = RESTART_UNEXPECTED;
+    WRITE_LOCK();
+    writeMemory();
+    WRITE_UNLOCK();
+    return restored;
+}
+
+const RtcUnitState &rtcUnitState(uint8_t unit)
+{
+    return image.units[unit];
+}
+
+void rtcStateSave(const RtcUnitState *units)
+{
+    WRITE_LOCK();
+    memcpy(image.units, units, sizeof(image.units));
+    writeMemory();
+    WRITE_UNLOCK();
+}
+
+void rtcStateRestart(RestartReason reason)
+{
+    WRITE_LOCK();
+    image.reason = reason;
+    writeMemory();
+    WRITE_UNLOCK();
+}
+
+bool rtcStateRestored()
+{
+    return restored;
+}
+
+uint32_t rtcBoots()
+{
+    return image.boots;
+}
+
+RestartReason rtcLastRestartReason()
+{
+    return lastReason;
+}
+
+uint32_t rtcLastRestartUptimeSeconds()
+{
+    return lastUptimeSeconds;
+}
+
+uint32_t rtcRestarts(RestartReason reason)
+{
+    return reason < RESTART_REASON_LEN ? image.restarts[reason] : 0;
+}
+
+const char *restartReasonName(RestartReason reason)
+{
+    return reason < RESTART_REASON_LEN ? REASON_NAMES[reason] : "";
+}
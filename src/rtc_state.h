@@ -0,0 +1,80 @@
+#ifndef RTC_STATE_H__
+#define RTC_STATE_H__
+
+#include <stdint.h>
+#include "constants.h"
+#include "registers.h"
+
+///
+/// State kept in RTC memory, which survives restarts, watchdog resets and
+/// crashes but not power loss. After a restart the ESP picks up where it
+/// left off instead of waiting for WiFi, the PLC and the heat pump:
+///
+/// - the metric counters carry on,
+/// - each unit's registers are served from the last snapshot until the
+///   unit answers,
+/// - the last commands read from the PLC go out with the first heat pump
+///   exchange, and the first read after boot only passes on what changed.
+///
+/// The reason of each restart (see RestartReason) and the uptime it came
+/// at are recorded too. A run that ends without restart() was cut short
+/// by a crash, the watchdog or the reset pin, and counts as unexpected.
+///
+/// The contents carry a CRC-32 and their size; anything that does not
+/// check out, such as RTC memory after power on or from a firmware with a
+/// different layout, is a cold boot and starts from zero.
+///
+/// rtcStateSave() writes everything every RTC_STATE_SAVE_INTERVAL_MILLIS
+/// and when the PLC commands change, so a crash loses at most that much
+/// uptime and counting. With ESP32_TASKS the writes take a short spinlock.
+///
+#define RTC_STATE_SAVE_INTERVAL_MILLIS 1000
+
+enum RestartReason : uint8_t
+{
+    // Crash, watchdog, reset pin or anything else that skipped restart()
+    RESTART_UNEXPECTED,
+    // Reset or reboot coil
+    RESTART_MODBUS,
+    // WiFi down for WIFI_RETRY_MILLIS
+    RESTART_WIFI_DOWN,
+    RESTART_LOW_MEMORY,
+    RESTART_OTA,
+    RESTART_REASON_LEN
+};
+
+struct RtcUnitState
+{
+    // Snapshot registers, if snapshotValid
+    uint16_t holding[HOLDING_LEN];
+    // Last value read from the PLC of each REG_COMMAND register, by address
+    uint16_t commands[HOLDING_LEN];
+    // Bit per address, set once the command was passed on
+    uint32_t commandsSubmitted;
+    // The unit has answered at least once
+    bool snapshotValid;
+};
+static_assert(HOLDING_LEN <= 32, "RtcUnitState::commandsSubmitted has a bit per holding register");
+
+// Reads RTC memory at boot. Restores the metric counters and returns true
+// if it checks out, otherwise returns false and starts from zero.
+bool rtcStateBegin();
+// As saved by the last run, zero after a cold boot
+const RtcUnitState &rtcUnitState(uint8_t unit);
+// Writes units (HEATPUMP_UNITS of them), the counters and the uptime
+void rtcStateSave(const RtcUnitState *units);
+// Records that the ESP is about to restart for reason. From any task.
+void rtcStateRestart(RestartReason reason);
+
+bool rtcStateRestored();
+// Boots since the last cold boot, this one included
+uint32_t rtcBoots();
+// Why the last run ended, and its uptime then. Unexpected and 0 after a
+// cold boot.
+RestartReason rtcLastRestartReason();
+uint32_t rtcLastRestartUptimeSeconds();
+// Restarts for reason since the last cold boot
+uint32_t rtcRestarts(RestartReason reason);
+const char *restartReasonName(RestartReason reason);
+
+#endif // RTC_STATE_H__
@@ -0,0 +1,25 @@
+#ifndef SNAPSHOT_H__
+#define SNAPSHOT_H__
+
+#include <stdint.h>
+#include <HeatPump.h>
+#include "registers.h"
+
+///
+/// Heat pump state as of the last successful update(), with the holding
+/// registers already computed. Modbus server reads, client writes and the
+/// web UI are all served from here instead of querying HeatPump.
+///
+struct HeatpumpSnapshot
+{
+    // Incremented whenever the contents change
+    uint32_t sequence;
+    // millis() of the heat pump comms the snapshot reflects, 0 for none
+    unsigned long commsMillis;
+    heatpumpSettings settings;
+    float roomTemperature;
+    // Registers marked live in HOLDING_REGISTERS are not kept up to date here
+    uint16_t holding[HOLDING_LEN];
+};
+
+#endif // SNAPSHOT_H__
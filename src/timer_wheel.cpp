@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <Arduino.h>
+#include "timer_wheel.h"
+#include "debug_utils.h"
+
+static_assert(TIMER_WHEEL_CAPACITY < TIMER_NONE, "TimerId must hold every timer and TIMER_NONE");
+
+// Ticks covered by one lap of levels 0..level
+#define LEVEL_SPAN(level) (uint32_t(1) << (TIMER_WHEEL_SLOT_BITS * ((level) + 1)))
+
+TimerWheel::TimerWheel() : count(0), tick(0), tickMillis(0), randomState(0x9E3779B9)
+{
+    for (auto &level : slots)
+    {
+        for (TimerId &slot : level)
+        {
+            slot = TIMER_NONE;
+        }
+    }
+}
+
+TimerId TimerWheel::add(const char *name, TimerCallback callback, uint32_t periodMillis, uint16_t jitterMillis, uint32_t delayMillis)
+{
+    if (count == TIMER_WHEEL_CAPACITY)
+    {
+        LOG_PRINTF(LOG_ERR, "Timer wheel full, %s not added", name);
+        return TIMER_NONE;
+    }
+    if (count == 0)
+    {
+        // The clock starts with the first timer, not at static initialization
+        tickMillis = millis();
+    }
+    TimerId id = count++;
+    Timer &timer = timers[id];
+    timer.name = name;
+    timer.callback = callback;
+    timer.period.store(periodMillis, std::memory_order_relaxed);
+    timer.jitter = jitterMillis;
+    timer.active = false;
+    timer.due = false;
+    start(id, delayMillis);
+    return id;
+}
+
+void TimerWheel::start(TimerId id, uint32_t delayMillis)
+{
+    if (id >= count)
+    {
+        return;
+    }
+    if (timers[id].active)
+    {
+        unlink(id);
+    }
+    timers[id].due = false;
+    schedule(id, millis() + delayMillis);
+}
+
+void TimerWheel::stop(TimerId id)
+{
+    if (id < count && timers[id].active)
+    {
+        unlink(id);
+    }
+    if (id < count)
+    {
+        timers[id].due = false;
+    }
+}
+
+bool TimerWheel::active(TimerId id) const
+{
+    return id < count && timers[id].active;
+}
+
+void TimerWheel::setPeriod(TimerId id, uint32_t periodMillis)
+{
+    if (id < count)
+    {
+        timers[id].period.store(periodMillis, std::memory_order_relaxed);
+    }
+}
+
+uint32_t TimerWheel::period(TimerId id) const
+{
+    return id < count ? timers[id].period.load(std::memory_order_relaxed) : 0;
+}
+
+uint16_t TimerWheel::jitter(TimerId id) const
+{
+    return id < count ? timers[id].jitter : 0;
+}
+
+const char *TimerWheel::name(TimerId id) const
+{
+    return id < count ? timers[id].name : "";
+}
+
+uint32_t TimerWheel::millisUntil(TimerId id) const
+{
+    if (!active(id))
+    {
+        return 0;
+    }
+    // When run() gets to the timer's tick, which may be a little after its deadline
+    unsigned long due = tickMillis + (timers[id].deadlineTick - tick) * TIMER_WHEEL_TICK_MILLIS;
+    long remaining = long(due - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+TimerId TimerWheel::find(const char *name) const
+{
+    for (TimerId id = 0; id < count; id++)
+    {
+        if (strcmp(timers[id].name, name) == 0)
+        {
+            return id;
+        }
+    }
+    return TIMER_NONE;
+}
+
+uint32_t TimerWheel::millisUntilNext(uint32_t maxMillis) const
+{
+    uint32_t next = maxMillis;
+    for (TimerId id = 0; id < count; id++)
+    {
+        if (timers[id].active)
+        {
+            next = std::min(next, millisUntil(id));
+        }
+    }
+    return next;
+}
+
+// xorshift32, jitter needs no better
+uint16_t TimerWheel::randomJitter(uint16_t jitterMillis)
+{
+    if (jitterMillis == 0)
+    {
+        return 0;
+    }
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState % (uint32_t(jitterMillis) + 1);
+}
+
+void TimerWheel::schedule(TimerId id, unsigned long nominal)
+{
+    Timer &timer = timers[id];
+    timer.nominal = nominal;
+    timer.deadline = nominal + randomJitter(timer.jitter);
+    long ahead = long(timer.deadline - tickMillis);
+    timer.deadlineTick = tick + (ahead <= 0 ? 0 : (ahead + TIMER_WHEEL_TICK_MILLIS - 1) / TIMER_WHEEL_TICK_MILLIS);
+    link(id);
+}
+
+void TimerWheel::link(TimerId id)
+{
+    Timer &timer = timers[id];
+    int32_t delta = std::max(int32_t(timer.deadlineTick - tick), int32_t(0));
+    uint8_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && uint32_t(delta) >= LEVEL_SPAN(level))
+    {
+        level++;
+    }
+    // Past the top level: park in its last slot, placed again from there
+    uint32_t target = tick + std::min(uint32_t(delta), LEVEL_SPAN(TIMER_WHEEL_LEVELS - 1) - 1);
+    timer.level = level;
+    timer.slot = (target >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    timer.next = slots[level][timer.slot];
+    slots[level][timer.slot] = id;
+    timer.active = true;
+}
+
+void TimerWheel::unlink(TimerId id)
+{
+    Timer &timer = timers[id];
+    TimerId *link = &slots[timer.level][timer.slot];
+    while (*link != TIMER_NONE && *link != id)
+    {
+        link = &timers[*link].next;
+    }
+    if (*link == id)
+    {
+        *link = timer.next;
+    }
+    timer.active = false;
+}
+
+// Spreads the current slot of level over the levels below
+void TimerWheel::cascade(uint8_t level)
+{
+    TimerId *slot = &slots[level][(tick >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)];
+    TimerId id = *slot;
+    *slot = TIMER_NONE;
+    while (id != TIMER_NONE)
+    {
+        TimerId next = timers[id].next;
+        link(id);
+        id = next;
+    }
+}
+
+// Fires the timers of level 0 slot of tick current, run() has already
+// moved on to the next tick
+void TimerWheel::expire(uint32_t current)
+{
+    TimerId *slot = &slots[0][current & (TIMER_WHEEL_SLOTS - 1)];
+    TimerId id = *slot;
+    *slot = TIMER_NONE;
+    // Everything is rescheduled before the first callback, so callbacks
+    // are free to start and stop any timer. One that is stopped or
+    // restarted before its turn does not fire.
+    TimerId due[TIMER_WHEEL_CAPACITY];
+    uint8_t dueCount = 0;
+    unsigned long now = millis();
+    while (id != TIMER_NONE)
+    {
+        Timer &timer = timers[id];
+        TimerId next = timer.next;
+        timer.active = false;
+        timer.due = true;
+        due[dueCount++] = id;
+        uint32_t period = timer.period.load(std::memory_order_relaxed);
+        if (period > 0)
+        {
+            unsigned long nominal = timer.nominal + period;
+            // After a stall, skip the missed runs rather than catch up
+            schedule(id, long(nominal - now) > 0 ? nominal : now + period);
+        }
+        id = next;
+    }
+    for (uint8_t i = 0; i < dueCount; i++)
+    {
+        Timer &timer = timers[due[i]];
+        if (timer.due)
+        {
+            timer.due = false;
+            timer.callback();
+        }
+    }
+}
+
+void TimerWheel::run()
+{
+    if (count == 0)
+    {
+        return;
+    }
+    unsigned long now = millis();
+    while (long(now - tickMillis) >= 0)
+    {
+        for (uint8_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            if ((tick & (LEVEL_SPAN(level - 1) - 1)) == 0)
+            {
+                cascade(level);
+            }
+        }
+        uint32_t current = tick++;
+        tickMillis += TIMER_WHEEL_TICK_MILLIS;
+        expire(current);
+    }
+}
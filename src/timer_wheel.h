@@ -0,0 +1,104 @@
+#ifndef TIMER_WHEEL_H__
+#define TIMER_WHEEL_H__
+
+#include <atomic>
+#include <stdint.h>
+
+///
+/// Hierarchical timer wheel with a fixed number of timers, for periodic
+/// and one-shot work driven from loop() (or from one task).
+///
+/// Time advances in ticks of TIMER_WHEEL_TICK_MILLIS. Level 0 has one slot
+/// per tick, each higher level one slot per lap of the level below. A
+/// timer sits in the lowest level whose lap covers its deadline, and moves
+/// down as the wheel turns, so run() only looks at the slot of the current
+/// tick. Deadlines further out than the top level are parked in its last
+/// slot and placed again when it comes up.
+///
+/// Deadlines are counted from the wheel's own tick clock, never compared
+/// as absolute millis() values, so they survive the millis() rollover.
+/// Timers fire at most one tick late, plus however late run() is called.
+///
+/// Not thread-safe, except setPeriod() and period(): all other calls must
+/// come from the task that calls run().
+///
+
+// The single loop() build puts every timer on one wheel, 8 with the Modbus
+// client; the rest is spare
+#define TIMER_WHEEL_CAPACITY 12
+#define TIMER_WHEEL_TICK_MILLIS 8
+#define TIMER_WHEEL_LEVELS 3
+// Slots per level, power of two
+#define TIMER_WHEEL_SLOT_BITS 4
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef uint8_t TimerId;
+#define TIMER_NONE 0xFF
+
+typedef void (*TimerCallback)();
+
+class TimerWheel
+{
+public:
+    TimerWheel();
+
+    // Adds a timer, first due after delayMillis. Zero period makes it a
+    // one-shot. Up to jitterMillis of random delay is added to each
+    // deadline, keeping the average period. TIMER_NONE, and an error
+    // logged, if the wheel is full.
+    TimerId add(const char *name, TimerCallback callback, uint32_t periodMillis, uint16_t jitterMillis = 0, uint32_t delayMillis = 0);
+    // (Re)arms the timer to fire after delayMillis
+    void start(TimerId id, uint32_t delayMillis);
+    void stop(TimerId id);
+    bool active(TimerId id) const;
+    // Takes effect from the next deadline. Safe from any task.
+    void setPeriod(TimerId id, uint32_t periodMillis);
+    uint32_t period(TimerId id) const;
+    uint16_t jitter(TimerId id) const;
+    const char *name(TimerId id) const;
+    // Milliseconds until the timer is due, 0 if overdue or stopped
+    uint32_t millisUntil(TimerId id) const;
+    TimerId find(const char *name) const;
+    TimerId size() const { return count; }
+
+    // Calls the callbacks of the timers that are due
+    void run();
+    // Milliseconds until the next timer is due, at most maxMillis
+    uint32_t millisUntilNext(uint32_t maxMillis) const;
+
+private:
+    struct Timer
+    {
+        const char *name;
+        TimerCallback callback;
+        std::atomic<uint32_t> period;
+        uint16_t jitter;
+        bool active;
+        // Expired in the tick being run, callback not called yet
+        bool due;
+        // Deadline without jitter, the next one is counted from it
+        unsigned long nominal;
+        unsigned long deadline;
+        uint32_t deadlineTick;
+        uint8_t level;
+        uint8_t slot;
+        TimerId next;
+    };
+
+    void schedule(TimerId id, unsigned long nominal);
+    void link(TimerId id);
+    void unlink(TimerId id);
+    void cascade(uint8_t level);
+    void expire(uint32_t current);
+    uint16_t randomJitter(uint16_t jitterMillis);
+
+    Timer timers[TIMER_WHEEL_CAPACITY];
+    TimerId slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    TimerId count;
+    // Next tick to process, and the millis() at which it is due
+    uint32_t tick;
+    unsigned long tickMillis;
+    uint32_t randomState;
+};
+
+#endif // TIMER_WHEEL_H__
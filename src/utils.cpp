@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include "constants.h"
 #include "utils.h"
 
 bool streq(const char *a, const char *b)
@@ -16,3 +17,8 @@ bool streq(const char *a, const char *b)
         return strcmp(a, b) == 0;
     }
 }
+
+void espName(char *buf, size_t size)
+{
+    snprintf(buf, size, ESP_NAME_FORMAT, (unsigned long)CHIP_ID, VERSION);
+}
@@ -1,6 +1,10 @@
 #ifndef UTILS_H__
 #define UTILS_H__
 
+#include <stddef.h>
+
 bool streq(const char *a, const char *b);
+// Host name of this ESP into buf, see ESP_NAME_FORMAT
+void espName(char *buf, size_t size);
 
 #endif // UTILS_H__
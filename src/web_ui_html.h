@@ -0,0 +1,218 @@
+// Generated by scripts/embed_web_ui.py from data/web_ui.html, do not edit.
+// 13857 bytes, 12130 minified, 3277 gzipped.
+#ifndef WEB_UI_HTML_H__
+#define WEB_UI_HTML_H__
+
+#include <Arduino.h>
+
+#define WEB_UI_HTML_ETAG "\"6eb49916c7e046f8\""
+static const size_t WEB_UI_HTML_GZ_LEN = 3277;
+static const uint8_t WEB_UI_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x5a, 0x7b, 0x73, 0xda, 0x48,
+    0x12, 0xff, 0x9f, 0x4f, 0x31, 0x51, 0x6a, 0x0d, 0x9c, 0x41, 0x08, 0x01, 0x7e, 0x20, 0x60, 0xcf,
+    0x6b, 0x93, 0xb5, 0xef, 0x62, 0x3b, 0x67, 0x3b, 0xce, 0x6e, 0xed, 0x6d, 0x6d, 0x09, 0x69, 0x00,
+    0x9d, 0x85, 0xa4, 0x95, 0x84, 0xb1, 0x97, 0xf0, 0xdd, 0xaf, 0x7b, 0x1e, 0x42, 0xe2, 0x69, 0xec,
+    0x64, 0x2b, 0x15, 0x4b, 0xd3, 0xd3, 0xd3, 0xbf, 0xee, 0x9e, 0x9e, 0x9e, 0x9e, 0x11, 0xad, 0x77,
+    0x67, 0xd7, 0xa7, 0x77, 0xbf, 0x7e, 0xea, 0x92, 0x61, 0x3c, 0x72, 0x3b, 0xb9, 0x96, 0x7c, 0x50,
+    0xd3, 0x86, 0xc7, 0x88, 0xc6, 0x26, 0xf1, 0xcc, 0x11, 0x6d, 0xe7, 0x1f, 0x1d, 0x3a, 0x09, 0xfc,
+    0x30, 0xce, 0x13, 0xcb, 0xf7, 0x62, 0xea, 0xc5, 0xed, 0xfc, 0xc4, 0xb1, 0xe3, 0x61, 0xdb, 0xa6,
+    0x8f, 0x8e, 0x45, 0xcb, 0xac, 0x51, 0x22, 0x8e, 0xe7, 0xc4, 0x8e, 0xe9, 0x96, 0x23, 0xcb, 0x74,
+    0x69, 0xbb, 0x5a, 0x22, 0xe3, 0x88, 0x86, 0xac, 0x65, 0xf6, 0x80, 0xf0, 0x4c, 0xa3, 0x7c, 0xa5,
+    0xd3, 0x8a, 0xe2, 0x67, 0x97, 0x76, 0x7a, 0xbe, 0xfd, 0x3c, 0xb5, 0x7c, 0xd7, 0x0f, 0x9b, 0xef,
+    0xcf, 0xce, 0xce, 0x8c, 0x3e, 0x08, 0x2e, 0x47, 0xce, 0x5f, 0xb4, 0x59, 0xd7, 0x82, 0x27, 0xa3,
+    0x67, 0x5a, 0x0f, 0x83, 0xd0, 0x1f, 0x7b, 0x76, 0xf3, 0x7d, 0xad, 0x56, 0x33, 0x66, 0x6a, 0x6f,
+    0x1c, 0xc7, 0xbe, 0x37, 0x9d, 0x77, 0x94, 0xc5, 0xe8, 0xfa, 0xe9, 0xc9, 0x87, 0x86, 0x66, 0xf4,
+    0xfc, 0xd0, 0xa6, 0x61, 0xd3, 0xf3, 0x3d, 0x6a, 0xf0, 0x9e, 0xc9, 0xd0, 0x89, 0xa9, 0x11, 0x98,
+    0xb6, 0xed, 0x78, 0x83, 0x66, 0x03, 0xa4, 0xc6, 0xf4, 0x29, 0x2e, 0x9b, 0xae, 0x33, 0xf0, 0x9a,
+    0x16, 0x58, 0x41, 0x43, 0x4e, 0xb1, 0xa9, 0xe5, 0x87, 0x66, 0xec, 0xf8, 0x1e, 0x1f, 0x6e, 0x3b,
+    0x51, 0xe0, 0x9a, 0xcf, 0x4d, 0xc7, 0x73, 0x1d, 0x8f, 0x96, 0x7b, 0xae, 0x6f, 0x3d, 0xa4, 0x14,
+    0xd4, 0x51, 0xd4, 0x4c, 0x8d, 0x26, 0x4e, 0x6c, 0x0d, 0xa7, 0x81, 0x1f, 0x39, 0x6c, 0x68, 0x48,
+    0x5d, 0x90, 0xf1, 0xb8, 0x66, 0xf8, 0x90, 0x3a, 0x83, 0x61, 0xdc, 0xac, 0xd5, 0xf9, 0x58, 0xd7,
+    0x01, 0x65, 0xbf, 0xa0, 0xdb, 0xa6, 0xcc, 0x79, 0xcd, 0x03, 0x2d, 0x25, 0x14, 0x3c, 0x19, 0x8c,
+    0xe3, 0x92, 0x6a, 0x87, 0x7e, 0x60, 0xfb, 0x13, 0x8f, 0xb7, 0xa7, 0x52, 0x30, 0x53, 0x12, 0x78,
+    0xa9, 0x4b, 0xad, 0x98, 0xda, 0xd3, 0xf2, 0x84, 0xf6, 0x1e, 0x9c, 0xb8, 0xdc, 0x77, 0x5c, 0xb0,
+    0xa9, 0x39, 0x08, 0xcd, 0x67, 0x36, 0x05, 0x85, 0xaa, 0xa6, 0xfd, 0x50, 0x34, 0xd6, 0x90, 0x97,
+    0x9d, 0x31, 0x63, 0x30, 0x4d, 0x6b, 0x48, 0xad, 0x07, 0x6a, 0x93, 0x7d, 0xf2, 0x02, 0x88, 0x95,
+    0x00, 0x48, 0x9c, 0xa9, 0x7d, 0xd3, 0x2b, 0xa9, 0xe6, 0x38, 0xf6, 0xe5, 0x3c, 0x6b, 0xa7, 0xda,
+    0x4c, 0xfd, 0x33, 0x0a, 0x28, 0x08, 0xe4, 0x56, 0xeb, 0x68, 0xb5, 0x70, 0x8d, 0xf0, 0x2a, 0xeb,
+    0x15, 0x03, 0xac, 0x46, 0x43, 0x92, 0x7a, 0x66, 0x98, 0x1e, 0x93, 0x8e, 0x0f, 0xe4, 0x5a, 0xe9,
+    0x73, 0x31, 0xb4, 0x3a, 0x15, 0x08, 0x5a, 0x0a, 0x42, 0x97, 0xc4, 0x2a, 0x10, 0x05, 0xad, 0x26,
+    0x69, 0xfa, 0x9c, 0x56, 0x97, 0xb4, 0x1a, 0xa7, 0xb1, 0x89, 0x9b, 0x4f, 0xba, 0xd9, 0x8b, 0x7c,
+    0x77, 0x0c, 0x61, 0x66, 0x8d, 0xc3, 0x08, 0x54, 0x0e, 0x7c, 0x87, 0xc7, 0x95, 0x1f, 0x34, 0x35,
+    0xc3, 0xa5, 0x7d, 0x40, 0x35, 0x42, 0x8e, 0x0e, 0x21, 0x0a, 0x21, 0x3c, 0xc2, 0x97, 0xa5, 0x20,
+    0xb6, 0x2c, 0xcb, 0x90, 0x3e, 0x8e, 0x43, 0xd3, 0x13, 0xe2, 0xd5, 0x7a, 0x64, 0x2c, 0x34, 0xa5,
+    0x0e, 0xcd, 0x1e, 0xed, 0xfb, 0x21, 0x5d, 0xa5, 0x0a, 0x5f, 0xa3, 0x4d, 0x45, 0x91, 0xae, 0xd5,
+    0x0f, 0xc0, 0x70, 0xe1, 0x3d, 0x7c, 0x65, 0x7a, 0x61, 0x24, 0x0a, 0x8d, 0xea, 0x19, 0x8f, 0x96,
+    0xd3, 0xcb, 0xe7, 0x85, 0x4a, 0x2d, 0x47, 0x0e, 0x77, 0xd4, 0xb2, 0xa5, 0x9a, 0xa5, 0x49, 0xf6,
+    0xbe, 0x6f, 0x8d, 0xa3, 0x34, 0xb3, 0xff, 0x54, 0x8e, 0x86, 0x26, 0x44, 0x7c, 0x53, 0x23, 0x1a,
+    0xa9, 0x06, 0x4f, 0xe4, 0xbd, 0x5e, 0x3d, 0x3e, 0xf8, 0x50, 0x5b, 0x0b, 0x20, 0xbd, 0x90, 0x51,
+    0x13, 0x28, 0xa3, 0x26, 0x7b, 0x83, 0x15, 0x49, 0x7f, 0x29, 0xa0, 0xcd, 0x45, 0xa3, 0x3c, 0x8a,
+    0x36, 0x75, 0x6f, 0xe8, 0x92, 0x2e, 0x57, 0x99, 0x21, 0x53, 0x9e, 0x69, 0xca, 0xa1, 0x69, 0x3b,
+    0xe3, 0x48, 0xae, 0xe8, 0xd0, 0x8f, 0x61, 0x84, 0x36, 0x5d, 0x13, 0x88, 0xbc, 0x5b, 0xd7, 0x57,
+    0xf7, 0x67, 0x55, 0xe3, 0xbc, 0x05, 0x5d, 0x57, 0x1b, 0x36, 0x1d, 0x14, 0x8d, 0x65, 0xdb, 0x16,
+    0x39, 0xd6, 0xf7, 0x48, 0xe4, 0x7a, 0x63, 0x07, 0xe4, 0xfa, 0x16, 0xdc, 0xfa, 0x1a, 0xd4, 0x7a,
+    0x16, 0xb3, 0x71, 0xb8, 0x03, 0x66, 0xe3, 0x70, 0x33, 0xa6, 0xe8, 0x5f, 0x47, 0x97, 0x98, 0x07,
+    0xbb, 0x60, 0x1e, 0x1c, 0x6e, 0xf3, 0x70, 0xc2, 0xb1, 0xbe, 0x47, 0x22, 0x1f, 0x6b, 0x3b, 0x20,
+    0x1f, 0x6b, 0x9b, 0x71, 0x45, 0xff, 0x3a, 0xba, 0xc4, 0xac, 0xea, 0xf5, 0x1d, 0x40, 0x81, 0x7b,
+    0x33, 0xaa, 0x64, 0x58, 0xdb, 0x91, 0xe0, 0xd6, 0x76, 0x09, 0x27, 0xe0, 0xde, 0x82, 0x5b, 0x5b,
+    0xe3, 0x64, 0xd9, 0x91, 0xe0, 0xee, 0x14, 0x52, 0xc0, 0xbd, 0x6d, 0x7e, 0xe7, 0x2c, 0x1b, 0xba,
+    0x12, 0xf4, 0xa3, 0x5d, 0xa6, 0x18, 0xb8, 0xb7, 0x60, 0x1f, 0xad, 0x99, 0x64, 0xd9, 0x21, 0x71,
+    0xef, 0x57, 0xd4, 0x18, 0x7d, 0xd7, 0x37, 0xe3, 0x26, 0xe6, 0x71, 0xc3, 0xf4, 0x9c, 0x11, 0x2b,
+    0x5e, 0xca, 0x58, 0xac, 0x35, 0xa1, 0x82, 0xf0, 0x06, 0xf7, 0x29, 0xaa, 0x3d, 0x16, 0xb5, 0x4d,
+    0x23, 0x4a, 0x53, 0x9d, 0x10, 0x76, 0x76, 0xb6, 0x6f, 0xe0, 0xe6, 0xed, 0x01, 0x4e, 0xaa, 0x17,
+    0x32, 0x3f, 0x1f, 0x04, 0x59, 0x7b, 0x0c, 0x5b, 0x89, 0xe3, 0xf5, 0xb1, 0xb8, 0xa3, 0x73, 0x65,
+    0xcb, 0x3e, 0xec, 0x6a, 0x8e, 0xc7, 0x54, 0x20, 0xb2, 0x7e, 0xf8, 0x67, 0x79, 0xe4, 0xff, 0x55,
+    0x7e, 0xa0, 0xcf, 0xfd, 0x10, 0x54, 0x89, 0x08, 0xd7, 0x65, 0xaa, 0xfd, 0x30, 0x65, 0x1d, 0x4b,
+    0x96, 0x32, 0x3b, 0x67, 0x7a, 0x63, 0x5d, 0xbf, 0x4c, 0x63, 0xb3, 0xc6, 0x5a, 0x11, 0x3c, 0xe7,
+    0xcc, 0x0e, 0xd7, 0xca, 0x90, 0x0b, 0x75, 0x86, 0x55, 0xcf, 0x1a, 0x1e, 0xbe, 0xac, 0x66, 0xa0,
+    0xbf, 0x98, 0xac, 0x95, 0x26, 0xac, 0x9b, 0xc8, 0x94, 0x15, 0xdb, 0x32, 0x35, 0x37, 0x64, 0x73,
+    0x5e, 0xe5, 0xb6, 0x6c, 0xcb, 0x48, 0xc2, 0x9c, 0xcd, 0x09, 0x64, 0x26, 0x43, 0xe8, 0x7c, 0xf7,
+    0x10, 0x3a, 0xff, 0xdb, 0x42, 0x88, 0x47, 0xcf, 0xe6, 0x20, 0x3a, 0x5f, 0x1f, 0x44, 0x89, 0x6f,
+    0xd7, 0xc7, 0x11, 0xdf, 0x24, 0x36, 0x44, 0x91, 0x70, 0xd7, 0xfa, 0x28, 0x12, 0x19, 0x70, 0x53,
+    0x10, 0x25, 0x09, 0x63, 0x7d, 0x1c, 0x9d, 0x6f, 0x8c, 0xa3, 0xac, 0x21, 0x9b, 0x37, 0xc2, 0xcd,
+    0x81, 0x94, 0x36, 0x67, 0x4b, 0xb2, 0xdf, 0x12, 0x47, 0x29, 0xa3, 0x32, 0x45, 0x90, 0xac, 0xbb,
+    0xb2, 0xb5, 0x10, 0x28, 0x05, 0x59, 0x6b, 0xe8, 0xd8, 0x36, 0xf5, 0xa6, 0x8f, 0x4e, 0xe4, 0xf4,
+    0x1c, 0xd7, 0x89, 0x9f, 0x9b, 0x9c, 0x32, 0x63, 0xe7, 0x99, 0x5e, 0xbc, 0xe2, 0x10, 0xc7, 0x70,
+    0x03, 0x33, 0x84, 0x10, 0xc8, 0x1c, 0xde, 0x32, 0x87, 0xba, 0x6c, 0x85, 0x3d, 0x4b, 0x4e, 0x47,
+    0x2f, 0x3d, 0x82, 0xcd, 0x47, 0x94, 0x45, 0x89, 0x9c, 0x3d, 0x51, 0x2d, 0x57, 0xd2, 0xcb, 0xd5,
+    0x2b, 0x9e, 0x45, 0xd3, 0x27, 0xca, 0x74, 0xc9, 0x0a, 0xe5, 0xea, 0x11, 0xfc, 0xaf, 0x42, 0xcd,
+    0x48, 0xb0, 0x11, 0x0e, 0x7a, 0x66, 0x41, 0x2b, 0xb1, 0x7f, 0xaa, 0x5e, 0x34, 0xfe, 0x2a, 0x3b,
+    0x9e, 0x4d, 0x9f, 0x9a, 0xd5, 0x15, 0x9a, 0x10, 0x38, 0x22, 0x53, 0x77, 0x9a, 0xb6, 0x7d, 0xe3,
+    0xd1, 0x74, 0xd1, 0xa2, 0xe6, 0xd0, 0x7f, 0x84, 0x35, 0xb4, 0xde, 0x42, 0x31, 0x20, 0xc6, 0x93,
+    0xb8, 0x38, 0x48, 0xe1, 0xcc, 0x0b, 0x0a, 0x89, 0x43, 0x12, 0xdb, 0xcd, 0xbe, 0x13, 0x46, 0x71,
+    0xd9, 0x1a, 0x3a, 0xae, 0x3c, 0xa0, 0x1d, 0xb0, 0x23, 0x53, 0xab, 0xc2, 0x0f, 0xed, 0xad, 0xc8,
+    0x0a, 0x9d, 0x20, 0xee, 0x3c, 0x9a, 0x21, 0xb9, 0x39, 0xb9, 0xeb, 0x92, 0x36, 0xa9, 0x6a, 0x46,
+    0x0e, 0x9b, 0xf7, 0x27, 0x57, 0xdd, 0x3f, 0x4e, 0x3f, 0x9e, 0xdc, 0xde, 0x76, 0x6f, 0x81, 0x3c,
+    0x55, 0x4e, 0x3e, 0xdf, 0x5d, 0x2b, 0x4d, 0x45, 0xd4, 0xc5, 0x4a, 0x89, 0x28, 0xd5, 0x6c, 0x53,
+    0x4f, 0x9a, 0xba, 0x8e, 0xed, 0x5a, 0xd2, 0xae, 0x37, 0xb0, 0x5d, 0x4f, 0xda, 0x07, 0x87, 0xd8,
+    0x6e, 0x24, 0xed, 0x63, 0x36, 0xfe, 0xf6, 0xcb, 0xc5, 0xd5, 0xcf, 0x09, 0xed, 0x5e, 0x99, 0x71,
+    0x45, 0xbe, 0x5c, 0x9c, 0x75, 0x97, 0x94, 0x69, 0xb5, 0x12, 0x46, 0x88, 0x68, 0x1c, 0x9d, 0x22,
+    0xe8, 0x75, 0x24, 0x7c, 0x5d, 0x10, 0xdf, 0x49, 0xda, 0x7c, 0x40, 0xa7, 0xb3, 0xa0, 0x6f, 0x0b,
+    0x09, 0xcb, 0x8a, 0x9c, 0x4b, 0x45, 0x4e, 0x6e, 0x6e, 0xae, 0xbf, 0x00, 0xba, 0xb2, 0xf7, 0xbe,
+    0xaa, 0x55, 0xeb, 0x35, 0x43, 0xe1, 0xf4, 0x08, 0xb9, 0x80, 0xee, 0x8d, 0x5d, 0x97, 0x53, 0x20,
+    0x8d, 0x52, 0x88, 0x5a, 0x1b, 0x88, 0xe0, 0xcd, 0xfe, 0xd8, 0x63, 0x59, 0x95, 0xf4, 0x9e, 0x2f,
+    0xec, 0x82, 0x63, 0x17, 0xc9, 0x14, 0x38, 0xe2, 0x71, 0xe8, 0x11, 0x1b, 0x0e, 0x4c, 0x23, 0x98,
+    0x55, 0x75, 0x40, 0xe3, 0xae, 0x4b, 0xf1, 0xf5, 0x27, 0xc1, 0x64, 0x90, 0xd9, 0x7c, 0xa4, 0x35,
+    0x34, 0xbd, 0x01, 0xbd, 0x37, 0x3d, 0x0a, 0x5d, 0x25, 0xcb, 0x8d, 0x4a, 0xf1, 0x53, 0x5c, 0x7a,
+    0x34, 0xdd, 0x62, 0x6e, 0x9a, 0x13, 0x62, 0xf7, 0x95, 0x3f, 0x94, 0xa2, 0x6a, 0xb9, 0x66, 0x14,
+    0x5d, 0xe1, 0x25, 0x0f, 0x70, 0x19, 0xd9, 0x3e, 0xc7, 0xf3, 0x68, 0x78, 0x7e, 0x77, 0xf9, 0xb1,
+    0x0d, 0xa3, 0x93, 0xbe, 0xa2, 0x0a, 0x72, 0xc6, 0xb4, 0x0d, 0x7f, 0x8d, 0x5c, 0x44, 0x3d, 0xbb,
+    0xc0, 0x3a, 0x94, 0x0f, 0xca, 0xbe, 0x18, 0x58, 0x34, 0x72, 0x29, 0x5d, 0x22, 0x1a, 0xdf, 0xd1,
+    0x51, 0x50, 0xe8, 0x21, 0xb6, 0xd3, 0x27, 0x85, 0x77, 0xcc, 0x01, 0x73, 0xab, 0x50, 0x73, 0xf4,
+    0x42, 0x0c, 0xe6, 0x33, 0x51, 0xf9, 0xbb, 0xee, 0xe5, 0xa7, 0x3c, 0x48, 0x71, 0xfa, 0x85, 0x1e,
+    0xd9, 0xdb, 0x23, 0x31, 0x87, 0x24, 0x2d, 0x52, 0xab, 0x82, 0x14, 0xd9, 0xde, 0xdf, 0xc7, 0xa1,
+    0xd4, 0x8d, 0x28, 0x01, 0xce, 0x77, 0x19, 0xd6, 0x0e, 0x2c, 0xc3, 0x14, 0x6b, 0xb9, 0x8c, 0xac,
+    0x69, 0x6d, 0x11, 0x63, 0x49, 0x57, 0x76, 0xbc, 0xbc, 0x81, 0x5c, 0xe6, 0x17, 0x70, 0x23, 0x2c,
+    0x11, 0x36, 0x18, 0x15, 0x47, 0x05, 0xd9, 0x11, 0x34, 0x02, 0x2d, 0x57, 0x4c, 0x43, 0xf4, 0xd3,
+    0x33, 0x7a, 0x91, 0x0d, 0x03, 0x99, 0x90, 0x1b, 0x49, 0x81, 0x8d, 0x61, 0x73, 0x0a, 0x8f, 0x96,
+    0x18, 0xae, 0xba, 0xd4, 0x1b, 0xc4, 0x43, 0x20, 0xed, 0xef, 0xa3, 0x82, 0x9c, 0xfa, 0x9b, 0xf3,
+    0xbb, 0x2a, 0xcf, 0xb6, 0xed, 0x14, 0x8d, 0x1b, 0xd3, 0x6e, 0x73, 0x45, 0xd0, 0x86, 0xb4, 0x67,
+    0x87, 0xfe, 0x44, 0xce, 0x31, 0xc1, 0x49, 0x26, 0x38, 0xcb, 0xe4, 0x3b, 0x4c, 0x73, 0x0a, 0x14,
+    0x52, 0x34, 0x64, 0xe4, 0x42, 0x84, 0x10, 0x32, 0x92, 0x41, 0x62, 0x2a, 0x84, 0xcf, 0x80, 0xa8,
+    0x7a, 0xfe, 0xa4, 0x50, 0x14, 0xc2, 0x94, 0xb3, 0xee, 0x4f, 0x9f, 0x7f, 0x4e, 0x23, 0xe1, 0x18,
+    0xd5, 0xa6, 0xbd, 0xf1, 0x80, 0xfc, 0x48, 0x94, 0x0b, 0x8f, 0x30, 0x0e, 0x32, 0xf2, 0x6d, 0xaa,
+    0x92, 0x73, 0x6a, 0xc6, 0xc1, 0x78, 0x14, 0x90, 0x89, 0xe3, 0xba, 0xc4, 0xf3, 0x63, 0xd2, 0xa3,
+    0x78, 0xef, 0xe8, 0xb1, 0x9b, 0x28, 0x55, 0x21, 0x4d, 0x36, 0xe4, 0xd3, 0xcd, 0xf5, 0xd9, 0xe7,
+    0xd3, 0xbb, 0x8b, 0xeb, 0x2b, 0x52, 0xe0, 0xc3, 0x91, 0xd5, 0xa6, 0x50, 0x65, 0x50, 0x58, 0x33,
+    0x28, 0x4b, 0x91, 0x0a, 0xdc, 0x77, 0x6f, 0x6e, 0x81, 0x71, 0x49, 0x05, 0x48, 0x99, 0x11, 0x18,
+    0x25, 0xd9, 0x6e, 0xae, 0xaf, 0x2f, 0x31, 0x2e, 0x96, 0xf8, 0x42, 0xdf, 0x1f, 0x61, 0x10, 0xab,
+    0xb1, 0xff, 0xc1, 0x79, 0xa2, 0x76, 0x41, 0x4f, 0x6c, 0xfb, 0x74, 0xfd, 0xa5, 0x7b, 0x83, 0x1e,
+    0x4e, 0x66, 0x2f, 0x52, 0x03, 0x7f, 0x02, 0xb9, 0x18, 0x66, 0x4d, 0x01, 0x4c, 0x23, 0x97, 0x8a,
+    0x2a, 0xe5, 0xf2, 0xfa, 0xac, 0x0b, 0x39, 0x23, 0x52, 0x51, 0xbf, 0x62, 0xb6, 0xef, 0xc3, 0xc9,
+    0x15, 0xeb, 0xea, 0x9b, 0x5e, 0x22, 0x5e, 0xa8, 0x23, 0xe2, 0x80, 0x5c, 0x9a, 0xf1, 0x90, 0x6f,
+    0xc0, 0x85, 0x48, 0x8d, 0x41, 0x23, 0x60, 0x4c, 0xc2, 0x40, 0xc1, 0xb4, 0x07, 0x12, 0xd2, 0xd9,
+    0xef, 0x37, 0x30, 0x12, 0xfa, 0x7e, 0x27, 0x5f, 0xbf, 0x12, 0x85, 0x49, 0xc7, 0x26, 0xd3, 0x8d,
+    0x25, 0x68, 0xf4, 0x3f, 0x7f, 0x69, 0xf2, 0x84, 0x25, 0x59, 0x32, 0x82, 0x65, 0x4e, 0x05, 0x01,
+    0x8b, 0xe9, 0x15, 0x00, 0x60, 0xa7, 0x60, 0xb9, 0x26, 0x05, 0x22, 0x49, 0x0c, 0x08, 0x12, 0x25,
+    0xf9, 0x31, 0xa7, 0xb4, 0x6c, 0xe7, 0x91, 0xb0, 0x40, 0x6c, 0xe7, 0x93, 0xcc, 0x9b, 0x87, 0xbe,
+    0x7d, 0x91, 0x2a, 0xf7, 0x81, 0xb5, 0x02, 0x4c, 0x9d, 0x3d, 0xaf, 0x17, 0x05, 0xc6, 0x32, 0x7f,
+    0xe3, 0x70, 0x25, 0x7b, 0x46, 0x77, 0x89, 0x0c, 0xfa, 0xc7, 0x8e, 0xf5, 0x50, 0xc8, 0x2e, 0x70,
+    0x4e, 0xda, 0x92, 0x88, 0xa0, 0x88, 0x08, 0xa2, 0x85, 0x50, 0x26, 0xe5, 0x24, 0x4b, 0xcb, 0xa9,
+    0xf9, 0xfc, 0xe9, 0xee, 0xe2, 0xb2, 0xbb, 0x10, 0x2b, 0x6c, 0x82, 0xa0, 0xb2, 0xf6, 0x61, 0x89,
+    0xa0, 0x74, 0x75, 0x1c, 0xc4, 0xce, 0x88, 0x82, 0xb2, 0x52, 0x6a, 0x05, 0xb6, 0x4c, 0x4d, 0x4b,
+    0x26, 0xf8, 0xf4, 0xfa, 0xea, 0xaa, 0x7b, 0x7a, 0xd7, 0x3d, 0x5b, 0x10, 0xc4, 0x95, 0x53, 0x93,
+    0xb8, 0xc7, 0x89, 0xba, 0x82, 0x00, 0x9f, 0x13, 0x62, 0x9f, 0x0c, 0xc5, 0x52, 0xc1, 0x45, 0x91,
+    0x53, 0x4e, 0x57, 0x76, 0x91, 0x8f, 0x66, 0x84, 0xc3, 0x46, 0xa3, 0xa8, 0x89, 0xce, 0x13, 0x7a,
+    0x81, 0x5f, 0xe3, 0x53, 0x24, 0x42, 0x66, 0xd2, 0x98, 0xf0, 0xca, 0x09, 0x3a, 0x32, 0x65, 0xc0,
+    0x12, 0x67, 0x62, 0x44, 0x51, 0x5a, 0x51, 0xc4, 0x59, 0x80, 0x14, 0x0f, 0x5a, 0xd9, 0x11, 0x31,
+    0x07, 0xbe, 0xb2, 0x90, 0x2c, 0xfe, 0x1c, 0xd3, 0x28, 0x2e, 0x8c, 0x68, 0x3c, 0xf4, 0x21, 0x49,
+    0x8d, 0x43, 0xb7, 0x44, 0xf0, 0xe6, 0x5f, 0xa6, 0xd4, 0xa7, 0x61, 0x88, 0x3b, 0x21, 0x9d, 0x90,
+    0x5f, 0x2e, 0x3f, 0x9e, 0xc7, 0x71, 0x70, 0x23, 0x46, 0x80, 0x7f, 0xa0, 0x4f, 0xf5, 0x03, 0xea,
+    0xa5, 0x47, 0x4b, 0xb2, 0x07, 0x67, 0x17, 0x9c, 0x20, 0x89, 0x54, 0xc0, 0x59, 0xc4, 0x39, 0xc5,
+    0x5e, 0x54, 0x7b, 0x1c, 0x61, 0xe8, 0xe9, 0xa0, 0x22, 0x9b, 0x5e, 0x96, 0xb3, 0xfe, 0x75, 0x7b,
+    0x7d, 0xa5, 0x42, 0x91, 0x19, 0x51, 0xc6, 0x16, 0xd2, 0x28, 0xf0, 0xbd, 0x88, 0xde, 0x41, 0x9d,
+    0x55, 0xc4, 0xfd, 0x93, 0xcc, 0x0c, 0x16, 0x17, 0x4c, 0x41, 0x18, 0xc6, 0x64, 0xd1, 0x58, 0xa8,
+    0x04, 0x69, 0x09, 0x85, 0xa0, 0x97, 0xb1, 0xb0, 0x2a, 0xdf, 0x3d, 0x07, 0x14, 0x77, 0x7f, 0x33,
+    0x08, 0x5c, 0xc7, 0x62, 0x25, 0x5a, 0xe5, 0xa9, 0x3c, 0x99, 0x4c, 0xca, 0xec, 0x6c, 0x03, 0xca,
+    0x52, 0xcf, 0x82, 0x45, 0x6e, 0x2b, 0x6c, 0x6f, 0xe6, 0xc2, 0x70, 0xff, 0x41, 0xe9, 0x0b, 0x3b,
+    0x24, 0x90, 0x71, 0x90, 0xf4, 0x4a, 0xdf, 0xa1, 0xae, 0x8d, 0x1b, 0xcd, 0x6f, 0xbf, 0xaf, 0xde,
+    0x4a, 0x90, 0x59, 0xa5, 0x62, 0xe7, 0x59, 0xd8, 0x51, 0x78, 0x08, 0xa3, 0x6f, 0xd2, 0x4c, 0xb0,
+    0x99, 0x70, 0xe3, 0x20, 0x9e, 0x61, 0x1b, 0xc0, 0xad, 0xb2, 0x00, 0xef, 0x31, 0x18, 0x41, 0xde,
+    0xc1, 0x1a, 0x65, 0x79, 0x08, 0x8a, 0x59, 0x05, 0x7b, 0x52, 0x74, 0x2c, 0xec, 0x7d, 0xa5, 0x88,
+    0x2b, 0x9b, 0xca, 0x1c, 0x57, 0xc4, 0x7d, 0x8b, 0xeb, 0xa8, 0x06, 0xe3, 0x68, 0x58, 0xe0, 0x86,
+    0x7e, 0xbe, 0xb9, 0x80, 0x30, 0x01, 0x97, 0x02, 0x9e, 0x80, 0x61, 0xe1, 0xd1, 0xc6, 0xa8, 0x5b,
+    0xc9, 0xc2, 0x77, 0xd7, 0x22, 0xdf, 0xd6, 0x64, 0xac, 0x40, 0x46, 0xbd, 0xbd, 0x43, 0xc7, 0x56,
+    0xcc, 0xc0, 0xa9, 0x80, 0xff, 0xe1, 0x5d, 0x80, 0xfd, 0x0f, 0x4a, 0xff, 0x82, 0xb2, 0xc7, 0x76,
+    0x6d, 0x51, 0x11, 0xf5, 0x4d, 0xd8, 0xfe, 0x33, 0xde, 0x0c, 0x7c, 0xd7, 0x65, 0x4b, 0x1c, 0x86,
+    0x5e, 0xe0, 0x49, 0x01, 0x50, 0x0a, 0x99, 0x38, 0x49, 0x90, 0x7e, 0xee, 0xa6, 0x80, 0x30, 0xd6,
+    0xd9, 0x54, 0x95, 0x78, 0x69, 0xfb, 0x0f, 0xb9, 0x4e, 0xd3, 0x33, 0x35, 0xee, 0x61, 0x05, 0xdc,
+    0xa3, 0x4b, 0x00, 0x98, 0x58, 0x4a, 0x72, 0x04, 0x4b, 0x2e, 0x70, 0xde, 0x83, 0x42, 0x5c, 0xed,
+    0x3e, 0x82, 0xad, 0xb7, 0xfe, 0x38, 0xb4, 0xe8, 0x76, 0x6c, 0xae, 0xbb, 0xb1, 0x98, 0x8f, 0x50,
+    0x44, 0x24, 0xd6, 0x49, 0x4a, 0x5e, 0x81, 0x8f, 0xe6, 0xdd, 0x30, 0x3c, 0xc7, 0xdf, 0x60, 0x75,
+    0xc0, 0x81, 0x33, 0x32, 0x07, 0x34, 0xbd, 0x40, 0xe8, 0xea, 0x85, 0x40, 0x55, 0xdb, 0x8c, 0x4d,
+    0x36, 0x07, 0xa9, 0xf1, 0x34, 0x0c, 0xfd, 0x70, 0xd5, 0xf2, 0x12, 0x1c, 0x21, 0xac, 0x85, 0xe7,
+    0x5b, 0xbe, 0xfb, 0xc3, 0x2a, 0xc3, 0x5e, 0xa9, 0x3a, 0x5b, 0x45, 0x78, 0x60, 0xe0, 0x27, 0x85,
+    0x56, 0x45, 0x7c, 0x4d, 0xc4, 0xb0, 0x27, 0x7c, 0xdd, 0xb6, 0x95, 0x94, 0x1f, 0x15, 0xe8, 0x83,
+    0x93, 0x9f, 0x47, 0x1c, 0xa0, 0xf3, 0x42, 0x01, 0x06, 0x21, 0xa5, 0xd3, 0xea, 0x85, 0xa4, 0x92,
+    0xee, 0x9e, 0xe7, 0xca, 0x8e, 0xc8, 0x75, 0x70, 0x0c, 0x53, 0x55, 0x35, 0xcb, 0xff, 0x99, 0x65,
+    0xdc, 0x26, 0x99, 0x8f, 0x13, 0x99, 0x7a, 0x41, 0xee, 0x3d, 0xdf, 0xfc, 0xd3, 0x8c, 0xb2, 0x4e,
+    0x58, 0xd4, 0x80, 0x9d, 0x91, 0xf0, 0x19, 0xe2, 0x1f, 0xbb, 0xb3, 0xf7, 0xfe, 0xa9, 0xda, 0xaf,
+    0xe9, 0x55, 0xa3, 0x55, 0x81, 0x16, 0x52, 0xe6, 0x32, 0x92, 0x22, 0x42, 0x0a, 0xd9, 0x83, 0xe3,
+    0xb3, 0x71, 0xca, 0x38, 0xd3, 0x12, 0x8e, 0x8f, 0x8e, 0x8e, 0x8d, 0xbd, 0xf7, 0x07, 0x0d, 0xad,
+    0x76, 0x6c, 0xc8, 0x5e, 0xfc, 0x83, 0xeb, 0x96, 0x49, 0xc2, 0x17, 0x05, 0x7c, 0xc6, 0xab, 0x79,
+    0xf0, 0x1a, 0xe6, 0x89, 0x78, 0xe8, 0x44, 0x45, 0xa4, 0x82, 0x0f, 0x47, 0x4e, 0xdc, 0x56, 0xc4,
+    0x42, 0x48, 0x75, 0x82, 0x0c, 0x56, 0x41, 0xf2, 0x8f, 0xb7, 0xca, 0xa7, 0x2f, 0x37, 0xa7, 0xe7,
+    0xff, 0x56, 0x08, 0xae, 0xe9, 0xb6, 0xc2, 0x8f, 0xe2, 0x0a, 0x2f, 0x28, 0xdb, 0x0a, 0x32, 0xb3,
+    0xa3, 0xa7, 0xd8, 0x69, 0x15, 0xfe, 0x01, 0x72, 0x49, 0x06, 0xab, 0x72, 0x98, 0x56, 0xe2, 0x95,
+    0x4b, 0x9b, 0xa7, 0x0d, 0x21, 0x0f, 0x9d, 0x97, 0x4b, 0xed, 0xdc, 0x4a, 0xea, 0x4b, 0x27, 0xe1,
+    0xef, 0x84, 0xd5, 0x2f, 0xe8, 0x1e, 0xdc, 0xbc, 0x73, 0xad, 0x0a, 0xc3, 0xc7, 0x17, 0x34, 0x18,
+    0x9f, 0xcc, 0x0d, 0x15, 0xee, 0xaa, 0xb4, 0xbf, 0xaa, 0xcb, 0x7e, 0x7a, 0x95, 0x77, 0x5e, 0x60,
+    0x30, 0xab, 0xd3, 0x84, 0x91, 0x3c, 0x07, 0x4a, 0x0b, 0x59, 0xb5, 0xb4, 0x60, 0xa3, 0xf8, 0x4a,
+    0x4a, 0xf0, 0x63, 0xa7, 0xc2, 0x74, 0x6d, 0xa0, 0xae, 0x0b, 0xf6, 0xbd, 0x09, 0xf6, 0xec, 0xe6,
+    0xd7, 0x35, 0xa8, 0x08, 0x58, 0xd5, 0x8f, 0xaa, 0x07, 0x87, 0xdf, 0x18, 0xf2, 0xf4, 0xfa, 0xfa,
+    0xe3, 0x26, 0x4c, 0x4d, 0x6b, 0xe8, 0xa9, 0x08, 0xfe, 0x96, 0xd0, 0xe7, 0xdd, 0x93, 0xbb, 0x0d,
+    0xd0, 0xc7, 0x87, 0xfa, 0xd1, 0x77, 0x42, 0xc6, 0x22, 0x7c, 0xcd, 0xec, 0x42, 0x5d, 0x2e, 0xed,
+    0x5e, 0x31, 0xbb, 0x9b, 0xa3, 0xb7, 0xaa, 0x1f, 0x1e, 0x1e, 0x1d, 0xfd, 0x7d, 0xf1, 0x8b, 0x66,
+    0xec, 0x1c, 0xbe, 0xec, 0x83, 0xf7, 0x9b, 0xe2, 0x77, 0x2d, 0xec, 0x7f, 0x3e, 0x5f, 0x74, 0xef,
+    0x36, 0xe2, 0x12, 0xfe, 0xc3, 0x00, 0xa8, 0x26, 0xf1, 0xaa, 0xa9, 0xad, 0xac, 0xfe, 0x81, 0x00,
+    0x6a, 0x77, 0xa4, 0xd7, 0xb4, 0x97, 0x69, 0x27, 0x65, 0xbd, 0x58, 0xcd, 0xea, 0x16, 0xd7, 0x64,
+    0xfa, 0xc4, 0xcf, 0x12, 0x78, 0x5f, 0x55, 0x26, 0xb4, 0xf4, 0xdf, 0x6f, 0xe4, 0x3c, 0xfd, 0xd5,
+    0x5a, 0xe9, 0xca, 0xf7, 0xd0, 0xa7, 0xf6, 0x6a, 0x7d, 0x6a, 0xdf, 0x45, 0x9f, 0xfa, 0xab, 0xf5,
+    0xa9, 0xaf, 0xd5, 0x67, 0xd3, 0x72, 0xfe, 0x6f, 0x7a, 0x19, 0xa7, 0x64, 0xcb, 0xcb, 0x57, 0x25,
+    0xbd, 0x8b, 0x7f, 0x60, 0xa7, 0xe5, 0x2d, 0x6b, 0x3a, 0x63, 0x27, 0x3b, 0x69, 0xf3, 0x7a, 0x84,
+    0xbd, 0x71, 0x93, 0xf1, 0x3a, 0x78, 0xbe, 0x6d, 0x57, 0x3a, 0x89, 0x86, 0x29, 0x05, 0xe6, 0xa3,
+    0xfe, 0x98, 0xef, 0xaf, 0x2b, 0x14, 0x94, 0xb7, 0xc3, 0x49, 0x32, 0xe9, 0x64, 0xa5, 0x40, 0x56,
+    0x82, 0x33, 0xcd, 0x03, 0xee, 0xef, 0xc9, 0x45, 0x62, 0x1e, 0xc5, 0xe6, 0x4b, 0xa8, 0xf0, 0xfc,
+    0x3a, 0x89, 0x37, 0x93, 0x73, 0x6b, 0x29, 0x8f, 0xe9, 0x25, 0x0f, 0x06, 0x9d, 0xc0, 0x4e, 0x28,
+    0x3d, 0x9b, 0x99, 0xe2, 0x0c, 0x92, 0xbc, 0x0d, 0x7e, 0x3d, 0x60, 0xb5, 0xc8, 0x53, 0x32, 0xde,
+    0xaf, 0xbe, 0x14, 0x4f, 0xd7, 0xdf, 0x00, 0xa8, 0xbf, 0x02, 0xb0, 0xde, 0x78, 0x03, 0x60, 0xed,
+    0x15, 0x80, 0x07, 0x87, 0x6f, 0x00, 0xac, 0xbf, 0x02, 0xf0, 0xf8, 0x2d, 0x73, 0xd8, 0xd8, 0x09,
+    0x70, 0x23, 0x90, 0xb8, 0x28, 0xba, 0x87, 0x37, 0x29, 0x11, 0x5e, 0xd9, 0x05, 0x3d, 0x46, 0xe5,
+    0x2d, 0x7e, 0x84, 0x5b, 0x84, 0x90, 0x2b, 0x5f, 0x3c, 0x56, 0xac, 0xf7, 0xf6, 0x4e, 0xeb, 0x3d,
+    0xb9, 0x21, 0xdb, 0x65, 0xcd, 0x27, 0x37, 0x6c, 0x4c, 0xc6, 0xbc, 0xb5, 0xeb, 0xda, 0x9f, 0x83,
+    0xbf, 0x7e, 0xfd, 0xcf, 0xbf, 0x93, 0xac, 0x76, 0xb5, 0xc4, 0xd8, 0x9a, 0x0c, 0x5a, 0xad, 0xfc,
+    0x2b, 0x62, 0x09, 0xbf, 0xc7, 0xbc, 0x15, 0x38, 0xff, 0x2d, 0x63, 0xf8, 0xc5, 0xb0, 0x5f, 0x5f,
+    0x03, 0xfb, 0x76, 0x37, 0x77, 0xf2, 0xdf, 0x32, 0x09, 0xbe, 0x1c, 0x76, 0x47, 0xdc, 0x37, 0x4f,
+    0x2a, 0xc3, 0xcb, 0xad, 0x0e, 0x98, 0x05, 0x3d, 0xf8, 0x0d, 0x72, 0x6e, 0xa5, 0xb7, 0x17, 0x58,
+    0x73, 0xdf, 0x40, 0x73, 0x91, 0x76, 0xce, 0xb7, 0xa7, 0x9d, 0x97, 0xa4, 0x9b, 0xec, 0xed, 0x82,
+    0x48, 0x3b, 0x3c, 0x59, 0x08, 0x85, 0xf8, 0x6f, 0xa1, 0x45, 0x76, 0xc8, 0xf3, 0x56, 0x7e, 0xae,
+    0xa4, 0xfc, 0xe4, 0xa6, 0x15, 0x93, 0xa4, 0x01, 0x6a, 0x81, 0x5e, 0x0d, 0x43, 0xa9, 0x64, 0x72,
+    0x15, 0xff, 0x0a, 0xb6, 0x31, 0x4f, 0xc9, 0x1a, 0x3a, 0xfb, 0x49, 0x7d, 0x21, 0x7d, 0xb1, 0x0b,
+    0x0f, 0x26, 0x92, 0xbf, 0xad, 0x4a, 0x5b, 0xcb, 0x85, 0x7d, 0x3a, 0x93, 0xbd, 0xc6, 0xbe, 0xea,
+    0xa2, 0x7d, 0x75, 0x6e, 0x5f, 0xda, 0xa9, 0x15, 0x79, 0x77, 0xc3, 0x7f, 0x5e, 0xd2, 0x61, 0xc6,
+    0x77, 0x36, 0xc1, 0x71, 0x57, 0xe4, 0xc5, 0x4f, 0xdf, 0xc5, 0x9d, 0x53, 0x5e, 0x00, 0xe5, 0x6f,
+    0x68, 0x59, 0xdc, 0x3d, 0xe5, 0x13, 0xed, 0x5b, 0x15, 0x21, 0x1c, 0xe0, 0xf0, 0x9e, 0x0b, 0x9f,
+    0xec, 0xb7, 0xf4, 0xff, 0x07, 0x37, 0xa5, 0xcc, 0xe6, 0x62, 0x2f, 0x00, 0x00,
+};
+
+#endif // WEB_UI_HTML_H__